@@ -42,12 +42,30 @@ FuncDeclaration *buildArrayOp(Identifier *ident, BinExp *exp, Scope *sc)
     Expression *loopbody = buildArrayLoop(exp, fparams);
 
     /* Construct the function body:
+     *  cast(void)p1[0 .. p.length];  // for each other array
      *  foreach (i; 0 .. p.length)    for (size_t i = 0; i < p.length; i++)
      *      loopbody;
      *  return p;
+     * The loop body indexes the .ptr of each array, so that with -O the
+     * backend can vectorize it; the slices do the bounds checking up front.
      */
 
     Parameter *p = (*fparams)[0];
+    Statement *s0 = nullptr;
+    for (size_t i = 1; i < fparams->length; i++)
+    {
+        Parameter *pa = (*fparams)[i];
+        Type *tb = pa->type->toBasetype();
+        if (tb->ty != Tarray && tb->ty != Tsarray)
+            continue;
+        Expression *e = new SliceExp(Loc(), new IdentifierExp(Loc(), pa->ident),
+            new IntegerExp(Loc(), 0, Type::tsize_t),
+            new ArrayLengthExp(Loc(), new IdentifierExp(Loc(), p->ident)));
+        e = new CastExp(Loc(), e, Type::tvoid);
+        Statement *s = new ExpStatement(Loc(), e);
+        s0 = s0 ? new CompoundStatement(Loc(), s0, s) : s;
+    }
+
     // foreach (i; 0 .. p.length)
     Statement *s1 = new ForeachRangeStatement(Loc(), TOKforeach,
         new Parameter(0, nullptr, Id::p, nullptr, nullptr),
@@ -59,6 +77,8 @@ FuncDeclaration *buildArrayOp(Identifier *ident, BinExp *exp, Scope *sc)
     Statement *s2 = new ReturnStatement(Loc(), new IdentifierExp(Loc(), p->ident));
     //printf("s2: %s\n", s2->toChars());
     Statement *fbody = new CompoundStatement(Loc(), s1, s2);
+    if (s0)
+        fbody = new CompoundStatement(Loc(), s0, fbody);
 
     // Built-in array ops should be @trusted, pure, nothrow
     StorageClass stc = STCtrusted | STCpure | STCnothrow;
@@ -442,7 +462,7 @@ Expression *buildArrayLoop(Expression *e, Parameters *fparams)
             Identifier *id = Identifier::generateId("p", fparams->length);
             Parameter *param = new Parameter(STCconst, e->type, id, nullptr, nullptr);
             fparams->shift(param);
-            Expression *ie = new IdentifierExp(Loc(), id);
+            Expression *ie = new DotIdExp(Loc(), new IdentifierExp(Loc(), id), Id::ptr);
             Expression *index = new IdentifierExp(Loc(), Id::p);
             result = new ArrayExp(Loc(), ie, index);
         }
@@ -452,7 +472,7 @@ Expression *buildArrayLoop(Expression *e, Parameters *fparams)
             Identifier *id = Identifier::generateId("p", fparams->length);
             Parameter *param = new Parameter(STCconst, e->type, id, nullptr, nullptr);
             fparams->shift(param);
-            Expression *ie = new IdentifierExp(Loc(), id);
+            Expression *ie = new DotIdExp(Loc(), new IdentifierExp(Loc(), id), Id::ptr);
             Expression *index = new IdentifierExp(Loc(), Id::p);
             result = new ArrayExp(Loc(), ie, index);
         }
@@ -45,7 +45,10 @@ void out_config_init(
                         // 1: D
                         // 2: fake it with C symbolic debug info
         bool alwaysframe,       // always create standard function frame
-        bool stackstomp         // add stack stomping code
+        bool stackstomp,        // add stack stomping code
+        int unroll,             // loop unrolling limit, -1 for the default
+        int avx,                // use AVX instructions: 0 none, 1 AVX, 2 AVX2
+        bool profgen            // count branches taken for -profile-use
         )
 {
     //printf("out_config_init()\n");
@@ -56,6 +59,7 @@ void out_config_init(
     }
     config.fulltypes = CVNONE;
     config.fpxmmregs = FALSE;
+    config.avx = 0;
     config.inline8087 = 1;
     config.memmodel = 0;
     config.flags |= CFGuchar;   // make sure TYchar is unsigned
@@ -65,6 +69,7 @@ void out_config_init(
     {   config.exe = EX_LINUX64;
         config.ehmethod = EH_DWARF;
         config.fpxmmregs = TRUE;
+        config.avx = avx;
     }
     else
     {
@@ -86,13 +91,18 @@ void out_config_init(
 
     if (trace)
         config.flags |= CFGtrace;       // turn on profiler
+    if (profgen)
+        config.flags4 |= CFG4profgen;   // count branches
     if (nofloat)
         config.flags3 |= CFG3wkfloat;
 
     configv.verbose = verbose;
 
     if (optimize)
+    {
         go_flag((char *)"-o");
+        config.unroll = unroll < 0 ? 8 : unroll;
+    }
 
     if (symdebug)
     {
@@ -1435,6 +1435,101 @@ STATIC void brmin()
     }
 }
 
+/**********************************
+ * Lay out the blocks so the cold ones, those that only lead to
+ * an assert failure, a bounds check error or some other function that
+ * does not return, are moved to the end of the function.
+ * That way the hot paths fall through and are packed together.
+ */
+
+void block_layout()
+{
+    cmes("block_layout()\n");
+    assert(startblock);
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        if (b->Btry)
+            return;
+        switch (b->BC)
+        {
+            case BCasm:
+            case BCtry:
+            case BCcatch:
+            case BC_try:
+            case BC_filter:
+            case BC_finally:
+            case BC_ret:
+            case BC_except:
+            case BCjcatch:
+            case BC_lpad:
+                return;                 // leave EH and asm layout alone
+        }
+    }
+
+    // Mark the cold blocks with BFLmark
+    int ncold = 0;
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        b->Bflags &= ~BFLmark;
+        if (b->BC == BCexit ||
+            b->Belem && b->BC == BCgoto && el_noreturn(b->Belem) ||
+            b->Bflags & BFLprofiled && b->Bcount == 0)    // never run in the profile
+        {
+            b->Bflags |= BFLmark;
+            ncold++;
+        }
+    }
+    if (!ncold)
+        return;
+
+    // A block is cold if all its successors are
+    int changes;
+    do
+    {
+        changes = 0;
+        for (block *b = startblock; b; b = b->Bnext)
+        {
+            if (b->Bflags & BFLmark || !b->Bsucc)
+                continue;
+            list_t bl;
+            for (bl = b->Bsucc; bl; bl = list_next(bl))
+            {
+                if (!(list_block(bl)->Bflags & BFLmark))
+                    break;
+            }
+            if (!bl)
+            {
+                b->Bflags |= BFLmark;
+                changes = 1;
+            }
+        }
+    } while (changes);
+
+    // Move them, in the same order, to the end
+    startblock->Bflags &= ~BFLmark;
+    block *cold = nullptr;
+    block **pcold = &cold;
+    for (block **pb = &startblock->Bnext; *pb; )
+    {
+        block *b = *pb;
+        if (b->Bflags & BFLmark)
+        {
+            b->Bflags &= ~BFLmark;
+            *pb = b->Bnext;
+            *pcold = b;
+            pcold = &b->Bnext;
+            cmes2("Moving cold block %p to the end\n",b);
+        }
+        else
+            pb = &b->Bnext;
+    }
+    *pcold = nullptr;
+    block *b;
+    for (b = startblock; b->Bnext; b = b->Bnext)
+        ;
+    b->Bnext = cold;
+}
+
 /***************************************
  * Do tail recursion.
  */
@@ -364,8 +364,11 @@ typedef struct block
         #define BFLjmpoptdone 4         // set when no more jump optimizations
                                         //  are possible for this block
         #define BFLnostackopt 8         // set when stack elimination should not be done
+        #define BFLunrolled   0x10      // loop was already unrolled or vectorized,
+                                        //  don't do it again
 
         #define BFLnomerg      0x20     // do not merge with other blocks
+        #define BFLprofiled    0x40     // Bcount is from a profile
         #define BFLprolog      0x80     // generate function prolog
         #define BFLepilog      0x100    // generate function epilog
         #define BFLrefparam    0x200    // referenced parameter
@@ -377,6 +380,8 @@ typedef struct block
 
     unsigned Bweight;           // relative number of times this block
                                 // is executed (optimizer and codegen)
+    targ_ullong Bcount;         // number of times this block was run in
+                                // the profiled run, if BFLprofiled
 
     unsigned    Bdfoidx;        // index of this block in dfo[]
     union
@@ -449,6 +454,8 @@ typedef struct block
             targ_size_t Bsize;          // code size of this block
             con_t       Bregcon;        // register state at block exit
             targ_size_t Btryoff;        // BCtry: offset of try block data
+            Symbol     *Btailcall;      // BCret, BCretexp: function the epilog
+                                        // jumps to instead of returning
 
             #define Btablesize          _BLU._UD.Btablesize
             #define Btableoffset        _BLU._UD.Btableoffset
@@ -458,6 +465,7 @@ typedef struct block
 //          #define Bcode               _BLU._UD.Bcode
             #define Bregcon             _BLU._UD.Bregcon
             #define Btryoff             _BLU._UD.Btryoff
+            #define Btailcall           _BLU._UD.Btailcall
         } _UD;
     } _BLU;
 
@@ -577,6 +585,8 @@ typedef struct FUNC_S
         #define Fnotailrecursion 0x4000 // no tail recursion optimizations
         #define Ffakeeh         0x8000  // allocate space for NT EH context sym anyway
         #define Fnothrow        0x10000 // function does not throw (even if not marked 'nothrow')
+        #define Fhot            0x20000 // profile shows most time is spent here
+        #define Fcold           0x40000 // profile shows it is never called
     unsigned char Foper;        // operator number (OPxxxx) if Foperator
 
     Symbol *Fparsescope;        // use this scope to parse friend functions
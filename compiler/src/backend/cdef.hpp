@@ -407,6 +407,7 @@ struct Config
 #define CVSTABS 7               // Elf Stabs in C format
 
     bool fpxmmregs;             // use XMM registers for floating point
+    char avx;                   // use AVX instruction set (0, 1 or 2)
     char inline8087;            /* 0:   emulator
                                    1:   IEEE 754 inline 8087 code
                                    2:   fast inline 8087 code
@@ -503,6 +504,7 @@ struct Config
 #define CFG4anew        0x4000  // allow operator new[] and delete[] overloading
 #define CFG4oldtmangle  0x8000  // use old template name mangling
 #define CFG4dllrtl      0x10000 // link with DLL RTL
+#define CFG4profgen     0x20000 // count branches taken for a profile
 #define CFG4noemptybaseopt 0x40000      // turn off empty base class optimization
 #define CFG4stackalign  CFG4speed       // align stack to 8 bytes
 #define CFG4nowchar_t   0x80000 // use unsigned short name mangling for wchar_t
@@ -537,6 +539,8 @@ struct Config
                                 // to near
     enum LINKAGE linkage;       // default function call linkage
     enum EHmethod ehmethod;     // exception handling method
+    unsigned unroll;            // max iterations of a loop to unroll completely,
+                                // 0 for no loop unrolling
 };
 
 // Configuration that is not saved in precompiled header
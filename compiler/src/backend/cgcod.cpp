@@ -72,6 +72,7 @@ int stackchanged;               /* set to !=0 if any use of the stack
 int refparam;           // !=0 if we referenced any parameters
 int reflocal;           // !=0 if we referenced any locals
 bool anyiasm;           // !=0 if any inline assembler
+bool anytailcalls;      // calls in tail position can be JMPs from the epilog
 char calledafunc;       // !=0 if we called a function
 char needframe;         // if TRUE, then we will need the frame
                         // pointer (BP for the 8088)
@@ -109,6 +110,10 @@ targ_size_t     retsize;        /* size of function return              */
 
 static regm_t lastretregs,last2retregs,last3retregs,last4retregs,last5retregs;
 
+static block *curblock_cg;      // block code is being generated for
+static block *coldblocks;       // out of line code, placed after the function body
+static bool anycoldblocks;      // ok to create coldblocks for this function
+
 /*********************************
  * Generate code for a function.
  * Note at the end of this routine mfuncreg will contain the mask
@@ -135,6 +140,9 @@ void codgen()
     anyiasm = 0;
 
 tryagain:
+    for (block* b = coldblocks; b; b = b->Bnext)
+        code_free(b->Bcode);
+    blocklist_free(&coldblocks);        // from the previous pass
     #ifdef DEBUG
     if (debugr)
         printf("------------------ PASS%s -----------------\n",
@@ -177,6 +185,7 @@ tryagain:
     mfuncreg = fregsaved;               // so we can see which are used
                                         // (bit is cleared each time
                                         //  we use one)
+    anycoldblocks = (config.flags4 & CFG4optimized) != 0;
     for (block* b = startblock; b; b = b->Bnext)
     {   memset(&b->Bregcon,0,sizeof(b->Bregcon));       // Clear out values in registers
         if (b->Belem)
@@ -185,7 +194,12 @@ tryagain:
             anyiasm = 1;                // we have inline assembler
         if (b->BC == BCret || b->BC == BCretexp)
             nretblocks++;
+        if (b->Btry || b->BC == BCasm || b->BC == BC_try || b->BC == BCtry)
+            anycoldblocks = false;      // keep EH ranges and asm labels simple
+        if (b->BC == BCret || b->BC == BCretexp)
+            b->Btailcall = nullptr;
     }
+    anytailcalls = cod3_anytailcalls();
 
     if (!config.fulltypes || (config.flags4 & CFG4optimized))
     {
@@ -259,6 +273,15 @@ tryagain:
     stackoffsets(1);            // compute addresses of stack variables
     cod5_prol_epi();            // see where to place prolog/epilog
 
+    // Append the out of line code
+    if (coldblocks)
+    {   block* b;
+        for (b = startblock; b->Bnext; b = b->Bnext)
+            ;
+        b->Bnext = coldblocks;
+        coldblocks = nullptr;
+    }
+
     // Get rid of unused cse temporaries
     while (cstop != 0 && (csextab[cstop - 1].flags & CSEload) == 0)
         cstop--;
@@ -279,6 +302,8 @@ tryagain:
     if (eecontext.EEelem)
         genEEcode();
 
+    bool ymmdirty = config.avx && cod3_ymmdirty(cprolog);
+
     for (block* b = startblock; b; b = b->Bnext)
     {
         // We couldn't do this before because localsize was unknown
@@ -302,6 +327,10 @@ tryagain:
             b->Bcode = cat(cprolog,b->Bcode);
         }
         cgsched_block(b);
+        if (ymmdirty && b->BC != BCasm)
+            cod3_vzeroupper(b);
+        if (config.avx && b->BC != BCasm)
+            cod3_vex(b->Bcode);         // use the VEX encodings
         b->Bsize = calcblksize(b->Bcode);       // calculate block size
         if (b->Balign)
         {   targ_size_t u = b->Balign - 1;
@@ -442,9 +471,10 @@ tryagain:
 
     if (config.ehmethod == EH_DWARF)
     {
+        block *bsave = funcsym_p->Sfunc->Fstartblock;  // inline_keep()'s copy
         funcsym_p->Sfunc->Fstartblock = startblock;
         dwarf_except_gentables(funcsym_p, startoffset, retoffset);
-        funcsym_p->Sfunc->Fstartblock = nullptr;
+        funcsym_p->Sfunc->Fstartblock = bsave;
     }
 
     for (block* b = startblock; b; b = b->Bnext)
@@ -458,6 +488,8 @@ tryagain:
     // Mask of regs saved
     // BUG: do interrupt functions save BP?
     funcsym_p->Sregsaved = (functy == TYifunc) ? mBP : (mfuncreg | fregsaved);
+    if (ymmdirty)
+        funcsym_p->Sregsaved &= ~XMMREGS;       // VZEROUPPER changes them all
 
     util_free(csextab);
     csextab = nullptr;
@@ -1082,6 +1114,7 @@ STATIC void blcodgen(block *bl)
     char *sflsave = nullptr;
 
     //dbg_printf("blcodgen(%p)\n",bl);
+    curblock_cg = bl;
 
     /* Determine existing immediate values in registers by ANDing
         together the values from all the predecessors of b.
@@ -1206,6 +1239,30 @@ STATIC void blcodgen(block *bl)
 #endif
 }
 
+/****************************
+ * Get a new block for code that is rarely executed, such as a call
+ * to a function that never returns. It is placed after all the other
+ * blocks of the function so it is out of the way of the hot code.
+ * Returns:
+ *      the block, with its Bcode to be filled in, or nullptr if
+ *      the code needs to be generated in line
+ */
+
+block *cgcod_coldblock()
+{
+    if (!anycoldblocks || anyiasm || usednteh)
+        return nullptr;
+    block *b = block_calloc();
+    b->BC = BCexit;
+    if (configv.addlinenumbers && curblock_cg->Bsrcpos.Slinnum)
+        cgen_linnum(&b->Bcode,curblock_cg->Bsrcpos);
+    block **pb;
+    for (pb = &coldblocks; *pb; pb = &(*pb)->Bnext)
+        ;
+    *pb = b;
+    return b;
+}
+
 /******************************
  * Count the number of bits set in a register mask.
  */
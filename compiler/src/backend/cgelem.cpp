@@ -28,6 +28,7 @@ extern void error(const char *filename, unsigned linnum, unsigned charnum, const
 
 STATIC elem * optelem(elem *,goal_t);
 STATIC elem * eldiv(elem *, goal_t goal);
+STATIC elem * eldivisible(elem *, goal_t goal);
 
 extern elem * evalu8(elem *, goal_t goal);
 
@@ -923,7 +924,8 @@ STATIC elem * elmul(elem *e, goal_t goal)
   }
 
   elem *e2 = e->E2;
-  if (e2->Eoper == OPconst)             /* try to replace multiplies with shifts */
+  if (e2->Eoper == OPconst &&           /* try to replace multiplies with shifts */
+      !tyvector(tym))                   // vector constants aren't a single value
   {
         if (OPTIMIZER)
         {
@@ -3664,6 +3666,14 @@ L1:
             return optelem(e,GOALvalue);
         }
     }
+
+    // Convert ((x % c) == 0) to a multiply by the inverse of c
+    if ((op == OPeqeq || op == OPne) && e2->Eoper == OPconst && !boolres(e2))
+    {
+        elem *er = eldivisible(e, goal);
+        if (er)
+            return er;
+    }
   }
 
   uns = tyuns(e1->Ety) | tyuns(e2->Ety);
@@ -3824,6 +3834,92 @@ ret:
   return e;
 }
 
+/*****************************
+ * Rewrite ((x % c) == 0) or ((x % c) != 0), c a constant, without the
+ * divide. With c = d * 2**k, d odd, and inv the inverse of d modulo
+ * 2**N, multiplying by inv maps the multiples of c onto a range at the
+ * bottom, and leaves the low k bits clear so a rotate moves them out
+ * of the way (Hacker's Delight 10-17):
+ *      unsigned        ror(x * inv, k) <= (2**N - 1) / c
+ *      signed          ror(x * inv + (M << k), k) <= 2 * M
+ *                      where M = 2**(N-1-k) / d
+ * For c a power of 2 it is just ((x & (|c| - 1)) == 0).
+ * Returns:
+ *      the rewritten tree, nullptr if e isn't one of these
+ */
+
+STATIC elem * eldivisible(elem *e, goal_t goal)
+{
+    if (!(config.flags4 & CFG4speed))
+        return nullptr;
+
+    // The mod may already be an OPremquo, see eldiv()
+    elem *e1 = e->E1;
+    elem *em = e1;
+    if (em->Eoper == OPmsw && em->E1->Eoper == OPremquo)
+        em = em->E1;
+    else if (em->Eoper != OPmod)
+        return nullptr;
+    if (em->Ecount || e1->Ecount || em->E2->Eoper != OPconst ||
+        !tyintegral(em->E1->Ety) || tyvector(em->E1->Ety))
+        return nullptr;
+
+    int sz = tysize(em->E1->Ety);
+    if (sz != 4 && sz != 8 || sz > REGSIZE)
+        return nullptr;
+    int N = sz * 8;
+    targ_ullong umax = ~0ULL >> (64 - N);
+    bool uns = tyuns(em->E1->Ety) || tyuns(em->E2->Ety);
+    targ_ullong c = el_tolong(em->E2) & umax;
+    if (!uns && (c >> (N - 1)))
+        c = -c & umax;                  // divisibility by -c is the same
+    if (c <= 1)
+        return nullptr;
+
+    int k = 0;
+    targ_ullong d = c;
+    while (!(d & 1))
+    {   d >>= 1;
+        k++;
+    }
+
+    tym_t ty = touns(tybasic(em->E1->Ety));
+    elem *x = em->E1;
+    em->E1 = nullptr;
+    el_free(e1);
+    el_free(e->E2);
+
+    if (d == 1)
+    {   // (x & (c - 1)) == 0
+        e->E1 = el_bin(OPand, ty, x, el_long(ty, c - 1));
+        e->E2 = el_long(ty, 0);
+        return optelem(e, GOALvalue);
+    }
+
+    // Newton's method, each step doubles the number of correct low bits
+    targ_ullong inv = d;                // d * d == 1 mod 8 for odd d
+    for (int i = 0; i < 5; i++)
+        inv *= 2 - d * inv;
+    assert(((d * inv) & umax) == 1);
+
+    targ_ullong limit;
+    elem *t = el_bin(OPmul, ty, x, el_long(ty, inv & umax));
+    if (uns)
+        limit = umax / c;
+    else
+    {
+        targ_ullong M = (1ULL << (N - 1 - k)) / d;
+        t = el_bin(OPadd, ty, t, el_long(ty, M << k));
+        limit = 2 * M;
+    }
+    if (k)
+        t = el_bin(OPror, ty, t, el_long(TYint, k));
+    e->E1 = t;
+    e->E2 = el_long(ty, limit);
+    e->Eoper = (e->Eoper == OPeqeq) ? OPle : OPgt;
+    return optelem(e, GOALvalue);
+}
+
 /*****************************
  * Boolean operator.
  *      OPbool
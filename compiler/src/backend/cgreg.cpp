@@ -23,6 +23,7 @@ static char __file__[] = __FILE__;      /* for tassert.h                */
 #include        "tassert.hpp"
 
 STATIC void el_weights(int bi,elem *e,unsigned weight);
+STATIC int cgreg_lvbenefit(Symbol *s,int reg, Symbol *retsym);
 
 #undef __cdecl
 #define __cdecl
@@ -224,6 +225,20 @@ STATIC void el_weights(int bi,elem *e,unsigned weight)
  */
 
 int cgreg_benefit(Symbol *s,int reg, Symbol *retsym)
+{
+    //printf("cgreg_benefit(s = '%s', reg = %d)\n", s->Sident, reg);
+
+    vec_sub(s->Slvreg,s->Srange,regrange[reg]);
+    return cgreg_lvbenefit(s,reg,retsym);
+}
+
+/*****************************************
+ * Determine 'benefit' of having symbol s in register reg in the
+ * blocks in s->Slvreg. Blocks are removed from s->Slvreg where
+ * moving s in and out of reg can't be done at the block boundaries.
+ */
+
+STATIC int cgreg_lvbenefit(Symbol *s,int reg, Symbol *retsym)
 {
     int benefit;
     int benefit2;
@@ -232,9 +247,6 @@ int cgreg_benefit(Symbol *s,int reg, Symbol *retsym)
     int gotoepilog;
     int retsym_cnt;
 
-    //printf("cgreg_benefit(s = '%s', reg = %d)\n", s->Sident, reg);
-
-    vec_sub(s->Slvreg,s->Srange,regrange[reg]);
     int si = s->Ssymnum;
 
     regm_t dst_integer_reg;
@@ -602,6 +614,42 @@ void cgreg_spillreg_epilog(block *b,Symbol *s,code **pcstore,code **pcload)
     *pcload = cload;
 }
 
+/***************************
+ * Set s->Sfl back to the memory s lives in when not in a register.
+ */
+
+STATIC void cgreg_unregfl(Symbol *s)
+{
+    switch (s->Sclass)
+    {
+        case SCauto:
+        case SCregister:
+            s->Sfl = FLauto;
+            break;
+        case SCfastpar:
+            s->Sfl = FLfast;
+            break;
+        case SCbprel:
+            s->Sfl = FLbprel;
+            break;
+        case SCshadowreg:
+        case SCparameter:
+            s->Sfl = FLpara;
+            break;
+        case SCpseudo:
+            s->Sfl = FLpseudo;
+            break;
+        case SCstack:
+            s->Sfl = FLstack;
+            break;
+        default:
+#ifdef DEBUG
+            symbol_print(s);
+#endif
+            assert(0);
+    }
+}
+
 /***************************
  * Map symbol s into registers [NOREG,reglsw] or [regmsw, reglsw].
  */
@@ -625,34 +673,7 @@ void cgreg_map(Symbol *s, unsigned regmsw, unsigned reglsw)
         //vec_sub(s->Slvreg,s->Srange,regrange[reglsw]);
 
         if (s->Sfl == FLreg)            // if reassigned
-        {
-            switch (s->Sclass)
-            {
-                case SCauto:
-                case SCregister:
-                    s->Sfl = FLauto;
-                    break;
-                case SCfastpar:
-                    s->Sfl = FLfast;
-                    break;
-                case SCbprel:
-                    s->Sfl = FLbprel;
-                    break;
-                case SCshadowreg:
-                case SCparameter:
-                    s->Sfl = FLpara;
-                    break;
-                case SCpseudo:
-                    s->Sfl = FLpseudo;
-                    break;
-                case SCstack:
-                    s->Sfl = FLstack;
-                    break;
-                default:
-                    symbol_print(s);
-                    assert(0);
-            }
-        }
+            cgreg_unregfl(s);
     }
     s->Sreglsw = reglsw;
     s->Sregm = mask[reglsw];
@@ -710,6 +731,100 @@ void cgreg_unregister(regm_t conflict)
     }
 }
 
+/******************************************
+ * Live range splitting.
+ * s can't have reg in the blocks where reg already holds another
+ * variable o. But where o is used no more than s, o can be split:
+ * left in memory in those blocks, and moved in and out of reg at
+ * their boundaries, so s can have reg there instead.
+ * Input:
+ *      apply   do the split, rather than just evaluate it
+ * Returns:
+ *      benefit of splitting and then assigning s to reg, which is
+ *      the benefit to s less what is lost by the split variables;
+ *      -1 if no variable can be split
+ *      s->Slvreg is set to the blocks s gets reg in
+ */
+
+STATIC int cgreg_split(Symbol *s, int reg, Symbol *retsym, bool apply)
+{
+    if (s == retsym)
+        return -1;
+
+    int si = s->Ssymnum;
+    vec_t range = vec_calloc(dfotop);   // regrange[reg] after the split
+    vec_copy(range,regrange[reg]);
+    vec_t lvsave = vec_calloc(dfotop);
+    int loss = 0;
+    bool split = false;
+
+    for (size_t i = 0; i < globsym.top; i++)
+    {   Symbol *o = globsym.tab[i];
+
+        if (o == s || o == retsym ||
+            !(o->Sfl == FLreg || o->Sflags & SFLspill) ||
+            o->Sflags & GTunregister ||
+            o->Sregm != mask[reg] ||
+            vec_disjoint(o->Slvreg,s->Srange))
+            continue;
+
+        int oi = o->Ssymnum;
+        vec_copy(lvsave,o->Slvreg);
+        int before = cgreg_lvbenefit(o,reg,retsym);
+        vec_copy(o->Slvreg,lvsave);
+
+        int bi;
+        foreach (bi,dfotop,s->Srange)
+        {
+            if (WEIGHTS(bi,oi) <= WEIGHTS(bi,si))
+                vec_clearbit(bi,o->Slvreg);
+        }
+        int after = vec_equal(o->Slvreg,lvsave) ? -1 : cgreg_lvbenefit(o,reg,retsym);
+        if (before < 0 || after < 0)
+        {
+            vec_copy(o->Slvreg,lvsave);
+            continue;
+        }
+
+        // The blocks o has left are free for s
+        vec_subass(lvsave,o->Slvreg);
+        vec_subass(range,lvsave);
+        loss += before - after;
+        split = true;
+
+        if (apply)
+        {
+        #ifdef DEBUG
+            if (debugr)
+            {
+                printf("symbol '%s' split out of register %s for '%s'\n    ",
+                    o->Sident,regstring[reg],s->Sident);
+                vec_println(o->Slvreg);
+            }
+        #endif
+            o->Sflags |= SFLspill;
+            if (o->Sfl == FLreg)
+                cgreg_unregfl(o);
+        }
+        else
+            vec_orass(o->Slvreg,lvsave);            // put it back
+    }
+
+    int benefit = -1;
+    if (split)
+    {
+        vec_sub(s->Slvreg,s->Srange,range);
+        benefit = cgreg_lvbenefit(s,reg,retsym);
+        if (benefit >= 0)
+            benefit -= loss;
+        if (apply)
+            vec_copy(regrange[reg],range);
+    }
+    vec_free(lvsave);
+    vec_free(range);
+    return benefit;
+}
+
 /******************************************
  * Do register assignments.
  * Returns:
@@ -723,6 +838,7 @@ struct Reg              // data for trial register assignment
     int reglsw;
     int regmsw;
     int benefit;
+    bool split;                 // other variables' live ranges are split
 };
 
 int cgreg_assign(Symbol *retsym)
@@ -750,36 +866,7 @@ int cgreg_assign(Symbol *retsym)
             flag = TRUE;
             s->Sflags &= ~(GTregcand | GTunregister | SFLspill);
             if (s->Sfl == FLreg)
-            {
-                switch (s->Sclass)
-                {
-                    case SCauto:
-                    case SCregister:
-                        s->Sfl = FLauto;
-                        break;
-                    case SCfastpar:
-                        s->Sfl = FLfast;
-                        break;
-                    case SCbprel:
-                        s->Sfl = FLbprel;
-                        break;
-                    case SCshadowreg:
-                    case SCparameter:
-                        s->Sfl = FLpara;
-                        break;
-                    case SCpseudo:
-                        s->Sfl = FLpseudo;
-                        break;
-                    case SCstack:
-                        s->Sfl = FLstack;
-                        break;
-                    default:
-#ifdef DEBUG
-                        symbol_print(s);
-#endif
-                        assert(0);
-                }
-            }
+                cgreg_unregfl(s);
         }
     }
 
@@ -805,6 +892,7 @@ int cgreg_assign(Symbol *retsym)
     Reg t;
     t.sym = nullptr;
     t.benefit = 0;
+    t.split = false;
     for (size_t si = 0; si < globsym.top; si++)
     {   symbol *s = globsym.tab[si];
 
@@ -846,6 +934,7 @@ int cgreg_assign(Symbol *retsym)
         cgreg_set_priorities(ty, &pseq, &pseqmsw);
 
         u.benefit = 0;
+        u.split = false;
         for (int i = 0; pseq[i] != NOREG; i++)
         {
             unsigned reg = pseq[i];
@@ -911,8 +1000,30 @@ int cgreg_assign(Symbol *retsym)
                 u.benefit = benefit;
                 u.reglsw = reg;
                 u.regmsw = regmsw;
+                u.split = false;
+            }
+Ltried:
+            /* See if s does better still if it can have reg in blocks
+             * where other variables in reg are hardly used.
+             */
+            if (!pseqmsw && benefit >= 0 && s->Sflags & GTregcand)
+            {
+                benefit = cgreg_split(s,reg,retsym,false);
+
+                #ifdef DEBUG
+                if (debugr && benefit >= 0)
+                    printf(" %s split %d\n",regstring[reg],benefit);
+                #endif
+
+                if (benefit > u.benefit)
+                {
+                    vec_copy(v,s->Slvreg);
+                    u.benefit = benefit;
+                    u.reglsw = reg;
+                    u.regmsw = NOREG;
+                    u.split = true;
+                }
             }
-Ltried:     ;
         }
 
         if (u.benefit > t.benefit)
@@ -923,6 +1034,8 @@ Ltried:     ;
 
     if (t.sym && t.benefit > 0)
     {
+        if (t.split)
+            cgreg_split(t.sym,t.reglsw,retsym,true);
         cgreg_map(t.sym,t.regmsw,t.reglsw);
         flag = TRUE;
     }
@@ -20,6 +20,7 @@
 #include        "type.hpp"
 #include        "exh.hpp"
 #include        "list.hpp"
+#include        "xmm.hpp"
 
 static char __file__[] = __FILE__;      /* for tassert.h                */
 #include        "tassert.hpp"
@@ -68,6 +69,7 @@ struct Cinfo
 code *simpleops(code *c,regm_t scratch);
 code *schedule(code *c,regm_t scratch);
 code *peephole(code *c,regm_t scratch);
+code *cgsched_ooo(code *c);
 
 /*****************************************
  * Do Pentium optimizations.
@@ -102,7 +104,10 @@ void cgsched_block(block* b)
 
         scratch &= ~(b->Bregcon.used | b->Bregcon.params | mfuncreg);
         scratch &= ~(b->Bregcon.immed.mval | b->Bregcon.cse.mval);
-        cgsched_pentium(&b->Bcode,scratch);
+        if (I64)
+            b->Bcode = cgsched_ooo(b->Bcode);
+        else
+            cgsched_pentium(&b->Bcode,scratch);
         //printf("after schedule:\n"); WRcodlst(b->Bcode);
     }
 }
@@ -3131,6 +3136,951 @@ code *simpleops(code *c,regm_t scratch)
     return cstart;
 }
 
+/**************************************************************************
+ * Scheduling for out-of-order x86-64 CPUs.
+ * These decode several instructions a cycle and execute them as their
+ * operands become ready, so pairing rules do not matter. What does is
+ * starting long latency instructions, such as loads, as early as
+ * possible, and interleaving independent dependency chains. This is done
+ * with a list scheduler over runs of simple instructions, with jumps,
+ * calls, stack adjustments and anything it does not know about as
+ * barriers.
+ */
+
+// Cycles until the result of an instruction is ready, for one CPU family
+struct Latencies
+{
+    unsigned char alu;          // integer add, logic, shift
+    unsigned char imul;         // integer multiply
+    unsigned char idiv;         // integer divide
+    unsigned char load;         // load from L1 cache
+    unsigned char store;        // store forwarded to a load
+    unsigned char fadd;         // SSE add, compare and convert
+    unsigned char fmul;         // SSE and vector integer multiply
+    unsigned char fdiv;         // SSE divide and square root
+    unsigned char vec;          // SSE logic, shuffles and vector integer ops
+    unsigned char width;        // instructions issued per cycle
+};
+
+static const Latencies latgeneric = { 1, 3, 30, 4, 5, 3, 5, 20, 1, 3 };   // Core 2, K10
+static const Latencies latavx     = { 1, 3, 26, 5, 5, 3, 5, 14, 1, 4 };   // Sandy Bridge, Bulldozer
+static const Latencies latavx2    = { 1, 3, 24, 5, 5, 4, 4, 13, 1, 4 };   // Haswell, Zen and later
+
+enum
+{
+    LATmov,                     // a move, the latency is that of its load
+    LATalu,
+    LATimul,
+    LATidiv,
+    LATfadd,
+    LATfmul,
+    LATfdiv,
+    LATvec,
+};
+
+#define OOOMAX  64              // max instructions in a scheduling region
+
+// What an instruction reads and writes
+struct Oinfo
+{
+    code *c;                    // the instruction
+    code *cea;                  // the instruction with the memory operand
+    code *last;                 // last of the NOPs and line numbers following c
+    regm_t r;                   // registers read
+    regm_t w;                   // registers written
+    unsigned char flags;
+#define OIFLrflags      1       // reads the flags
+#define OIFLwflags      2       // writes the flags
+#define OIFLmread       4       // reads memory
+#define OIFLmwrite      8       // writes memory
+#define OIFLea          0x10    // memory is addressed by the EA
+#define OIFLlive        0x20    // the flags written are used
+    unsigned char lat;          // cycles until the result is ready
+    unsigned char msz;          // size of the memory operand
+    unsigned char base;         // base register of the EA, NOREG if none
+    unsigned char index;        // index register of the EA, NOREG if none
+    unsigned basever;           // number of writes to base in the region before c
+};
+
+// How the operands in the modregrm byte are used
+#define Or_reg  1               // reg is read
+#define Ow_reg  2               // reg is written
+#define Or_rm   4               // rm is read
+#define Ow_rm   8               // rm is written
+#define Ox_reg  0x10            // reg is an XMM register
+#define Ox_rm   0x20            // rm is an XMM register
+#define Ob_reg  0x40            // reg is a byte register
+#define Ob_rm   0x80            // rm is a byte register
+#define Ox      (Ox_reg | Ox_rm)
+#define Ob      (Ob_reg | Ob_rm)
+
+/*********************************
+ * Get mask of register r, which is a byte register if isbyte.
+ */
+
+STATIC regm_t ooo_regm(unsigned r, bool isbyte, unsigned rex)
+{
+    if (isbyte && !rex && r >= 4 && r < 8)
+        r -= 4;                 // AH, CH, DH, BH
+    return mask[r];
+}
+
+/*********************************
+ * Fill in oi for instruction c.
+ * Returns:
+ *      false if c cannot be moved
+ */
+
+STATIC bool ooo_getinfo(Oinfo *oi, code *c)
+{
+    memset(oi, 0, sizeof(Oinfo));
+    oi->c = c;
+    oi->cea = c;
+    oi->last = c;
+    oi->base = NOREG;
+    oi->index = NOREG;
+
+    if (c->Iflags & (CFtarg2 | CFvolatile | CFSEG | CFaddrsize | CFvex | CFclassinit | CFswitch))
+        return false;
+    if (c->IFL1 == FLcode || c->IFL1 == FLblock || c->IFL1 == FLswitch ||
+        c->IFL2 == FLcode || c->IFL2 == FLblock || c->IFL2 == FLswitch)
+        return false;
+
+    unsigned op = c->Iop;
+    unsigned rex = c->Irex;
+    unsigned irm = c->Irm;
+    unsigned mod = irm >> 6;
+    unsigned reg = ((irm >> 3) & 7) | (rex & REX_R ? 8 : 0);
+    unsigned rm = (irm & 7) | (rex & REX_B ? 8 : 0);
+    unsigned sz = (c->Iflags & CFopsize) ? 2 : (rex & REX_W) ? 8 : 4;
+    unsigned o = 0;             // Or_reg etc.
+    unsigned lat = LATalu;
+    unsigned msz = sz;
+    regm_t r = 0;
+    regm_t w = 0;
+    unsigned flags = 0;
+    bool ea = true;             // it has a modregrm byte
+
+    if (op < 0x40 && (op & 7) < 6)
+    {   // ADD OR ADC SBB AND SUB XOR CMP
+        unsigned kind = op >> 3;
+        switch (op & 7)
+        {
+            case 0: o = Or_rm | Or_reg | Ow_rm | Ob;   break;
+            case 1: o = Or_rm | Or_reg | Ow_rm;        break;
+            case 2: o = Or_reg | Or_rm | Ow_reg | Ob;  break;
+            case 3: o = Or_reg | Or_rm | Ow_reg;       break;
+            case 4: r = w = mAX; sz = 1; ea = false;   break;
+            case 5: r = w = mAX; ea = false;           break;
+        }
+        if (kind == 7)                          // CMP
+        {   o &= ~(Ow_reg | Ow_rm);
+            w = 0;
+        }
+        else if ((kind == 5 || kind == 6) && mod == 3 && reg == rm &&
+                 (op & 7) < 4)
+            o &= ~(Or_reg | Or_rm);             // SUB/XOR reg,reg is zero
+        if (kind == 2 || kind == 3)             // ADC, SBB
+            flags |= OIFLrflags;
+        flags |= OIFLwflags;
+    }
+    else if ((op & 0xFFFF00) == 0x000F00 ||
+             (op & 0xFFFF00) == 0x660F00 ||
+             (op & 0xFFFF00) == 0xF20F00 ||
+             (op & 0xFFFF00) == 0xF30F00)
+    {
+        unsigned pfx = op >> 16;                // 0, 0x66, 0xF2 or 0xF3
+        unsigned op2 = op & 0xFF;
+        bool scalar = pfx == 0xF2 || pfx == 0xF3;
+        msz = (c->Iflags & CFvexl) ? 32 : 16;
+        switch (op2)
+        {
+            // General register instructions
+            case 0x40: case 0x41: case 0x42: case 0x43:
+            case 0x44: case 0x45: case 0x46: case 0x47:
+            case 0x48: case 0x49: case 0x4A: case 0x4B:
+            case 0x4C: case 0x4D: case 0x4E: case 0x4F:   // CMOVcc
+                if (pfx)
+                    return false;
+                o = Or_rm | Or_reg | Ow_reg;
+                flags |= OIFLrflags;
+                msz = sz;
+                break;
+
+            case 0x90: case 0x91: case 0x92: case 0x93:
+            case 0x94: case 0x95: case 0x96: case 0x97:
+            case 0x98: case 0x99: case 0x9A: case 0x9B:
+            case 0x9C: case 0x9D: case 0x9E: case 0x9F:   // SETcc
+                if (pfx)
+                    return false;
+                o = Ow_rm | Ob_rm;
+                flags |= OIFLrflags;
+                msz = 1;
+                break;
+
+            case 0xAF:                          // IMUL reg,rm
+                if (pfx)
+                    return false;
+                o = Or_rm | Or_reg | Ow_reg;
+                flags |= OIFLwflags;
+                lat = LATimul;
+                msz = sz;
+                break;
+
+            case 0xB6: case 0xBE:               // MOVZX/MOVSX reg,rm8
+            case 0xB7: case 0xBF:               // MOVZX/MOVSX reg,rm16
+                if (pfx)
+                    return false;
+                o = Or_rm | Ow_reg;
+                if (!(op2 & 1))
+                    o |= Ob_rm;
+                lat = LATmov;
+                msz = (op2 & 1) ? 2 : 1;
+                break;
+
+            case 0xB8:                          // POPCNT
+            case 0xBC:                          // BSF, TZCNT
+            case 0xBD:                          // BSR, LZCNT
+                if (pfx == 0xF3)
+                    o = Or_rm | Ow_reg;
+                else if (!pfx && op2 != 0xB8)
+                    o = Or_rm | Or_reg | Ow_reg;        // unchanged if rm is 0
+                else
+                    return false;
+                flags |= OIFLwflags;
+                lat = LATimul;
+                msz = sz;
+                break;
+
+            case 0xC8: case 0xC9: case 0xCA: case 0xCB:
+            case 0xCC: case 0xCD: case 0xCE: case 0xCF:   // BSWAP
+                if (pfx)
+                    return false;
+                r = w = mask[(op2 & 7) | (rex & REX_B ? 8 : 0)];
+                ea = false;
+                break;
+
+            // SSE instructions
+            case 0x10:                          // MOVUPS, MOVUPD, MOVSS, MOVSD
+                if (scalar && mod == 3)
+                    o = Ox | Or_reg | Or_rm | Ow_reg;   // merges into reg
+                else
+                    o = Ox | Or_rm | Ow_reg;
+                lat = LATmov;
+                break;
+
+            case 0x11:
+                if (scalar && mod == 3)
+                    o = Ox | Or_reg | Or_rm | Ow_rm;
+                else
+                    o = Ox | Or_reg | Ow_rm;
+                lat = LATmov;
+                break;
+
+            case 0x28:                          // MOVAPS, MOVAPD
+            case 0x6F:                          // MOVDQA, MOVDQU
+                if (scalar && !(op2 == 0x6F && pfx == 0xF3) ||
+                    op2 == 0x6F && !pfx)
+                    return false;
+                o = Ox | Or_rm | Ow_reg;
+                lat = LATmov;
+                break;
+
+            case 0x29:
+            case 0x7F:
+                if (scalar && !(op2 == 0x7F && pfx == 0xF3) ||
+                    op2 == 0x7F && !pfx)
+                    return false;
+                o = Ox | Or_reg | Ow_rm;
+                lat = LATmov;
+                break;
+
+            case 0x6E:                          // MOVD/MOVQ xmm,rm
+                if (pfx != 0x66)
+                    return false;
+                o = Ox_reg | Or_rm | Ow_reg;
+                lat = LATvec;
+                msz = sz;
+                break;
+
+            case 0x7E:
+                if (pfx == 0x66)                // MOVD/MOVQ rm,xmm
+                {   o = Ox_reg | Or_reg | Ow_rm;
+                    msz = sz;
+                }
+                else if (pfx == 0xF3)           // MOVQ xmm,xmm/m64
+                    o = Ox | Or_rm | Ow_reg;
+                else
+                    return false;
+                lat = LATvec;
+                break;
+
+            case 0xD6:                          // MOVQ xmm/m64,xmm
+                if (pfx != 0x66)
+                    return false;
+                o = Ox | Or_reg | Ow_rm;
+                lat = LATvec;
+                break;
+
+            case 0x2A:                          // CVTSI2SS, CVTSI2SD
+                if (!scalar)
+                    return false;
+                o = Ox_reg | Or_rm | Or_reg | Ow_reg;
+                lat = LATfadd;
+                msz = sz;
+                break;
+
+            case 0x2C:                          // CVTTSS2SI, CVTTSD2SI
+            case 0x2D:                          // CVTSS2SI, CVTSD2SI
+                if (!scalar)
+                    return false;
+                o = Ox_rm | Or_rm | Ow_reg;
+                lat = LATfadd;
+                sz = (rex & REX_W) ? 8 : 4;
+                break;
+
+            case 0x2E:                          // UCOMISS, UCOMISD
+            case 0x2F:                          // COMISS, COMISD
+                if (scalar)
+                    return false;
+                o = Ox | Or_reg | Or_rm;
+                flags |= OIFLwflags;
+                lat = LATfadd;
+                break;
+
+            case 0x50:                          // MOVMSKPS, MOVMSKPD
+                if (scalar || mod != 3)
+                    return false;
+                o = Ox_rm | Or_rm | Ow_reg;
+                lat = LATvec;
+                sz = 4;
+                break;
+
+            case 0x51:                          // SQRT
+                o = scalar ? Ox | Or_reg | Or_rm | Ow_reg : Ox | Or_rm | Ow_reg;
+                lat = LATfdiv;
+                break;
+
+            case 0x54:                          // AND
+            case 0x55:                          // ANDN
+            case 0x56:                          // OR
+            case 0x57:                          // XOR
+            case 0x14:                          // UNPCKL
+            case 0x15:                          // UNPCKH
+            case 0xC6:                          // SHUF
+                if (scalar)
+                    return false;
+                o = Ox | Or_reg | Or_rm | Ow_reg;
+                if (op2 == 0x57 && mod == 3 && reg == rm)
+                    o &= ~(Or_reg | Or_rm);     // XOR reg,reg is zero
+                lat = LATvec;
+                break;
+
+            case 0x58:                          // ADD
+            case 0x5C:                          // SUB
+            case 0x5D:                          // MIN
+            case 0x5F:                          // MAX
+            case 0xC2:                          // CMP
+                o = Ox | Or_reg | Or_rm | Ow_reg;
+                lat = LATfadd;
+                break;
+
+            case 0x59:                          // MUL
+                o = Ox | Or_reg | Or_rm | Ow_reg;
+                lat = LATfmul;
+                break;
+
+            case 0x5E:                          // DIV
+                o = Ox | Or_reg | Or_rm | Ow_reg;
+                lat = LATfdiv;
+                break;
+
+            case 0x5A:                          // CVTPS2PD, CVTPD2PS, CVTSS2SD, CVTSD2SS
+                o = scalar ? Ox | Or_reg | Or_rm | Ow_reg : Ox | Or_rm | Ow_reg;
+                lat = LATfadd;
+                break;
+
+            case 0x5B:                          // CVTDQ2PS, CVTPS2DQ, CVTTPS2DQ
+                if (pfx == 0xF2)
+                    return false;
+                o = Ox | Or_rm | Ow_reg;
+                lat = LATfadd;
+                break;
+
+            case 0x70:                          // PSHUFD, PSHUFHW, PSHUFLW
+                if (!pfx)
+                    return false;
+                o = Ox | Or_rm | Ow_reg;
+                lat = LATvec;
+                break;
+
+            case 0x71:
+            case 0x72:
+            case 0x73:                          // PSLL, PSRL, PSRA by imm8
+                if (pfx != 0x66 || mod != 3)
+                    return false;
+                o = Ox_rm | Or_rm | Ow_rm;
+                lat = LATvec;
+                break;
+
+            case 0xD7:                          // PMOVMSKB
+                if (pfx != 0x66 || mod != 3)
+                    return false;
+                o = Ox_rm | Or_rm | Ow_reg;
+                lat = LATvec;
+                sz = 4;
+                break;
+
+            default:
+                // Integer vector operations PUNPCK, PACK, PCMP, PADD, PSUB,
+                // PAND, POR, PXOR, PMUL, PMIN, PMAX, and PSLL etc. by XMM
+                if (pfx != 0x66 ||
+                    !(op2 >= 0x60 && op2 <= 0x6D ||
+                      op2 >= 0x74 && op2 <= 0x76 ||
+                      op2 >= 0xD1 && op2 <= 0xFE &&
+                      op2 != 0xD6 && op2 != 0xD7 && op2 != 0xE6 && op2 != 0xE7 &&
+                      op2 != 0xF0 && op2 != 0xF7))
+                    return false;
+                o = Ox | Or_reg | Or_rm | Ow_reg;
+                if (op2 == 0xEF && mod == 3 && reg == rm)
+                    o &= ~(Or_reg | Or_rm);     // PXOR reg,reg is zero
+                lat = (op2 == 0xD5 || op2 == 0xE4 || op2 == 0xE5 ||
+                       op2 == 0xF4 || op2 == 0xF5) ? LATfmul : LATvec;
+                break;
+        }
+    }
+    else
+    {
+        switch (op)
+        {
+            case 0x80:
+            case 0x81:
+            case 0x83:                          // Grp 1 rm,imm
+                o = Or_rm | Ow_rm;
+                if (op == 0x80)
+                    o |= Ob_rm;
+                if (((irm >> 3) & 7) == 7)      // CMP
+                    o = Or_rm | (o & Ob_rm);
+                if (((irm >> 3) & 7) == 2 || ((irm >> 3) & 7) == 3)
+                    flags |= OIFLrflags;        // ADC, SBB
+                flags |= OIFLwflags;
+                break;
+
+            case 0x84:
+            case 0x85:                          // TEST rm,reg
+                o = Or_rm | Or_reg;
+                if (op == 0x84)
+                    o |= Ob;
+                flags |= OIFLwflags;
+                break;
+
+            case 0xA8:
+            case 0xA9:                          // TEST AL/EAX,imm
+                r = mAX;
+                flags |= OIFLwflags;
+                ea = false;
+                break;
+
+            case 0x88: o = Or_reg | Ow_rm | Ob;  lat = LATmov; break;
+            case 0x89: o = Or_reg | Ow_rm;       lat = LATmov; break;
+            case 0x8A: o = Or_rm | Ow_reg | Ob;  lat = LATmov; break;
+            case 0x8B: o = Or_rm | Ow_reg;       lat = LATmov; break;
+
+            case 0x63:                          // MOVSXD
+                o = Or_rm | Ow_reg;
+                lat = LATmov;
+                msz = 4;
+                break;
+
+            case LEA:
+                if (mod == 3)
+                    return false;
+                o = Ow_reg;                     // the EA registers are read below
+                break;
+
+            case 0xC6:
+            case 0xC7:                          // MOV rm,imm
+                if ((irm >> 3) & 7)
+                    return false;
+                o = Ow_rm;
+                if (op == 0xC6)
+                    o |= Ob_rm;
+                lat = LATmov;
+                break;
+
+            case 0xB0: case 0xB1: case 0xB2: case 0xB3:
+            case 0xB4: case 0xB5: case 0xB6: case 0xB7:   // MOV reg8,imm8
+                w = ooo_regm((op & 7) | (rex & REX_B ? 8 : 0), true, rex);
+                r = w;
+                ea = false;
+                break;
+
+            case 0xB8: case 0xB9: case 0xBA: case 0xBB:
+            case 0xBC: case 0xBD: case 0xBE: case 0xBF:   // MOV reg,imm
+                w = mask[(op & 7) | (rex & REX_B ? 8 : 0)];
+                if (sz == 2)
+                    r = w;
+                ea = false;
+                break;
+
+            case 0xC0:
+            case 0xC1:
+            case 0xD0:
+            case 0xD1:                          // Grp 2 rm,imm
+            case 0xD2:
+            case 0xD3:                          // Grp 2 rm,CL
+                if (((irm >> 3) & 7) == 6)
+                    return false;
+                o = Or_rm | Ow_rm;
+                if (!(op & 1))
+                    o |= Ob_rm;
+                if (op == 0xD2 || op == 0xD3)
+                    r = mCX;
+                // A 0 count leaves the flags alone
+                flags |= OIFLrflags | OIFLwflags;
+                break;
+
+            case 0xF6:
+            case 0xF7:                          // Grp 3
+                switch ((irm >> 3) & 7)
+                {
+                    case 0:                     // TEST rm,imm
+                        o = Or_rm;
+                        flags |= OIFLwflags;
+                        break;
+                    case 2:                     // NOT
+                        o = Or_rm | Ow_rm;
+                        break;
+                    case 3:                     // NEG
+                        o = Or_rm | Ow_rm;
+                        flags |= OIFLwflags;
+                        break;
+                    case 4:                     // MUL
+                    case 5:                     // IMUL
+                        o = Or_rm;
+                        r = mAX;
+                        w = (op == 0xF7) ? mAX | mDX : mAX;
+                        flags |= OIFLwflags;
+                        lat = LATimul;
+                        break;
+                    case 6:                     // DIV
+                    case 7:                     // IDIV
+                        o = Or_rm;
+                        r = w = (op == 0xF7) ? mAX | mDX : mAX;
+                        flags |= OIFLwflags;
+                        lat = LATidiv;
+                        break;
+                    default:
+                        return false;
+                }
+                if (op == 0xF6)
+                    o |= Ob_rm;
+                break;
+
+            case 0xFE:
+            case 0xFF:                          // INC, DEC
+                if (((irm >> 3) & 7) > 1)
+                    return false;
+                o = Or_rm | Ow_rm;
+                if (op == 0xFE)
+                    o |= Ob_rm;
+                flags |= OIFLrflags | OIFLwflags;       // CF is left alone
+                break;
+
+            case 0x98:                          // CBW, CWDE, CDQE
+                r = w = mAX;
+                ea = false;
+                break;
+
+            case 0x99:                          // CWD, CDQ, CQO
+                r = mAX;
+                w = mDX;
+                ea = false;
+                break;
+
+            case 0x69:
+            case 0x6B:                          // IMUL reg,rm,imm
+                o = Or_rm | Ow_reg;
+                flags |= OIFLwflags;
+                lat = LATimul;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    if (o & Ob_rm && !(o & Ox_rm))
+        msz = 1;
+
+    if (ea && (o & (Or_rm | Ow_rm) || op == LEA))
+    {
+        if (mod == 3)
+        {
+            regm_t m = (o & Ox_rm) ? mask[XMM0 + rm] : ooo_regm(rm, (o & Ob_rm) != 0, rex);
+            if (o & Or_rm)
+                r |= m;
+            if (o & Ow_rm)
+            {   w |= m;
+                if (!(o & Ox_rm) && (o & Ob_rm || sz == 2))
+                    r |= m;             // a partial write
+            }
+        }
+        else
+        {
+            unsigned base = rm;
+            unsigned index = NOREG;
+            if ((irm & 7) == 4)         // SIB byte
+            {
+                unsigned sib = c->Isib;
+                base = (sib & 7) | (rex & REX_B ? 8 : 0);
+                index = ((sib >> 3) & 7) | (rex & REX_X ? 8 : 0);
+                if (index == SP)
+                    index = NOREG;
+                if (mod == 0 && (sib & 7) == 5)
+                    base = NOREG;
+            }
+            else if (mod == 0 && (irm & 7) == 5)
+                base = NOREG;           // RIP relative
+            if (base != NOREG)
+                r |= mask[base];
+            if (index != NOREG)
+                r |= mask[index];
+            if (op != LEA)
+            {
+                oi->base = base;
+                oi->index = index;
+                flags |= OIFLea;
+                if (o & Or_rm)
+                    flags |= OIFLmread;
+                if (o & Ow_rm)
+                    flags |= OIFLmwrite;
+            }
+        }
+    }
+    if (o & (Or_reg | Ow_reg))
+    {
+        regm_t m = (o & Ox_reg) ? mask[XMM0 + reg] : ooo_regm(reg, (o & Ob_reg) != 0, rex);
+        if (o & Or_reg)
+            r |= m;
+        if (o & Ow_reg)
+        {   w |= m;
+            if (!(o & Ox_reg) && (o & Ob_reg || sz == 2))
+                r |= m;                 // a partial write
+        }
+    }
+
+    if (w & (mSP | mBP))
+        return false;
+
+    if (lat == LATidiv)
+    {   // It may fault, so keep it in order with all memory accesses
+        flags &= ~OIFLea;
+        flags |= OIFLmread | OIFLmwrite;
+    }
+
+    const Latencies *pl = config.avx >= 2 ? &latavx2 : config.avx ? &latavx : &latgeneric;
+    unsigned cycles;
+    switch (lat)
+    {
+        case LATmov:    cycles = pl->alu;   break;
+        case LATalu:    cycles = pl->alu;   break;
+        case LATimul:   cycles = pl->imul;  break;
+        case LATidiv:   cycles = pl->idiv;  break;
+        case LATfadd:   cycles = pl->fadd;  break;
+        case LATfmul:   cycles = pl->fmul;  break;
+        case LATfdiv:   cycles = pl->fdiv;  break;
+        case LATvec:    cycles = pl->vec;   break;
+        default:        assert(0);
+    }
+    if (flags & OIFLmread && flags & OIFLea)
+        cycles = (lat == LATmov) ? pl->load : pl->load + cycles;
+
+    oi->r = r;
+    oi->w = w;
+    oi->flags = flags;
+    oi->lat = cycles;
+    oi->msz = msz;
+    return true;
+}
+
+/*********************************
+ * Returns:
+ *      true if the memory accessed by a and b might overlap
+ */
+
+STATIC bool ooo_alias(Oinfo *a, Oinfo *b)
+{
+    if (!(a->flags & OIFLea) || !(b->flags & OIFLea))
+        return true;
+
+    code *ca = a->cea;
+    code *cb = b->cea;
+    bool framea = (a->base == SP || a->base == BP) && a->index == NOREG && ca->IFL1 == FLconst;
+    bool frameb = (b->base == SP || b->base == BP) && b->index == NOREG && cb->IFL1 == FLconst;
+
+    /* Variables in the stack frame whose address is never taken are only
+     * accessed directly
+     */
+    if (framea != frameb &&
+        (framea && ca->Iflags & CFunambig || frameb && cb->Iflags & CFunambig))
+        return false;
+
+    if (a->base != b->base || a->index != NOREG || b->index != NOREG)
+        return true;
+
+    targ_llong da, db;
+    if (a->base != NOREG)
+    {
+        if (a->basever != b->basever ||
+            ca->IFL1 != FLconst || cb->IFL1 != FLconst)
+            return true;
+        da = ca->IEVpointer1;
+        db = cb->IEVpointer1;
+    }
+    else if (ca->IFL1 == FLextern && cb->IFL1 == FLextern)
+    {
+        if (ca->IEVsym1 != cb->IEVsym1)
+            return false;               // different variables
+        da = ca->IEVoffset1;
+        db = cb->IEVoffset1;
+    }
+    else
+        return true;
+    return da < db + b->msz && db < da + a->msz;
+}
+
+/*********************************
+ * Reorder the n instructions in tbl[] and append them to *pctail.
+ * Returns:
+ *      new tail
+ */
+
+STATIC code **ooo_schedule(Oinfo *tbl, int n, code **pctail)
+{
+    const Latencies *pl = config.avx >= 2 ? &latavx2 : config.avx ? &latavx : &latgeneric;
+
+    /* Whether the flags written by each instruction are used. Assume
+     * they are used after the region, by a conditional jump for example.
+     */
+    bool live = true;
+    for (int i = n; i--;)
+    {   Oinfo *oi = &tbl[i];
+        if (oi->flags & OIFLwflags)
+        {
+            if (live)
+                oi->flags |= OIFLlive;
+            live = false;
+        }
+        if (oi->flags & OIFLrflags)
+            live = true;
+    }
+
+    /* Build the dependency graph. dep[j][i] is 1 + the number of cycles
+     * after j starts that i can start, 0 if i does not depend on j.
+     */
+    unsigned char dep[OOOMAX][OOOMAX];
+    memset(dep, 0, sizeof(dep));
+    for (int i = 0; i < n; i++)
+    {   Oinfo *oi = &tbl[i];
+        for (int j = 0; j < i; j++)
+        {   Oinfo *oj = &tbl[j];
+            int lat = -1;
+
+            if (oj->w & oi->r)
+                lat = oj->lat;                          // read after write
+            else if (oj->r & oi->w || oj->w & oi->w)
+                lat = 0;                                // write after read or write
+
+            if ((oj->flags & OIFLmwrite && oi->flags & (OIFLmread | OIFLmwrite) ||
+                 oj->flags & OIFLmread && oi->flags & OIFLmwrite) &&
+                ooo_alias(oj, oi))
+            {
+                int l = (oj->flags & OIFLmwrite && oi->flags & OIFLmread) ? pl->store : 0;
+                if (l > lat)
+                    lat = l;
+            }
+
+            /* Flags written that are not used only need to stay out of
+             * the way of those that are.
+             */
+            unsigned fj = oj->flags;
+            unsigned fi = oi->flags;
+            bool usej = fj & OIFLrflags || fj & OIFLlive;
+            bool usei = fi & OIFLrflags || fi & OIFLlive;
+            if (usej && usei)
+            {
+                if (fj & OIFLwflags && fi & OIFLrflags)
+                {   if (lat < 1)
+                        lat = 1;
+                }
+                else if (fj & OIFLrflags && fi & OIFLwflags ||
+                         fj & OIFLwflags && fi & OIFLwflags)
+                {   if (lat < 0)
+                        lat = 0;
+                }
+            }
+            else if (fj & OIFLwflags && !usej && fi & OIFLwflags && fi & OIFLlive ||
+                     fj & OIFLrflags && fi & OIFLwflags && !usei)
+            {   if (lat < 0)
+                    lat = 0;
+            }
+
+            if (lat >= 0)
+                dep[j][i] = lat + 1;
+        }
+    }
+
+    // Priority is the length of the longest path to the end of the region
+    unsigned height[OOOMAX];
+    for (int j = n; j--;)
+    {   unsigned h = tbl[j].lat;
+        for (int i = j + 1; i < n; i++)
+        {
+            if (dep[j][i] && dep[j][i] - 1 + height[i] > h)
+                h = dep[j][i] - 1 + height[i];
+        }
+        height[j] = h;
+    }
+
+    unsigned npred[OOOMAX];     // number of unscheduled predecessors
+    unsigned ready[OOOMAX];     // cycle when operands are ready
+    for (int i = 0; i < n; i++)
+    {   npred[i] = 0;
+        ready[i] = 0;
+        for (int j = 0; j < i; j++)
+            if (dep[j][i])
+                npred[i]++;
+    }
+
+    unsigned cycle = 0;
+    unsigned issued = 0;        // instructions issued in this cycle
+    for (int k = 0; k < n; k++)
+    {
+        // Pick the ready instruction with the longest path to the end
+        int best = -1;
+        while (1)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                if (npred[i] || ready[i] > cycle)
+                    continue;
+                if (best < 0 || height[i] > height[best])
+                    best = i;
+            }
+            if (best >= 0 && issued < pl->width)
+                break;
+            cycle++;            // nothing can start until the next cycle
+            issued = 0;
+            best = -1;
+        }
+
+        issued++;
+        npred[best] = ~0u;      // scheduled
+        ready[best] = ~0u;
+        for (int i = best + 1; i < n; i++)
+        {
+            if (dep[best][i])
+            {   npred[i]--;
+                if (cycle + dep[best][i] - 1 > ready[i])
+                    ready[i] = cycle + dep[best][i] - 1;
+            }
+        }
+
+#if DEBUG
+        if (debugs) { printf("cycle %d: ", cycle); tbl[best].c->print(); }
+#endif
+        *pctail = tbl[best].c;
+        pctail = &code_next(tbl[best].last);
+    }
+    *pctail = nullptr;
+    return pctail;
+}
+
+/*********************************
+ * Schedule code c for an out-of-order CPU.
+ * Returns:
+ *      scheduled code
+ */
+
+code *cgsched_ooo(code *c)
+{
+    code *cresult = nullptr;
+    code **pctail = &cresult;
+    Oinfo tbl[OOOMAX];
+
+    while (c)
+    {
+        // Gather a region of instructions that can be reordered
+        int n = 0;
+        unsigned ver[XMM0];     // number of writes to each register
+        memset(ver, 0, sizeof(ver));
+        while (c && n < OOOMAX)
+        {
+            if (n && c->Iflags & CFtarg)
+                break;
+            Oinfo *oi = &tbl[n];
+            if (!ooo_getinfo(oi, c))
+                break;
+            code *last = c;
+
+            /* With -mcpu=avx, cod3_vex() folds a register copy into the
+             * instruction after it, so keep the two together
+             */
+            Oinfo on;
+            if (config.avx && (c->Irm & 0xC0) == 0xC0 &&
+                (c->Iop == LODAPS || c->Iop == LODAPD || c->Iop == LODDQA ||
+                 c->Iop == LODUPS || c->Iop == LODUPD || c->Iop == LODDQU) &&
+                code_next(c) && !(code_next(c)->Iflags & CFtarg) &&
+                ooo_getinfo(&on, code_next(c)))
+            {
+                oi->r |= on.r & ~oi->w;
+                oi->w |= on.w;
+                oi->flags |= on.flags;
+                oi->lat += on.lat;
+                oi->msz = on.msz;
+                oi->base = on.base;
+                oi->index = on.index;
+                oi->cea = on.c;
+                last = on.c;
+            }
+
+            if (oi->base != NOREG)
+                oi->basever = ver[oi->base];
+            for (unsigned r = 0; r < XMM0; r++)
+                if (oi->w & mask[r])
+                    ver[r]++;
+
+            // NOPs and line numbers stay with the instruction they follow
+            while (code_next(last) &&
+                   !(code_next(last)->Iflags & (CFtarg | CFtarg2)) &&
+                   (code_next(last)->Iop == NOP ||
+                    code_next(last)->Iop == (ESCAPE | ESClinnum)))
+                last = code_next(last);
+            oi->last = last;
+            c = code_next(last);
+            n++;
+            if (oi->c->Iflags & CFtarg)
+                break;          // a jump target must stay first
+        }
+
+        if (n > 1)
+            pctail = ooo_schedule(tbl, n, pctail);
+        else if (n == 1)
+        {   *pctail = tbl[0].c;
+            pctail = &code_next(tbl[0].last);
+        }
+        else
+        {   // Just append this instruction to pctail and go to the next one
+            *pctail = c;
+            pctail = &code_next(c);
+            c = code_next(c);
+        }
+        *pctail = nullptr;
+    }
+    return cresult;
+}
+
 #if DEBUG
 static const char *fpops[] = {"fstp","fld","fop"};
 void Cinfo::print()
@@ -25,6 +25,10 @@ static char __file__[] = __FILE__;      /* for tassert.h                */
 
 unsigned xmmoperator(tym_t tym, unsigned oper);
 
+// from divcoeff.c
+extern bool choose_multiplier(int N, targ_ullong d, int prec, targ_ullong *pm, int *pshpost);
+extern bool udiv_coefficients(int N, targ_ullong d, int *pshpre, targ_ullong *pm, int *pshpost);
+
 /*******************************************
  * Is operator a store operator?
  */
@@ -41,6 +45,322 @@ bool isXMMstore(unsigned op)
     }
 }
 
+/*******************************************
+ * Size of the elements of vector type tym.
+ */
+
+static unsigned xmmelemsize(tym_t tym)
+{
+    switch (tybasic(tym))
+    {
+        case TYschar16: case TYuchar16: case TYschar32: case TYuchar32:
+            return 1;
+        case TYshort8:  case TYushort8: case TYshort16: case TYushort16:
+            return 2;
+        case TYfloat4:  case TYlong4:   case TYulong4:
+        case TYfloat8:  case TYlong8:   case TYulong8:
+            return 4;
+        case TYdouble2: case TYllong2:  case TYullong2:
+        case TYdouble4: case TYllong4:  case TYullong4:
+            return 8;
+        default:
+            assert(0);
+            return 0;
+    }
+}
+
+/*******************************************
+ * Create an integral vector of type tym with every element value.
+ */
+
+static elem *el_vecfill(tym_t tym, targ_ullong value)
+{
+    unsigned sz = xmmelemsize(tym);
+    if (sz < 8)
+        value &= (1ULL << (sz * 8)) - 1;
+    if (tysize(tym) == 32)
+    {
+        static const tym_t tyel[9] = { 0, TYschar, TYshort, 0, TYlong, 0, 0, 0, TYllong };
+        return el_una(OPvecfill, tym, el_long(tyel[sz], value));
+    }
+    for (unsigned i = sz; i < 8; i *= 2)
+        value |= value << (i * 8);
+    elem *e = el_calloc();
+    e->Eoper = OPconst;
+    e->Ety = tym;
+    e->EV.Vcent.lsw = value;
+    e->EV.Vcent.msw = value;
+    return e;
+}
+
+/*******************************************
+ * Is e the integral vector (x ^ ~0), i.e. (~x)?
+ */
+
+static bool isvecnot(elem *e)
+{
+    if (e->Eoper != OPxor || e->Ecount || !tyvector(e->Ety) || !tyintegral(e->Ety))
+        return false;
+    elem *ec = e->E2;
+    if (ec->Ecount)
+        return false;
+    if (ec->Eoper == OPconst)
+        return tysize(ec->Ety) == 16 &&
+               ec->EV.Vcent.lsw == ~0ULL && ec->EV.Vcent.msw == ~0ULL;
+    if (ec->Eoper == OPvecfill && ec->E1->Eoper == OPconst && !ec->E1->Ecount)
+    {
+        unsigned sz = tysize(ec->E1->Ety);
+        targ_ullong m = sz >= 8 ? ~0ULL : (1ULL << (sz * 8)) - 1;
+        return (el_tolong(ec->E1) & m) == m;
+    }
+    return false;
+}
+
+/*******************************************
+ * Build the vector compare (e1 op e2), op being one of OPeqeq, OPne,
+ * OPlt, OPle, OPgt or OPge, as an OPvector of the mask type tym: each
+ * element all ones where the compare is true, zero where it is false.
+ * Floats use the CMPPS/CMPPD predicates, which have no > or >=, and
+ * integers PCMPEQ and PCMPGT, complemented for != <= and >=. Unsigned
+ * integers are compared as signed with their sign bits flipped.
+ */
+
+elem *el_vectorcmp(unsigned op, tym_t tym, elem *e1, elem *e2)
+{
+    tym_t ty = tybasic(e1->Ety);
+    unsigned sz = xmmelemsize(ty);
+    bool swap = false;
+    bool complement = false;
+    unsigned xop;
+    int pred = -1;
+
+    if (tyfloating(ty))
+    {
+        xop = sz == 4 ? CMPPS : CMPPD;
+        switch (op)
+        {
+            case OPeqeq:    pred = 0;                       break;
+            case OPlt:      pred = 1;                       break;
+            case OPle:      pred = 2;                       break;
+            case OPne:      pred = 4;                       break;
+            case OPgt:      pred = 1;   swap = true;        break;
+            case OPge:      pred = 2;   swap = true;        break;
+            default:        assert(0);
+        }
+    }
+    else
+    {
+        static const unsigned pcmpeq[9] = { 0, PCMPEQB, PCMPEQW, 0, PCMPEQD, 0, 0, 0, PCMPEQQ };
+        static const unsigned pcmpgt[9] = { 0, PCMPGTB, PCMPGTW, 0, PCMPGTD, 0, 0, 0, PCMPGTQ };
+        switch (op)
+        {
+            case OPeqeq:    xop = pcmpeq[sz];                               break;
+            case OPne:      xop = pcmpeq[sz];   complement = true;          break;
+            case OPgt:      xop = pcmpgt[sz];                               break;
+            case OPlt:      xop = pcmpgt[sz];   swap = true;                break;
+            case OPle:      xop = pcmpgt[sz];   complement = true;          break;
+            case OPge:      xop = pcmpgt[sz];   swap = complement = true;   break;
+            default:        assert(0);
+        }
+        if (tyuns(ty) && op != OPeqeq && op != OPne)
+        {
+            targ_ullong signbit = 1ULL << (sz * 8 - 1);
+            e1 = el_bin(OPxor, ty, e1, el_vecfill(ty, signbit));
+            e2 = el_bin(OPxor, ty, e2, el_vecfill(ty, signbit));
+        }
+    }
+
+    elem *ec = nullptr;
+    if (swap)
+    {
+        if (el_sideeffect(e2))
+        {   // keep e1 evaluated first
+            elem *et = el_copytotmp(&e1);
+            ec = e1;
+            e1 = et;
+        }
+        elem *et = e1;
+        e1 = e2;
+        e2 = et;
+    }
+
+    elem *ep = el_param(el_param(el_long(TYint, xop), e1), e2);
+    if (pred >= 0)
+        ep = el_param(ep, el_long(TYuchar, pred));
+    elem *e = el_una(OPvector, tym, ep);
+    if (complement)
+        e = el_bin(OPxor, tym, e, el_vecfill(tym, ~0ULL));
+    return el_combine(ec, e);
+}
+
+/*******************************************
+ * Build the vector shift (e1 op e2), op being one of OPshl, OPshr or
+ * OPashr, as an OPvector of type tym. A constant count is an immediate,
+ * any other scalar count is moved into the low bits of an XMM register
+ * with MOVD, and a vector of counts uses the AVX2 VPSLLV, VPSRLV and VPSRAVD.
+ */
+
+elem *el_vectorshift(unsigned op, tym_t tym, elem *e1, elem *e2)
+{
+    unsigned sz = xmmelemsize(tym);
+    unsigned xop;
+    if (tyvector(e2->Ety))
+    {
+        assert(sz >= 4);
+        switch (op)
+        {
+            case OPshl:     xop = VPSLLVD;  break;
+            case OPshr:     xop = VPSRLVD;  break;
+            case OPashr:    xop = VPSRAVD;  assert(sz == 4);    break;
+            default:        assert(0);
+        }
+    }
+    else
+    {
+        static const unsigned psll[9] = { 0, 0, PSLLW, 0, PSLLD, 0, 0, 0, PSLLQ };
+        static const unsigned psrl[9] = { 0, 0, PSRLW, 0, PSRLD, 0, 0, 0, PSRLQ };
+        static const unsigned psra[9] = { 0, 0, PSRAW, 0, PSRAD, 0, 0, 0, 0 };
+        switch (op)
+        {
+            case OPshl:     xop = psll[sz]; break;
+            case OPshr:     xop = psrl[sz]; break;
+            case OPashr:    xop = psra[sz]; break;
+            default:        assert(0);
+        }
+        assert(xop);
+        if (e2->Eoper == OPconst && (targ_ullong)el_tolong(e2) < sz * 8)
+        {
+            targ_llong n = el_tolong(e2);
+            el_free(e2);
+            e2 = el_long(TYuchar, n);
+        }
+        else
+        {
+            if (tysize(e2->Ety) != 4)
+                e2 = el_una(OP64_32, TYint, e2);
+            e2 = el_una(OPvector, TYlong4, el_param(el_long(TYint, LODD), e2));
+        }
+    }
+    return el_una(OPvector, tym, el_param(el_param(el_long(TYint, xop), e1), e2));
+}
+
+/*******************************************
+ * Build the vector operation (e1 xop e2) as an OPvector of type tym.
+ */
+
+static elem *el_vectorop(unsigned xop, tym_t tym, elem *e1, elem *e2)
+{
+    return el_una(OPvector, tym, el_param(el_param(el_long(TYint, xop), e1), e2));
+}
+
+/*******************************************
+ * Build the integer vector (e1 op d), op being OPdiv or OPmod, for a
+ * nonzero constant d that is the same in every element, as a tree of
+ * type tym. There is no vector divide instruction, so it is done like
+ * cdmul() does a scalar divide by a constant, multiplying by the factor
+ * from divcoeff.cpp and keeping the high half with PMULHW or PMULHUW.
+ * Only 16 bit elements are done; 32 bit ones would need the high halves
+ * pieced together from PMULUDQ/PMULDQ on the even and odd lanes, which
+ * is left for when there is a use for it.
+ */
+
+elem *el_vectordiv(unsigned op, tym_t tym, elem *e1, targ_llong d)
+{
+    assert(xmmelemsize(tym) == 2);
+    const int N = 16;
+    bool uns = tyuns(tym) != 0;
+    d = uns ? (targ_llong)(targ_ushort)d : (targ_llong)(targ_short)d;
+    assert(d);
+    targ_ullong ad = d < 0 ? -d : d;
+    int k = ispow2(ad);
+
+    // e1 is used more than once, so evaluate it once into a temporary
+    elem *ec = nullptr;
+    if (e1->Eoper != OPvar)
+    {
+        elem *et = el_copytotmp(&e1);
+        ec = e1;
+        e1 = et;
+    }
+
+    elem *q;
+    if (uns && k != -1)
+    {
+        if (op == OPmod)            // x & (d - 1)
+            return el_combine(ec, el_bin(OPand, tym, e1, el_vecfill(tym, ad - 1)));
+        q = k ? el_vectorshift(OPshr, tym, el_copytree(e1), el_long(TYint, k))
+              : el_copytree(e1);
+    }
+    else if (uns)
+    {
+        targ_ullong m;
+        int shpre;
+        int shpost;
+        if (udiv_coefficients(N, ad, &shpre, &m, &shpost))
+        {   /* t1 = MULUH(m, x)
+             * q = SRL(t1 + SRL(x - t1, 1), shpost - 1)
+             */
+            elem *t1 = el_vectorop(PMULHUW, tym, el_copytree(e1), el_vecfill(tym, m));
+            elem *et1 = el_copytotmp(&t1);
+            ec = el_combine(ec, t1);
+            q = el_bin(OPmin, tym, el_copytree(e1), el_copytree(et1));
+            q = el_vectorshift(OPshr, tym, q, el_long(TYint, 1));
+            q = el_bin(OPadd, tym, q, et1);
+            if (shpost > 1)
+                q = el_vectorshift(OPshr, tym, q, el_long(TYint, shpost - 1));
+        }
+        else
+        {   // q = SRL(MULUH(m, SRL(x, shpre)), shpost)
+            q = el_copytree(e1);
+            if (shpre)
+                q = el_vectorshift(OPshr, tym, q, el_long(TYint, shpre));
+            q = el_vectorop(PMULHUW, tym, q, el_vecfill(tym, m));
+            if (shpost)
+                q = el_vectorshift(OPshr, tym, q, el_long(TYint, shpost));
+        }
+    }
+    else if (ad == 1)
+        q = el_copytree(e1);
+    else if (k != -1)
+    {   /* Round towards 0 by adding d-1 to negative values first
+         * q = SRA(x + SRL(SRA(x, N - 1), N - k), k)
+         */
+        q = el_vectorshift(OPashr, tym, el_copytree(e1), el_long(TYint, N - 1));
+        q = el_vectorshift(OPshr, tym, q, el_long(TYint, N - k));
+        q = el_bin(OPadd, tym, el_copytree(e1), q);
+        q = el_vectorshift(OPashr, tym, q, el_long(TYint, k));
+    }
+    else
+    {   /* Algorithm 5.2
+         * if m>=2**(N-1)
+         *    q = SRA(x + MULSH(m-2**N,x), shpost) - XSIGN(x)
+         * else
+         *    q = SRA(MULSH(m,x), shpost) - XSIGN(x)
+         */
+        targ_ullong m;
+        int shpost;
+        bool mhighbit = choose_multiplier(N, ad, N - 1, &m, &shpost);
+        q = el_vectorop(PMULHW, tym, el_copytree(e1), el_vecfill(tym, m));
+        if (mhighbit || m >= (1ULL << (N - 1)))
+            q = el_bin(OPadd, tym, q, el_copytree(e1));
+        if (shpost)
+            q = el_vectorshift(OPashr, tym, q, el_long(TYint, shpost));
+        // subtracting XSIGN(x), which is -1 or 0, adds the sign bit
+        q = el_bin(OPadd, tym, q, el_vectorshift(OPshr, tym, el_copytree(e1), el_long(TYint, N - 1)));
+    }
+    if (d < 0)
+        q = el_bin(OPmin, tym, el_vecfill(tym, 0), q);
+
+    if (op == OPmod)
+    {   // x - q * d
+        q = el_bin(OPmin, tym, el_copytree(e1), el_bin(OPmul, tym, q, el_vecfill(tym, d)));
+    }
+    else
+        assert(op == OPdiv);
+    el_free(e1);
+    return el_combine(ec, q);
+}
+
 /*******************************************
  * Move constant value into xmm register xreg.
  */
@@ -90,6 +410,41 @@ code *movxmmconst(unsigned xreg, unsigned sz, targ_size_t value, regm_t flags)
 code *orthxmm(elem *e, regm_t *pretregs)
 {   elem *e1 = e->E1;
     elem *e2 = e->E2;
+
+    /* (~x & y) is PANDN; with PAND and POR it selects between two
+     * vectors by a mask from a vector compare.
+     */
+    if (e->Eoper == OPand && isvecnot(e2) && !isvecnot(e1))
+    {
+        e->E1 = e2;
+        e->E2 = e1;
+        e1 = e->E1;
+        e2 = e->E2;
+    }
+    if (e->Eoper == OPand && isvecnot(e1))
+    {
+        elem *ec = e1->E2;
+        if (ec->Eoper == OPvecfill)
+            freenode(ec->E1);
+        freenode(ec);
+        freenode(e1);
+        e1 = e1->E1;
+        regm_t retregs = *pretregs & XMMREGS;
+        if (!retregs)
+            retregs = XMMREGS;
+        code *c = codelem(e1,&retregs,FALSE);
+        unsigned reg = findreg(retregs);
+        regm_t rretregs = XMMREGS & ~retregs;
+        code *cr = scodelem(e2, &rretregs, retregs, TRUE);
+        unsigned rreg = findreg(rretregs);
+        code *cg = getregs(retregs);
+        code *co = gen2(CNIL,PANDN,modregxrmx(3,reg-XMM0,rreg-XMM0));
+        co = checkSetVexL(co, e->Ety);
+        if (retregs != *pretregs)
+            co = cat(co,fixresult(e,retregs,pretregs));
+        return cat4(c,cr,cg,co);
+    }
+
     regm_t retregs = *pretregs & XMMREGS;
     if (!retregs)
         retregs = XMMREGS;
@@ -142,6 +497,7 @@ code *orthxmm(elem *e, regm_t *pretregs)
         cg = getregs(retregs);
 
     code *co = gen2(CNIL,op,modregxrmx(3,reg-XMM0,rreg-XMM0));
+    co = checkSetVexL(co, e1->Ety);
     if (retregs != *pretregs)
         co = cat(co,fixresult(e,retregs,pretregs));
 
@@ -222,7 +578,10 @@ code *xmmeq(elem *e, unsigned op, elem *e1, elem *e2,regm_t *pretregs)
 
     // Do not generate mov from register onto itself
     if (!(regvar && reg == XMM0 + ((cs.Irm & 7) | (cs.Irex & REX_B ? 8 : 0))))
+    {
         c = gen(c,&cs);         // MOV EA+offset,reg
+        c = checkSetVexL(c, tyml);
+    }
 
     if (e1->Ecount ||                     // if lvalue is a CSE or
         regvar)                           // rvalue can't be a CSE
@@ -444,15 +803,18 @@ code *xmmopass(elem *e,regm_t *pretregs)
         cs.Iop = xmmload(ty1);                  // MOVSD xmm,xmm_m64
         code_newreg(&cs,reg - XMM0);
         cg = gen(cg,&cs);
+        cg = checkSetVexL(cg, ty1);
     }
 
     unsigned op = xmmoperator(e1->Ety, e->Eoper);
     code *co = gen2(CNIL,op,modregxrmx(3,reg-XMM0,rreg-XMM0));
+    co = checkSetVexL(co, ty1);
 
     if (!regvar)
     {
         cs.Iop = xmmstore(ty1);           // reverse operand order of MOVS[SD]
-        gen(co,&cs);
+        co = gen(co,&cs);
+        co = checkSetVexL(co, ty1);
     }
 
     if (e1->Ecount ||                     // if lvalue is a CSE or
@@ -542,6 +904,18 @@ unsigned xmmload(tym_t tym)
         case TYllong2:
         case TYullong2: op = LODDQA; break;      // MOVDQA
 
+        // 256 bit vectors are only 16 byte aligned on the stack
+        case TYfloat8:  op = LODUPS; break;      // VMOVUPS
+        case TYdouble4: op = LODUPD; break;      // VMOVUPD
+        case TYschar32:
+        case TYuchar32:
+        case TYshort16:
+        case TYushort16:
+        case TYlong8:
+        case TYulong8:
+        case TYllong4:
+        case TYullong4: op = LODDQU; break;      // VMOVDQU
+
         default:
             printf("tym = x%x\n", tym);
             assert(0);
@@ -581,6 +955,17 @@ unsigned xmmstore(tym_t tym)
         case TYllong2:
         case TYullong2: op = STODQA; break;      // MOVDQA
 
+        case TYfloat8:  op = STOUPS; break;      // VMOVUPS
+        case TYdouble4: op = STOUPD; break;      // VMOVUPD
+        case TYschar32:
+        case TYuchar32:
+        case TYshort16:
+        case TYushort16:
+        case TYlong8:
+        case TYulong8:
+        case TYllong4:
+        case TYullong4: op = STODQU; break;      // VMOVDQU
+
         default:
             printf("tym = x%x\n", tym);
             assert(0);
@@ -588,6 +973,22 @@ unsigned xmmstore(tym_t tym)
     return op;
 }
 
+/*****************************
+ * If tym is a 256 bit vector type, mark the last instruction of c,
+ * which operates on a tym, to be VEX encoded with VEX.L set so that
+ * it uses the whole YMM register.
+ */
+
+code *checkSetVexL(code *c, tym_t tym)
+{
+    if (c && tysize(tym) == 32)
+    {
+        assert(config.avx);
+        code_last(c)->Iflags |= CFvexl;
+    }
+    return c;
+}
+
 /************************************
  * Get correct XMM operator based on type and operator.
  */
@@ -619,6 +1020,17 @@ unsigned xmmoperator(tym_t tym, unsigned oper)
                 case TYllong2:
                 case TYullong2: op = PADDQ;  break;
 
+                case TYfloat8:  op = ADDPS;  break;
+                case TYdouble4: op = ADDPD;  break;
+                case TYschar32:
+                case TYuchar32: op = PADDB;  break;
+                case TYshort16:
+                case TYushort16: op = PADDW; break;
+                case TYlong8:
+                case TYulong8:  op = PADDD;  break;
+                case TYllong4:
+                case TYullong4: op = PADDQ;  break;
+
                 default:        assert(0);
             }
             break;
@@ -644,6 +1056,17 @@ unsigned xmmoperator(tym_t tym, unsigned oper)
                 case TYllong2:
                 case TYullong2: op = PSUBQ;  break;
 
+                case TYfloat8:  op = SUBPS;  break;
+                case TYdouble4: op = SUBPD;  break;
+                case TYschar32:
+                case TYuchar32: op = PSUBB;  break;
+                case TYshort16:
+                case TYushort16: op = PSUBW; break;
+                case TYlong8:
+                case TYulong8:  op = PSUBD;  break;
+                case TYllong4:
+                case TYullong4: op = PSUBQ;  break;
+
                 default:        assert(0);
             }
             break;
@@ -663,6 +1086,11 @@ unsigned xmmoperator(tym_t tym, unsigned oper)
                 case TYshort8:
                 case TYushort8: op = PMULLW; break;
 
+                case TYfloat8:  op = MULPS;  break;
+                case TYdouble4: op = MULPD;  break;
+                case TYshort16:
+                case TYushort16: op = PMULLW; break;
+
                 default:        assert(0);
             }
             break;
@@ -680,6 +1108,9 @@ unsigned xmmoperator(tym_t tym, unsigned oper)
                 case TYfloat4:  op = DIVPS;  break;
                 case TYdouble2: op = DIVPD;  break;
 
+                case TYfloat8:  op = DIVPS;  break;
+                case TYdouble4: op = DIVPD;  break;
+
                 default:        assert(0);
             }
             break;
@@ -696,7 +1127,15 @@ unsigned xmmoperator(tym_t tym, unsigned oper)
                 case TYlong4:
                 case TYulong4:
                 case TYllong2:
-                case TYullong2: op = POR; break;
+                case TYullong2:
+                case TYschar32:
+                case TYuchar32:
+                case TYshort16:
+                case TYushort16:
+                case TYlong8:
+                case TYulong8:
+                case TYllong4:
+                case TYullong4: op = POR; break;
 
                 default:        assert(0);
             }
@@ -714,7 +1153,15 @@ unsigned xmmoperator(tym_t tym, unsigned oper)
                 case TYlong4:
                 case TYulong4:
                 case TYllong2:
-                case TYullong2: op = PAND; break;
+                case TYullong2:
+                case TYschar32:
+                case TYuchar32:
+                case TYshort16:
+                case TYushort16:
+                case TYlong8:
+                case TYulong8:
+                case TYllong4:
+                case TYullong4: op = PAND; break;
 
                 default:        assert(0);
             }
@@ -732,7 +1179,15 @@ unsigned xmmoperator(tym_t tym, unsigned oper)
                 case TYlong4:
                 case TYulong4:
                 case TYllong2:
-                case TYullong2: op = PXOR; break;
+                case TYullong2:
+                case TYschar32:
+                case TYuchar32:
+                case TYshort16:
+                case TYushort16:
+                case TYlong8:
+                case TYulong8:
+                case TYllong4:
+                case TYullong4: op = PXOR; break;
 
                 default:        assert(0);
             }
@@ -868,6 +1323,7 @@ code *cdvector(elem *e, regm_t *pretregs)
         cr = CNIL;
         cg = getregs(retregs);
         co = genc2(CNIL,op,modregrmx(3,r,reg-XMM0), el_tolong(op2));
+        co = checkSetVexL(co, e->Ety);
     }
     else if (n == 2)
     {   /* Handle: op xmm,mem
@@ -879,6 +1335,17 @@ code *cdvector(elem *e, regm_t *pretregs)
         {
             c = getlvalue(&cs, op1, RMload);     // get addressing mode
         }
+        else if (op == LODD)
+        {   // MOVD xmm,reg
+            regm_t rretregs = ALLREGS;
+            c = codelem(op1, &rretregs, FALSE);
+            unsigned rreg = findreg(rretregs);
+            cs.Irm = modregrm(3,0,rreg & 7);
+            cs.Iflags = 0;
+            cs.Irex = 0;
+            if (rreg & 8)
+                cs.Irex |= REX_B;
+        }
         else
         {
             regm_t rretregs = XMMREGS;
@@ -900,6 +1367,7 @@ code *cdvector(elem *e, regm_t *pretregs)
         code_newreg(&cs, reg - XMM0);
         cs.Iop = op;
         co = gen(CNIL,&cs);
+        co = checkSetVexL(co, e->Ety);
     }
     else if (n == 3 || n == 4)
     {   /* Handle:
@@ -953,9 +1421,12 @@ code *cdvector(elem *e, regm_t *pretregs)
             cs.IFL2 = FLconst;
             cs.IEV2.Vsize_t = el_tolong(imm8);
         }
+        if ((op == VPSLLVD || op == VPSRLVD) && xmmelemsize(ty1) == 8)
+            cs.Irex |= REX_W;           // VPSLLVQ, VPSRLVQ
         code_newreg(&cs, reg - XMM0);
         cs.Iop = op;
         co = gen(CNIL,&cs);
+        co = checkSetVexL(co, e->Ety);
     }
     else
         assert(0);
@@ -1139,6 +1610,41 @@ code *cdvecfill(elem *e, regm_t *pretregs)
             break;
         }
 
+        case TYfloat8:
+        case TYdouble4:
+        case TYschar32:
+        case TYuchar32:
+        case TYshort16:
+        case TYushort16:
+        case TYlong8:
+        case TYulong8:
+        case TYllong4:
+        case TYullong4:
+        {
+            /* Fill the low 128 bits as for the 128 bit vector type,
+             * the 32 byte types being in the same order, then:
+             *    VINSERTF128 YMM0,YMM0,XMM0,1
+             */
+            tym_t ty = e->Ety;
+            e->Ety = tybasic(ty) - (TYfloat8 - TYfloat4);
+            cdb.append(cdvecfill(e, &retregs));
+            e->Ety = ty;
+            reg = findreg(retregs) - XMM0;
+
+            cs.Iop = VINSERTF128;
+            cs.Irm = modregxrmx(3,reg,reg);
+            cs.Iflags = CFvexl;
+            cs.Irex = 0;
+            if (reg & 8)
+                cs.Irex |= REX_R | REX_B;
+            cs.IFL2 = FLconst;
+            cs.IEV2.Vsize_t = 1;
+            code *ci = gen(CNIL,&cs);
+            checkSetVex(ci, reg);
+            cdb.append(ci);
+            break;
+        }
+
         default:
             assert(0);
     }
@@ -36,7 +36,7 @@ enum MF
 code * genf2(code *c,unsigned op,unsigned rm);
 
 targ_size_t paramsize(elem *e);
-STATIC code *funccall(elem *,unsigned,unsigned,regm_t *,regm_t,bool);
+STATIC code *funccall(elem *,unsigned,unsigned,regm_t *,regm_t,bool,bool);
 static code *movParams(elem *e,unsigned stackalign, unsigned funcargtos);
 
 /* array to convert from index register to r/m field    */
@@ -1147,7 +1147,11 @@ code *getlvalue(code *pcs,elem *e,regm_t keepmsk)
                          * in Win64 shadow regs and we're offsetting to get to the start
                          * of the variadic args.
                          */
-                        if (preg != NOREG && regcon.params & mask[preg])
+                        /* The low half of a vector passed in an XMM register
+                         * can't be used by an instruction on general registers.
+                         */
+                        if (preg != NOREG && regcon.params & mask[preg] &&
+                            !(mask[preg] & XMMREGS && !tyxmmreg(ty)))
                         {
                             pcs->Irm = modregrm(3,0,preg & 7);
                             if (preg & 8)
@@ -1562,13 +1566,16 @@ code *fixresult(elem *e,regm_t retregs,regm_t *pretregs)
             if (retregs & XMMREGS)
             {
                 reg = findreg(retregs & XMMREGS);
-                // MOVSD floatreg, XMM?
-                ce = genfltreg(ce,xmmstore(tym),reg - XMM0,0);
                 if (mask[rreg] & XMMREGS)
-                    // MOVSD XMM?, floatreg
-                    ce = genfltreg(ce,xmmload(tym),rreg - XMM0,0);
+                {
+                    // MOVAPS XMM?, XMM?
+                    ce = gen2(ce,LODAPS,modregxrmx(3,rreg - XMM0,reg - XMM0));
+                    ce = checkSetVexL(ce, tym);
+                }
                 else
                 {
+                    // MOVSD floatreg, XMM?
+                    ce = genfltreg(ce,xmmstore(tym),reg - XMM0,0);
                     // MOV rreg,floatreg
                     ce = genfltreg(ce,0x8B,rreg,0);
                     if (sz == 8)
@@ -2564,6 +2571,7 @@ code *cdfunc(elem *e,regm_t *pretregs)
     // Figure out which parameters go in registers.
     // Compute numpara, the total bytes pushed on the stack
     FuncParamRegs fpr(tyf);
+    bool ymmargs = false;               // some go in YMM registers
     for (int i = np; --i >= 0;)
     {
         elem *ep = parameters[i].e;
@@ -2572,6 +2580,8 @@ code *cdfunc(elem *e,regm_t *pretregs)
         //printf("[%d] size = %u, numpara = %d ", i, psize, numpara); WRTYxx(ep->Ety); printf("\n");
         if (fpr.alloc(ep->ET, ep->Ety, &parameters[i].reg, &parameters[i].reg2))
         {
+            if (tyvector(ep->Ety) && tysize(ep->Ety) == 32)
+                ymmargs = true;
             continue;   // goes in register, not stack
         }
 
@@ -2796,6 +2806,7 @@ code *cdfunc(elem *e,regm_t *pretregs)
                             if (mask[preg] & XMMREGS)
                             {   unsigned op = xmmload(ty1);            // MOVSS/D preg,lreg
                                 c1 = gen2(c1,op,modregxrmx(3,preg-XMM0,lreg-XMM0));
+                                c1 = checkSetVexL(c1, ty1);
                             }
                             else
                                 c1 = genmovreg(c1, preg, lreg);
@@ -2808,6 +2819,7 @@ code *cdfunc(elem *e,regm_t *pretregs)
                             if (mask[preg2] & XMMREGS)
                             {   unsigned op = xmmload(ty2);            // MOVSS/D preg2,mreg
                                 c1 = gen2(c1,op,modregxrmx(3,preg2-XMM0,mreg-XMM0));
+                                c1 = checkSetVexL(c1, ty2);
                             }
                             else
                                 c1 = genmovreg(c1, preg2, mreg);
@@ -2864,11 +2876,96 @@ code *cdfunc(elem *e,regm_t *pretregs)
 #endif
     assert(usefuncarg || numpara == stackpush - stackpushsave);
 
-    c = cat(c,funccall(e,numpara,numalign,pretregs,keepmsk,usefuncarg));
+    c = cat(c,funccall(e,numpara,numalign,pretregs,keepmsk,usefuncarg,ymmargs));
     cgstate.funcargtos = funcargtossave;
     return c;
 }
 
+/***********************************
+ * Determine if function call e, the last thing done by a return block,
+ * can be done by a JMP from the epilog rather than by a CALL followed
+ * by a RET. It can if all the arguments go in registers, so the callee
+ * doesn't need any of the caller's stack once the epilog pops the frame.
+ * Marks e with EFLAGS_tailcall if so.
+ * Input:
+ *      retregs = registers the caller returns its value in, 0 if none
+ * Returns:
+ *      function the epilog is to jump to, nullptr if the call stays a call
+ */
+
+static void tailcallParams(elem *e, elem **params, int *pi)
+{
+    if (e->Eoper == OPparam)
+    {
+        tailcallParams(e->E1, params, pi);
+        tailcallParams(e->E2, params, pi);
+    }
+    else
+        params[(*pi)++] = e;
+}
+
+Symbol *tailcall(elem *e, regm_t retregs)
+{
+    e->Eflags &= ~EFLAGS_tailcall;
+    if (!anytailcalls ||
+        !OTcall(e->Eoper) ||
+        e->Ecount ||
+        e->E1->Eoper != OPvar ||
+        e->E1->EV.sp.Voffset ||
+        e->Eflags & EFLAGS_variadic ||
+        stackpush)
+        return nullptr;
+
+    Symbol *s = e->E1->EV.sp.Vsym;
+    tym_t tyf = tybasic(e->E1->Ety);
+    if (!tyfunc(s->ty()) ||
+        sytab[s->Sclass] & SCSS ||
+        s->Sflags & SFLexit ||
+        s == tls_get_addr_sym ||
+        strcmp(s->Sident,"alloca") == 0 ||
+        typfunc(tyf) || tyf == TYhfunc || tyf == TYifunc || tyfarfunc(tyf))
+        return nullptr;
+
+    // The callee's return value must already be where the caller returns it
+    regm_t calleeregs = regmask(e->Ety, tyf);
+    if (tybasic(e->Ety) == TYstruct ||
+        calleeregs & (mST0 | mST01) ||
+        retregs && calleeregs != retregs)
+        return nullptr;
+
+    if (OTbinary(e->Eoper))
+    {
+        int np = el_nparams(e->E2);
+        elem **params = (elem **)alloca(np * sizeof(elem *));
+        int n = 0;
+        tailcallParams(e->E2, params, &n);
+        assert(n == np);
+
+        // Same order cdfunc() allocates them in
+        FuncParamRegs fpr(tyf);
+        for (int i = np; --i >= 0;)
+        {
+            elem *ep = params[i];
+            unsigned char reg, reg2;
+            /* Static arrays, which are passed as TYarray or as a 128 bit
+             * integer, may be looked for on the stack by the callee
+             */
+            tym_t typ = tybasic(ep->Ety);
+            if (ep->Eoper == OPstrthis ||
+                typ == TYarray || typ == TYcent || typ == TYucent ||
+                !fpr.alloc(ep->ET, ep->Ety, &reg, &reg2))
+                return nullptr;
+
+            // The VZEROUPPER before the JMP would clear half of a YMM argument
+            if (config.avx && tyvector(typ) && tysize(typ) == 32)
+                return nullptr;
+        }
+    }
+
+    e->Eflags |= EFLAGS_tailcall;
+    return s;
+}
+
 /***********************************
  */
 
@@ -2897,10 +2994,11 @@ code *cdstrthis(elem *e,regm_t *pretregs)
  *      pretregs   = where return value goes
  *      keepmsk    = registers to not change when evaluating the function address
  *      usefuncarg = using cgstate.funcarg, so no need to adjust stack after func return
+ *      ymmargs    = some of the parameters are in YMM registers
  */
 
 STATIC code * funccall(elem *e,unsigned numpara,unsigned numalign,
-        regm_t *pretregs,regm_t keepmsk, bool usefuncarg)
+        regm_t *pretregs,regm_t keepmsk, bool usefuncarg, bool ymmargs)
 {
     elem *e1;
     code *c,*ce,cs;
@@ -2911,6 +3009,12 @@ STATIC code * funccall(elem *e,unsigned numpara,unsigned numalign,
 
     //printf("funccall(e = %p, *pretregs = %s, numpara = %d, numalign = %d)\n",e,regm_str(*pretregs),numpara,numalign);
     calledafunc = 1;
+
+    /* With -mcpu=avx, cod3_vzeroupper() may put a VZEROUPPER before the
+     * call, which changes every XMM register
+     */
+    bool vzeroupper = config.avx && !ymmargs && !(e->Eflags & EFLAGS_tailcall);
+
     /* Determine if we need frame for function prolog/epilog    */
     e1 = e->E1;
     tym1 = tybasic(e1->Ety);
@@ -2924,6 +3028,8 @@ STATIC code * funccall(elem *e,unsigned numpara,unsigned numalign,
             WRTYxx(tym1);
         assert(tyfunc(tym1));
         s = e1->EV.sp.Vsym;
+        if (s->Sflags & SFLexit || s == tls_get_addr_sym)
+            vzeroupper = false;
         if (s->Sflags & SFLexit)
             c = nullptr;
         else if (s != tls_get_addr_sym)
@@ -2937,8 +3043,8 @@ STATIC code * funccall(elem *e,unsigned numpara,unsigned numalign,
             // Function doesn't return, so don't worry about registers
             // it may use
             c1 = nullptr;
-        else if (!tyfunc(s->ty()) || !(config.flags4 & CFG4optimized))
-            // so we can replace func at runtime
+        else if (!tyfunc(s->ty()) || !(config.flags4 & CFG4optimized) || vzeroupper)
+            // so we can replace func at runtime, or VZEROUPPER changes them all
             c1 = getregs(~fregsaved & (mBP | ALLREGS | mES | XMMREGS));
         else
             c1 = getregs(~s->Sregsaved & (mBP | ALLREGS | mES | XMMREGS));
@@ -2998,8 +3104,15 @@ STATIC code * funccall(elem *e,unsigned numpara,unsigned numalign,
                 ce = load_localgot();
             }
 
-            ce = gencs(ce,farfunc ? 0x9A : 0xE8,0,fl,s);      // CALL extern
-            code_orflag(ce, farfunc ? (CFseg | CFoff) : (CFselfrel | CFoff));
+            if (e->Eflags & EFLAGS_tailcall)
+            {   // The epilog jumps to s instead of returning
+                assert(numpara == 0 && numalign == 0 && !usefuncarg);
+            }
+            else
+            {
+                ce = gencs(ce,farfunc ? 0x9A : 0xE8,0,fl,s);      // CALL extern
+                code_orflag(ce, farfunc ? (CFseg | CFoff) : (CFselfrel | CFoff));
+            }
 
             if (s == tls_get_addr_sym)
             {
@@ -3081,6 +3194,8 @@ STATIC code * funccall(elem *e,unsigned numpara,unsigned numalign,
         }
         s = nullptr;
   }
+  if (vzeroupper)
+      code_orflag(ce, CFymmfree);
   c = cat(c,ce);
   freenode(e1);
 
@@ -3301,7 +3416,8 @@ static code *movParams(elem *e,unsigned stackalign, unsigned funcargtos)
         c = cat(c,codelem(e,&retregs,FALSE));
         unsigned op = xmmstore(tym);
         unsigned r = findreg(retregs);
-        c = genc1(c,op,modregxrm(2,r - XMM0,BPRM),FLfuncarg,funcargtos - 16);   // MOV funcarg[EBP],r
+        c = genc1(c,op,modregxrm(2,r - XMM0,BPRM),FLfuncarg,funcargtos - sz);   // MOV funcarg[EBP],r
+        c = checkSetVexL(c, tym);
         goto ret;
     }
     else if (tyfloating(tym))
@@ -3801,6 +3917,7 @@ code *pushParams(elem *e,unsigned stackalign)
         unsigned op = xmmstore(tym);
         unsigned r = findreg(retregs);
         c = gen2sib(c,op,modregxrm(0,r - XMM0,4),modregrm(0,4,SP));   // MOV [ESP],r
+        c = checkSetVexL(c, tym);
         goto ret;
   }
   else if (tyfloating(tym))
@@ -4220,6 +4337,7 @@ code *loaddata(elem *e,regm_t *pretregs)
             }
         }
         ce = loadea(e,&cs,op,reg,0,RMload,0); // MOVSS/MOVSD reg,data
+        ce = checkSetVexL(ce, tym);
         c = cat(c,ce);
     }
     else if (sz <= REGSIZE)
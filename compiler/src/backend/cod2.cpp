@@ -17,6 +17,7 @@
 #include        "code.hpp"
 #include        "global.hpp"
 #include        "type.hpp"
+#include        "xmm.hpp"
 
 static char __file__[] = __FILE__;      /* for tassert.h                */
 #include        "tassert.hpp"
@@ -85,6 +86,93 @@ regm_t idxregm(code *c)
     return idxm;
 }
 
+/*****************************
+ * Generate the BMI1 forms of OPand for -mcpu=avx2:
+ *      x & (x - 1)     BLSR reg,x
+ *      x & -x          BLSI reg,x
+ *      ~x & y          ANDN reg,x,y
+ * Returns:
+ *      nullptr if e is not one of them
+ */
+
+static code *cdbmi(elem *e, regm_t *pretregs)
+{
+    tym_t ty = tybasic(e->Ety);
+    unsigned sz = tysize[ty];
+    if (!tyintegral(ty) || !(sz == 4 || sz == 8 && I64) ||
+        !(*pretregs & allregs) || *pretregs & mPSW)
+        return CNIL;
+
+    code *c;
+    regm_t retregs = *pretregs & allregs;
+    unsigned reg;
+    for (int i = 0; i < 2; i++)
+    {
+        elem *x = i ? e->E2 : e->E1;
+        elem *y = i ? e->E1 : e->E2;
+        if (y->Ecount || x->Eoper != OPvar || x->Ety & mTYvolatile)
+            continue;
+
+        unsigned ext;
+        if (y->Eoper == OPmin && el_match(y->E1, x) &&
+            y->E2->Eoper == OPconst && el_allbits(y->E2, 1) ||
+            y->Eoper == OPadd && el_match(y->E1, x) &&
+            y->E2->Eoper == OPconst && el_allbits(y->E2, -1))
+            ext = 1;                            // BLSR
+        else if (y->Eoper == OPneg && el_match(y->E1, x))
+            ext = 3;                            // BLSI
+        else
+            continue;
+
+        regm_t xregs = allregs;
+        c = codelem(x, &xregs, FALSE);
+        unsigned xreg = findreg(xregs);
+        c = cat(c, allocreg(&retregs, &reg, ty));
+        code *cb = genregs(CNIL, 0x0F38F3, ext, xreg);
+        if (sz == 8)
+            code_orrex(cb, REX_W);
+        checkSetVex(cb, reg);                   // destination is VEX.vvvv
+        freenode(y->E1);
+        if (ext == 1)
+            freenode(y->E2);
+        freenode(y);
+        return cat3(c, cb, fixresult(e, retregs, pretregs));
+    }
+
+    if (e->E1->Eoper == OPcom && !e->E1->Ecount)
+    {
+        code cs;
+        elem *x = e->E1->E1;
+        elem *y = e->E2;
+        regm_t xregs = allregs;
+        c = codelem(x, &xregs, FALSE);
+        unsigned xreg = findreg(xregs);
+        if ((y->Eoper == OPind && !y->Ecount) || y->Eoper == OPvar)
+            c = cat(c, getlvalue(&cs, y, RMload | xregs));
+        else
+        {
+            regm_t yregs = allregs & ~xregs;
+            c = cat(c, scodelem(y, &yregs, xregs, TRUE));
+            unsigned yreg = findreg(yregs);
+            cs.Irm = modregrm(3,0,yreg & 7);
+            cs.Iflags = 0;
+            cs.Irex = 0;
+            if (yreg & 8)
+                cs.Irex |= REX_B;
+        }
+        c = cat(c, allocreg(&retregs, &reg, ty));
+        cs.Iop = 0x0F38F2;
+        code_newreg(&cs, reg);
+        if (sz == 8)
+            cs.Irex |= REX_W;
+        code *cb = gen(CNIL, &cs);
+        checkSetVex(cb, xreg);
+        freenode(e->E1);
+        return cat3(c, cb, fixresult(e, retregs, pretregs));
+    }
+    return CNIL;
+}
+
 /*****************************
  * Handle operators which are more or less orthogonal
  * ( + - & | ^ )
@@ -132,6 +220,12 @@ code *cdorth(elem *e,regm_t *pretregs)
   cs.Irex = 0;
   code *cr = CNIL;
 
+  if (e->Eoper == OPand && config.avx >= 2)
+  {     c = cdbmi(e,pretregs);
+        if (c)
+            return c;
+  }
+
   switch (e->Eoper)
   {     case OPadd:     mode = 0;
                         op1 = 0x03; op2 = 0x13; break;  /* ADD, ADC     */
@@ -1023,6 +1117,8 @@ code *cdmul(elem *e,regm_t *pretregs)
                     {
                         cg = movregconst(cg,AX,d,(sz == 8) ? 0x40 : 0); // MOV EAX,d
                         cg = gen2(cg,0x0FAF,grex | modregrmx(3,AX,DX)); // IMUL EAX,EDX
+                        code *ct = getregs(mAX);                        // EAX no longer contains 'd'
+                        assert(ct == nullptr);
                     }
                     gen2(cg,0x2B,grex | modregxrm(3,reg,AX));           // SUB R1,EAX
                     genmovreg(cg, AX, r3);                              // MOV EAX,r3
@@ -1043,6 +1139,7 @@ code *cdmul(elem *e,regm_t *pretregs)
         if (oper != OPmul &&
             e2factor > 2 && (e2factor & (e2factor - 1)) &&
             ((I32 && sz == 4) || (I64 && (sz == 4 || sz == 8))) &&
+            !((e2factor >> (sz * 8 - 1)) & 1) &&         // choose_multiplier() needs d < 2**(N-1)
             config.flags4 & CFG4speed && uns)
         {
             assert(sz == 4 || sz == 8);
@@ -2062,9 +2159,28 @@ code *cdloglog(elem *e,regm_t *pretregs)
   /*assert(*pretregs != mPSW);*/
 
   cgstate.stackclean++;
+  e2 = e->E2;
+  if (*pretregs == 0 && el_noreturn(e2))
+  {     /* Something like assert(x), e2 is only executed when things
+         * go wrong. Move its code out of line, to keep the hot path short.
+         */
+        block *bcold = cgcod_coldblock();
+        if (bcold)
+        {
+            cl = logexp(e->E1,e->Eoper == OPandand,FLblock,(code *) bcold);
+            regconsave = regcon;
+            stackpushsave = stackpush;
+            cr = codelem(e2,pretregs,FALSE);
+            bcold->Bcode = cat(bcold->Bcode,cr);
+            regconsave.used |= regcon.used;
+            regcon = regconsave;
+            assert(stackpush == stackpushsave);
+            c = cl;
+            goto Lret;
+        }
+  }
   cnop1 = gennop(CNIL);
   cnop3 = gennop(CNIL);
-  e2 = e->E2;
   cl = (e->Eoper == OPoror)
         ? logexp(e->E1,1,FLcode,cnop1)
         : logexp(e->E1,0,FLcode,cnop3);
@@ -2780,7 +2896,7 @@ code *cdind(elem *e,regm_t *pretregs)
         }
         if (retregs & XMMREGS)
         {
-            assert(sz == 4 || sz == 8 || sz == 16); // float, double or vector
+            assert(sz == 4 || sz == 8 || sz == 16 || sz == 32); // float, double or vector
             cs.Iop = xmmload(tym);
             reg -= XMM0;
             goto L2;
@@ -2797,6 +2913,7 @@ code *cdind(elem *e,regm_t *pretregs)
                 cs.Iop ^= byte;
         L2:     code_newreg(&cs,reg);
                 ce = gen(CNIL,&cs);     /* MOV reg,[idx]                */
+                ce = checkSetVexL(ce, tym);
                 if (byte && reg >= 4)
                     code_orrex(ce, REX);
         }
@@ -3230,6 +3347,67 @@ code *cdstrcpy(elem *e,regm_t *pretregs)
     return cat6(c1,c2,c3,c4,fixresult(e,mAX | mES,pretregs),CNIL);
 }
 
+/* Largest block copied or set with inline XMM moves by cdstreq() and
+ * cdmemset(); bigger ones are left to REP MOVS and REP STOS.
+ */
+#define XMM_THRESHOLD 256
+
+/*********************************
+ * Size of the unaligned XMM moves used for a block of numbytes:
+ * 32 when -mcpu=avx makes the YMM registers available, 16 otherwise.
+ */
+
+static unsigned xmmmovsize(unsigned numbytes)
+{
+    return config.avx && numbytes >= 32 ? 32 : 16;
+}
+
+/*********************************
+ * Generate one unaligned XMM move between xreg and offset[reg].
+ *      op      LODDQU or STODQU
+ */
+
+static code *genxmmmov(code *c, unsigned op, unsigned xreg, unsigned reg, targ_size_t offset, unsigned size)
+{
+    code *ce = gen2(CNIL, op, buildModregrm(2, xreg, reg));
+    ce->IFL1 = FLconst;
+    ce->IEVoffset1 = offset;
+    if (size == 32)
+        ce->Iflags |= CFvexl;
+    return cat(c, ce);
+}
+
+/*********************************
+ * Generate the unaligned XMM moves that cover numbytes at [dreg], storing
+ * xreg there, or if sreg is not NOREG, copying them from [sreg] through xreg.
+ * Rather than finishing with smaller moves, a partial last piece is
+ * done as a full one ending at numbytes, overlapping the piece before it.
+ */
+
+static code *genxmmmovs(unsigned dreg, unsigned sreg, unsigned xreg, unsigned numbytes)
+{
+    unsigned size = xmmmovsize(numbytes);
+    assert(numbytes >= 16);
+    code *c = CNIL;
+    targ_size_t offset = 0;
+    while (1)
+    {
+        if (sreg != NOREG)
+            c = genxmmmov(c, LODDQU, xreg, sreg, offset, size);
+        c = genxmmmov(c, STODQU, xreg, dreg, offset, size);
+        offset += size;
+        if (offset == numbytes)
+            break;
+        if (offset + size > numbytes)
+        {   // the tail
+            if (numbytes - offset <= 16)
+                size = 16;
+            offset = numbytes - size;
+        }
+    }
+    return c;
+}
+
 /*********************************
  * Generate code for memcpy(s1,s2,n) intrinsic.
  *  OPmemcpy
@@ -3410,6 +3588,52 @@ code *cdmemset(elem *e,regm_t *pretregs)
     if (e2->E1->Eoper == OPconst)
     {
         numbytes = el_tolong(e2->E1);
+        if (config.fpxmmregs && numbytes >= 32 && numbytes <= XMM_THRESHOLD &&
+            e2->E2->Eoper == OPconst)
+        {
+            /*  MOV     reg,value
+             *  MOVQ    xreg,reg
+             *  PUNPCKLQDQ xreg,xreg
+             *  VINSERTF128 yreg,yreg,xreg,1    // for 32 byte moves
+             *  MOVDQU  offset[s],xreg          // numbytes/16 or numbytes/32 times
+             */
+            retregs1 = *pretregs & ALLREGS;
+            if (!retregs1)
+                retregs1 = ALLREGS;
+            c1 = codelem(e->E1,&retregs1,FALSE);
+            reg = findreg(retregs1);
+            freenode(e2->E2);
+            freenode(e2);
+
+            regm_t xregs = XMMREGS;
+            unsigned xreg;
+            c1 = cat(c1,allocreg(&xregs,&xreg,TYdouble));
+            xreg -= XMM0;
+            bool ymm = xmmmovsize(numbytes) == 32;
+            if (value == 0)
+            {
+                c2 = gen2(CNIL,XORPS,modregxrmx(3,xreg,xreg));  // XORPS xreg,xreg
+                if (ymm)
+                    c2->Iflags |= CFvexl;
+            }
+            else
+            {
+                c2 = regwithvalue(CNIL, ALLREGS & ~retregs1, value, &vreg, 64);
+                c2 = gen2(c2,LODD,modregxrmx(3,xreg,vreg));    // MOVQ xreg,vreg
+                code_orrex(c2, REX_W);
+                c2 = gen2(c2,PUNPCKLQDQ,modregxrmx(3,xreg,xreg));
+                if (ymm)
+                {   code *ci = gen2(CNIL,VINSERTF128,modregxrmx(3,xreg,xreg));
+                    ci->Iflags |= CFvexl;
+                    ci->IFL2 = FLconst;
+                    ci->IEV2.Vsize_t = 1;
+                    checkSetVex(ci, xreg);
+                    c2 = cat(c2,ci);
+                }
+            }
+            c3 = genxmmmovs(reg, NOREG, xreg, numbytes);
+            return cat4(c1,c2,c3,fixresult(e,retregs1,pretregs));
+        }
         if (numbytes <= REP_THRESHOLD &&
                                 // doesn't work for 16 bits
             e2->E2->Eoper == OPconst)
@@ -3452,6 +3676,17 @@ code *cdmemset(elem *e,regm_t *pretregs)
                 offset += REGSIZE;
                 c3 = cat(c3,c2);
             }
+            if (numbytes && offset)
+            {                           // MOV dword ptr offset[reg],vreg
+                /* Store the remaining bytes with one more full register,
+                 * overlapping the last store.
+                 */
+                c2 = gen2(CNIL,0x89,m);
+                c2->IEVoffset1 = offset + numbytes - REGSIZE;
+                c2->IFL1 = FLconst;
+                c3 = cat(c3,c2);
+                goto fixres;
+            }
             m &= ~(rex << 16);
             if (numbytes & 4)
             {                           // MOV dword ptr offset[reg],vreg
@@ -3583,8 +3818,15 @@ code *cdstreq(elem *e,regm_t *pretregs)
 
     //printf("cdstreq(e = %p, *pretregs = %s)\n", e, regm_str(*pretregs));
 
+    /* Copies of up to XMM_THRESHOLD bytes are done with XMM moves,
+     * which can use any registers for the pointers. Leave out CX,
+     * which asks cdrelconst() for a far pointer.
+     */
+    bool xmm = config.fpxmmregs && numbytes >= 16 && numbytes <= XMM_THRESHOLD;
+    regm_t xmmptrregs = ALLREGS & ~mCX;
+
     /* First, load pointer to rvalue into SI                            */
-    srcregs = mSI;                      /* source is DS:SI              */
+    srcregs = xmm ? xmmptrregs : mSI;   /* source is DS:SI              */
     c1 = docommas(&e2);
     if (e2->Eoper == OPind)             /* if (.. = *p)                 */
     {   elem *e21 = e2->E1;
@@ -3650,9 +3892,11 @@ code *cdstreq(elem *e,regm_t *pretregs)
 
   /* now get pointer to lvalue (destination) in ES:DI                   */
   dstregs = (config.exe & EX_flat) ? mDI : mES|mDI;
+  if (xmm)
+        dstregs = xmmptrregs & ~srcregs;
   if (e1->Eoper == OPind)               /* if (*p = ..)                 */
   {
-        if (tyreg(e1->E1->Ety))
+        if (tyreg(e1->E1->Ety) && !xmm)
             dstregs = mDI;
         c2 = cod2_setES(e1->E1->Ety);
         c2 = cat(c2,scodelem(e1->E1,&dstregs,srcregs,FALSE));
@@ -3661,6 +3905,23 @@ code *cdstreq(elem *e,regm_t *pretregs)
         c2 = cdrelconst(e1,&dstregs);
   freenode(e1);
 
+  if (xmm)
+  {
+        /* Copy through an XMM register, leaving the pointers as they are:
+         *      MOVDQU  xreg,offset[sreg]
+         *      MOVDQU  offset[dreg],xreg
+         */
+        assert(!need_DS);
+        regm_t xregs = XMMREGS;
+        unsigned xreg;
+        c3 = allocreg(&xregs,&xreg,TYdouble);
+        c3 = cat(c3,genxmmmovs(findreg(dstregs),findreg(srcregs),xreg - XMM0,numbytes));
+        assert(!(*pretregs & mPSW));
+        if (*pretregs)
+            c3 = cat(c3,fixresult(e,dstregs,pretregs));
+        return cat3(c1,c2,c3);
+  }
+
   c3 = getregs((srcregs | dstregs) & (mLSW | mDI));
   if (need_DS)
   {     assert(!(config.exe & EX_flat));
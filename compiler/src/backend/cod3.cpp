@@ -178,7 +178,7 @@ code *REGSAVE::save(code *c, int reg, unsigned *pidx)
         alignment = 16;
         idx = (idx + 15) & ~15;
         i = idx;
-        idx += 16;
+        idx += config.avx ? 32 : 16;
         // MOVD idx[RBP],xmm
         unsigned op = STOAPD;
         if (0)
@@ -189,7 +189,11 @@ code *REGSAVE::save(code *c, int reg, unsigned *pidx)
              * reason. Need to fix.
              */
             op = STOUPD;
+        if (config.avx)
+            op = STOUPD;                // the register may hold a 256 bit vector
         c = genc1(c,op,modregxrm(2, reg - XMM0, BPRM),FLregsave,(targ_uns) i);
+        if (config.avx)
+            code_orflag(c, CFvexl);
     }
     else
     {
@@ -218,7 +222,11 @@ code *REGSAVE::restore(code *c, int reg, unsigned idx)
         unsigned op = LODAPD;
         if (0)
             op = LODUPD;
+        if (config.avx)
+            op = LODUPD;
         c = genc1(c,op,modregxrm(2, reg - XMM0, BPRM),FLregsave,(targ_uns) idx);
+        if (config.avx)
+            code_orflag(c, CFvexl);
     }
     else
     {   // MOV reg,idx[RBP]
@@ -262,6 +270,274 @@ unsigned char vex_inssize(code *c)
     return ins;
 }
 
+/************************************
+ * Convert instruction c, written as a legacy prefix and 0F/0F38/0F3A opcode,
+ * into its VEX encoding. VEX.vvvv is set to vreg, which is ignored by
+ * instructions that don't take the extra operand.
+ */
+
+void checkSetVex(code *c, unsigned vreg)
+{
+    unsigned op = c->Iop;
+    unsigned mm, prefix;
+    if ((op & 0xFFFD00) == 0x0F3800)
+    {   mm = (op & 0x200) ? 3 : 2;      // 0F 3A or 0F 38
+        prefix = op >> 24;
+    }
+    else
+    {   assert((op & 0xFF00) == 0x0F00);
+        mm = 1;                         // 0F
+        prefix = (op >> 16) & 0xFF;
+    }
+    unsigned pp;
+    switch (prefix)
+    {
+        case 0:    pp = 0; break;
+        case 0x66: pp = 1; break;
+        case 0xF3: pp = 2; break;
+        case 0xF2: pp = 3; break;
+        default:
+            assert(0);
+    }
+    c->Iop = 0;
+    c->Ivex.pfx = 0xC4;
+    c->Ivex.op = op & 0xFF;
+    c->Ivex.mmmm = mm;
+    c->Ivex.pp = pp;
+    c->Ivex.l = (c->Iflags & CFvexl) != 0;
+    c->Ivex.w = (c->Irex & REX_W) != 0;
+    c->Ivex.r = !(c->Irex & REX_R);
+    c->Ivex.x = !(c->Irex & REX_X);
+    c->Ivex.b = !(c->Irex & REX_B);
+    c->Ivex.vvvv = ~vreg;
+    c->Iflags |= CFvex;
+    if (c->Ivex.w || !c->Ivex.x || !c->Ivex.b || c->Ivex.mmmm > 1)
+        c->Iflags |= CFvex3;
+}
+
+/************************************
+ * What VEX.vvvv means for the VEX form of the SSE instruction c.
+ * Instructions not listed are left with their legacy encoding, which
+ * is what the blends that implicitly use XMM0, and MMX, POPCNT and CRC32,
+ * must keep.
+ */
+
+enum
+{
+    VEXnone,            // no VEX form
+    VEXnoo,             // vvvv is unused
+    VEXnds,             // vvvv is the first source, the same as the destination
+    VEXndd,             // vvvv is the destination, ModRM.reg is an opcode extension
+    VEXndsrm,           // vvvv is the first source, the same as the ModRM.rm destination
+};
+
+static int vexform(code *c)
+{
+    bool regreg = (c->Irm & 0xC0) == 0xC0;
+    switch (c->Iop)
+    {
+        case LODSS: case LODSD:
+            return regreg ? VEXnds : VEXnoo;    // register form merges
+        case STOSS: case STOSD:
+            return regreg ? VEXndsrm : VEXnoo;
+
+        case LODAPS: case LODAPD: case LODDQA: case LODDQU:
+        case LODUPS: case LODUPD: case LDDQU:  case MOVNTDQA:
+        case STOAPS: case STOAPD: case STODQA: case STODQU:
+        case STOUPS: case STOUPD:
+        case LODD:   case LODQ:   case STOD:   case STOQ:
+        case MOVNTDQ: case MOVNTPD: case MOVNTPS:
+        case STOHPD: case STOHPS: case STOLPD: case STOLPS:
+        case COMISS: case COMISD: case UCOMISS: case UCOMISD:
+        case MOVMSKPS: case MOVMSKPD: case PMOVMSKB:
+        case CVTDQ2PD: case CVTDQ2PS: case CVTPD2DQ: case CVTPD2PS:
+        case CVTPS2DQ: case CVTPS2PD: case CVTTPD2DQ: case CVTTPS2DQ:
+        case CVTSD2SI: case CVTSS2SI: case CVTTSD2SI: case CVTTSS2SI:
+        case SQRTPS: case SQRTPD: case RCPPS: case RSQRTPS:
+        case PSHUFD: case PSHUFHW: case PSHUFLW:
+        case MOVDDUP: case MOVSHDUP: case MOVSLDUP:
+        case PABSB: case PABSW: case PABSD:
+        case PTEST: case PHMINPOSUW:
+        case PMOVSXBW: case PMOVSXBD: case PMOVSXBQ:
+        case PMOVSXWD: case PMOVSXWQ: case PMOVSXDQ:
+        case PMOVZXBW: case PMOVZXBD: case PMOVZXBQ:
+        case PMOVZXWD: case PMOVZXWQ: case PMOVZXDQ:
+        case ROUNDPS: case ROUNDPD:
+        case PEXTRW: case PEXTRB: case PEXTRD: case EXTRACTPS:
+        case PCMPESTRI: case PCMPESTRM: case PCMPISTRI: case PCMPISTRM:
+        case AESIMC: case AESKEYGENASSIST:
+            return VEXnoo;
+
+        case ADDSS: case ADDSD: case ADDPS: case ADDPD:
+        case SUBSS: case SUBSD: case SUBPS: case SUBPD:
+        case MULSS: case MULSD: case MULPS: case MULPD:
+        case DIVSS: case DIVSD: case DIVPS: case DIVPD:
+        case MINSS: case MINSD: case MINPS: case MINPD:
+        case MAXSS: case MAXSD: case MAXPS: case MAXPD:
+        case SQRTSS: case SQRTSD: case RCPSS: case RSQRTSS:
+        case ANDPS: case ANDPD: case ANDNPS: case ANDNPD:
+        case ORPS:  case ORPD:  case XORPS:  case XORPD:
+        case CMPPS: case CMPPD: case CMPSS:  case CMPSD:
+        case SHUFPS: case SHUFPD:
+        case UNPCKHPS: case UNPCKHPD: case UNPCKLPS: case UNPCKLPD:
+        case LODHPD: case LODHPS: case LODLPD: case LODLPS:    // and MOVLHPS, MOVHLPS
+        case CVTSD2SS: case CVTSS2SD: case CVTSI2SD: case CVTSI2SS:
+        case ROUNDSS: case ROUNDSD:
+        case ADDSUBPS: case ADDSUBPD: case HADDPS: case HADDPD:
+        case HSUBPS: case HSUBPD:
+        case DPPS: case DPPD: case BLENDPS: case BLENDPD:
+        case INSERTPS: case MPSADBW: case PBLENDW: case PALIGNR:
+        case PADDB: case PADDW: case PADDD: case PADDQ:
+        case PADDSB: case PADDSW: case PADDUSB: case PADDUSW:
+        case PSUBB: case PSUBW: case PSUBD: case PSUBQ:
+        case PSUBSB: case PSUBSW: case PSUBUSB: case PSUBUSW:
+        case PMULLW: case PMULLD: case PMULHW: case PMULHUW:
+        case PMULUDQ: case PMULDQ: case PMULHRSW:
+        case PMADDWD: case PMADDUBSW: case PSADBW:
+        case PAVGB: case PAVGW:
+        case PAND: case PANDN: case POR: case PXOR:
+        case PCMPEQB: case PCMPEQW: case PCMPEQD: case PCMPEQQ:
+        case PCMPGTB: case PCMPGTW: case PCMPGTD: case PCMPGTQ:
+        case PMAXSB: case PMAXSW: case PMAXSD:
+        case PMAXUB: case PMAXUW: case PMAXUD:
+        case PMINSB: case PMINSW: case PMINSD:
+        case PMINUB: case PMINUW: case PMINUD:
+        case PSLLW: case PSLLD: case PSLLQ:
+        case PSRAW: case PSRAD:
+        case PSRLW: case PSRLD: case PSRLQ:
+        case PACKSSWB: case PACKSSDW: case PACKUSWB: case PACKUSDW:
+        case PUNPCKHBW: case PUNPCKHWD: case PUNPCKHDQ: case PUNPCKHQDQ:
+        case PUNPCKLBW: case PUNPCKLWD: case PUNPCKLDQ: case PUNPCKLQDQ:
+        case PSHUFB: case PSIGNB: case PSIGNW: case PSIGND:
+        case PHADDW: case PHADDD: case PHADDSW:
+        case PHSUBW: case PHSUBD: case PHSUBSW:
+        case PINSRW: case PINSRB: case PINSRD:
+        case AESENC: case AESENCLAST: case AESDEC: case AESDECLAST:
+        case VPSLLVD: case VPSRLVD: case VPSRAVD:
+            return VEXnds;
+
+        case 0x660F71: case 0x660F72: case 0x660F73:   // shifts by immediate
+            return VEXndd;
+
+        default:
+            return VEXnone;
+    }
+}
+
+/************************************
+ * With -mcpu=avx, rewrite the SSE instructions in code list c to their
+ * VEX encodings. Since VEX takes a separate first source, a register copy
+ * followed by an operation on the copy collapses into one instruction.
+ */
+
+void cod3_vex(code *c)
+{
+    code *cmov = nullptr;               // preceding MOVAPS xreg,xreg
+    for (; c; c = code_next(c))
+    {
+        code *cprev = cmov;
+        cmov = nullptr;
+        if (c->Iflags & (CFvex | CFopsize))
+            continue;
+        int form = vexform(c);
+        if (form == VEXnone)
+            continue;
+
+        unsigned reg = ((c->Irm >> 3) & 7) | (c->Irex & REX_R ? 8 : 0);
+        unsigned rm = (c->Irm & 7) | (c->Irex & REX_B ? 8 : 0);
+        bool regreg = (c->Irm & 0xC0) == 0xC0;
+        unsigned vreg;
+        switch (form)
+        {
+            case VEXnoo:    vreg = 0;   break;
+            case VEXnds:    vreg = reg; break;
+            case VEXndd:
+            case VEXndsrm:  vreg = rm;  break;
+            default:
+                assert(0);
+        }
+
+        if (form == VEXnds && cprev && !(c->Iflags & CFtarg) &&
+            cprev->Irm == modregrm(3, reg & 7, cprev->Irm & 7) &&
+            !((cprev->Irex ^ c->Irex) & REX_R) &&
+            !((cprev->Iflags ^ c->Iflags) & CFvexl) &&
+            !(regreg && rm == reg))
+        {
+            /* cprev is a VMOVAPS reg,src that c overwrites; take the first
+             * source from src instead.
+             */
+            vreg = (cprev->Irm & 7) | (cprev->Irex & REX_B ? 8 : 0);
+            cprev->Iop = NOP;
+            cprev->Iflags &= ~(CFvex | CFvex3);
+        }
+
+        if (regreg && !(c->Iflags & CFtarg) &&
+            (c->Iop == LODAPS || c->Iop == LODAPD || c->Iop == LODDQA ||
+             c->Iop == LODUPS || c->Iop == LODUPD || c->Iop == LODDQU))
+            cmov = c;
+        checkSetVex(c, vreg);
+    }
+}
+
+/************************************
+ * With -mcpu=avx, determine if the function dirties the upper halves of
+ * the YMM registers, which then costs every legacy SSE instruction run
+ * after it a transition penalty until a VZEROUPPER.
+ * Saving and restoring a register with REGSAVE leaves it as it was.
+ */
+
+static bool anyymm(code *c)
+{
+    for (; c; c = code_next(c))
+    {
+        if ((c->Iflags & CFvexl && c->IFL1 != FLregsave) ||
+            (c->Iflags & CFvex && c->Ivex.l))           // inline assembler
+            return true;
+    }
+    return false;
+}
+
+bool cod3_ymmdirty(code *cprolog)
+{
+    if (anyymm(cprolog))
+        return true;
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        if (anyymm(b->Bcode))
+            return true;
+    }
+    return false;
+}
+
+/************************************
+ * Put a VZEROUPPER in front of each call, tail call and return in block b
+ * of a function that dirties the YMM registers. Calls that pass arguments
+ * in YMM registers, and returns of a YMM value, are left alone.
+ */
+
+void cod3_vzeroupper(block *b)
+{
+    bool ret = b->BC == BCret || b->BC == BCretexp;
+    tym_t tyret = tybasic(funcsym_p->Stype->Tnext->Tty);
+    bool ymmret = tyvector(tyret) && tysize(tyret) == 32;
+
+    for (code **pc = &b->Bcode; *pc; pc = &code_next(*pc))
+    {
+        code *c = *pc;
+        unsigned op = c->Iop;
+        if (c->Iflags & CFymmfree ||
+            (ret && op == 0xE9 && c->IFL2 == FLfunc) ||
+            (ret && !ymmret && (op == 0xC3 || op == 0xC2 || op == 0xCB || op == 0xCA)))
+        {
+            code *cz = gen1(CNIL, 0x0F77);      // VZEROUPPER
+            checkSetVex(cz, 0);
+            code_next(cz) = c;
+            *pc = cz;
+            pc = &code_next(cz);
+        }
+    }
+}
+
 /************************************
  * Determine if there is a modregrm byte for code.
  */
@@ -582,6 +858,16 @@ regm_t regmask(tym_t tym, tym_t tyf)
         case TYulong4:
         case TYllong2:
         case TYullong2:
+        case TYfloat8:
+        case TYdouble4:
+        case TYschar32:
+        case TYuchar32:
+        case TYshort16:
+        case TYushort16:
+        case TYlong8:
+        case TYulong8:
+        case TYllong4:
+        case TYullong4:
             if (!config.fpxmmregs)
             {   printf("SIMD operations not supported on this platform\n");
                 exit(1);
@@ -880,6 +1166,7 @@ void outblkexitcode(block *bl, code*& c, int& anyspill, const char* sflsave, sym
             {   regm_t usedsave;
 
                 c = cat(c,docommas(&e));
+                bl->Btailcall = tailcall(e, retregs);
                 usedsave = regcon.used;
                 if (EOP(e))
                     c = gencodelem(c,e,&retregs,TRUE);
@@ -906,6 +1193,11 @@ void outblkexitcode(block *bl, code*& c, int& anyspill, const char* sflsave, sym
         case BCret:
         case BCexit:
             retregs = 0;
+            if (bl->BC == BCret && e && anytailcalls)
+            {
+                c = cat(c,docommas(&e));
+                bl->Btailcall = tailcall(e, 0);
+            }
             c = gencodelem(c,e,&retregs,TRUE);
         L4:
             bl->Bcode = c;
@@ -991,9 +1283,64 @@ struct CaseVal
         const CaseVal *c2 = (const CaseVal *)q;
         return (c1->val < c2->val) ? -1 : ((c1->val == c2->val) ? 0 : 1);
     }
+
+    /* Sort function for qsort(), for signed case values */
+    static int
+                scmp(const void *p, const void *q)
+    {
+        targ_llong v1 = ((const CaseVal *)p)->val;
+        targ_llong v2 = ((const CaseVal *)q)->val;
+        return (v1 < v2) ? -1 : ((v1 == v2) ? 0 : 1);
+    }
 };
 }
 
+/***********************************
+ * Determine if a switch can be done with a jump table, i.e. if at
+ * least a third of the table would be case values, and vmin can be
+ * subtracted as an immediate value.
+ */
+
+static bool jmptabok(targ_llong vmin, targ_llong vmax, size_t ncases, int sz)
+{
+    if (I64 && sz == 8 && vmin != (int)vmin)
+        return false;
+    return ncases > 3 && (targ_ullong)(vmax - vmin) <= ncases * 3;
+}
+
+/***********************************
+ * Determine if a switch can be done with bit tests: the case values
+ * fit in the bits of a register and go to at most 3 different targets.
+ * Input:
+ *      targets[0..ncases]      target of each case
+ */
+
+#define BTMAXTARGETS 3
+
+static bool bittestok(targ_llong vmin, targ_llong vmax, size_t ncases, block **targets)
+{
+    if (ncases < 3 || (targ_ullong)(vmax - vmin) >= REGSIZE * 8 || vmin != (int)vmin)
+        return false;
+    block *distinct[BTMAXTARGETS];
+    int ndistinct = 0;
+    for (size_t n = 0; n < ncases; n++)
+    {
+        int i;
+        for (i = 0; i < ndistinct; i++)
+        {
+            if (distinct[i] == targets[n])
+                break;
+        }
+        if (i == ndistinct)
+        {
+            if (ndistinct == BTMAXTARGETS)
+                return false;
+            distinct[ndistinct++] = targets[n];
+        }
+    }
+    return true;
+}
+
 /***
  * Generate comparison of [reg2,reg] with val
  */
@@ -1075,6 +1422,186 @@ code *ifthen(CaseVal *casevals, size_t ncases,
     return c;
 }
 
+/*******************************
+ * Build a balanced tree of blocks that compare the switch value s against
+ * the first case of the middle cluster, with a BCswitch block for each of
+ * clusters[0..nclusters] at the leaves.
+ * Input:
+ *      clusters[i]     index in casevals[] of the first case of cluster i
+ *      bsw             the original switch block
+ *      pblast          last block inserted after bsw so far
+ * Returns:
+ *      the root of the tree
+ */
+
+static block *switchtree(block *bsw, block **pblast, Symbol *s, tym_t ty,
+        CaseVal *casevals, size_t ncases, size_t *clusters, size_t nclusters)
+{
+    block *b = block_calloc();
+    b->Btry = bsw->Btry;
+    b->Bsrcpos = bsw->Bsrcpos;
+    b->Bnext = (*pblast)->Bnext;
+    (*pblast)->Bnext = b;
+    *pblast = b;
+
+    if (nclusters == 1)
+    {
+        size_t first = clusters[0];
+        b->BC = BCswitch;
+        b->Belem = el_var(s);
+        targ_llong *pu = (targ_llong *) ::malloc(sizeof(*pu) * (ncases - first + 1));
+        assert(pu);
+        b->BS.Bswitch = pu;
+        *pu++ = ncases - first;
+        b->appendSucc(bsw->nthSucc(0));           // default
+        for (size_t n = first; n < ncases; n++)
+        {
+            *pu++ = casevals[n].val;
+            b->appendSucc(casevals[n].target);
+        }
+        return b;
+    }
+
+    size_t m = nclusters >> 1;
+    b->BC = BCiftrue;
+    b->Belem = el_bin(OPlt, TYint, el_var(s), el_long(ty, casevals[clusters[m]].val));
+    b->appendSucc(switchtree(bsw, pblast, s, ty, casevals, clusters[m], clusters, m));
+    b->appendSucc(switchtree(bsw, pblast, s, ty, casevals, ncases, clusters + m, nclusters - m));
+    return b;
+}
+
+/*******************************
+ * Split the case values of switch block b into clusters that can each be
+ * done with a jump table or bit tests, and the scattered cases between
+ * them. If there is more than one, b becomes the root of a balanced tree
+ * of compares that picks the cluster, each cluster getting its own
+ * BCswitch block for doswitch().
+ */
+
+static void switchclusters(block *b)
+{
+    targ_llong *p = b->BS.Bswitch;
+    size_t ncases = *p++;
+    if (ncases <= 3 || ncases > 4096)
+        return;
+
+    tym_t ty = tybasic(b->Belem->Ety);
+    if (tysize(ty) > REGSIZE)
+        return;
+
+    CaseVal *casevals = (CaseVal *)malloc(ncases * sizeof(CaseVal));
+    assert(casevals);
+    list_t bl = b->Bsucc;
+    for (size_t n = 0; n < ncases; n++)
+    {
+        bl = list_next(bl);
+        casevals[n].val = p[n];
+        casevals[n].target = list_block(bl);
+    }
+    qsort(casevals, ncases, sizeof(CaseVal), tyuns(ty) ? &CaseVal::cmp : &CaseVal::scmp);
+
+    /* Find the fewest clusters covering the cases, where a cluster is
+     * a single case or a run of cases doswitch() can do with a jump table
+     * or bit tests.
+     *      best[i]         number of clusters for casevals[0..i]
+     *      start[i]        where the last of those clusters starts
+     */
+    size_t *best = (size_t *)malloc((ncases + 1) * 2 * sizeof(size_t));
+    assert(best);
+    size_t *start = best + ncases + 1;
+    block **targets = (block **)malloc(ncases * sizeof(block *));
+    assert(targets);
+    for (size_t n = 0; n < ncases; n++)
+        targets[n] = casevals[n].target;
+    best[0] = 0;
+    for (size_t i = 1; i <= ncases; i++)
+    {
+        best[i] = best[i - 1] + 1;
+        start[i] = i - 1;
+        for (size_t j = 0; j + 1 < i; j++)
+        {
+            if (best[j] + 1 >= best[i])
+                continue;
+            targ_llong vmin = casevals[j].val;
+            targ_llong vmax = casevals[i - 1].val;
+            if (jmptabok(vmin, vmax, i - j, tysize(ty)) ||
+                bittestok(vmin, vmax, i - j, targets + j))
+            {
+                best[i] = best[j] + 1;
+                start[i] = j;
+            }
+        }
+    }
+
+    /* Walk back through the clusters, running single cases together
+     * into clusters that doswitch() does with compares.
+     */
+    size_t *clusters = (size_t *)malloc(ncases * sizeof(size_t));
+    assert(clusters);
+    size_t nclusters = 0;
+    size_t ndense = 0;
+    bool single = false;
+    for (size_t i = ncases; i; i = start[i])
+    {
+        bool s1 = start[i] == i - 1;
+        if (s1 && single)
+            clusters[nclusters - 1] = start[i];
+        else
+            clusters[nclusters++] = start[i];
+        if (!s1)
+            ndense++;
+        single = s1;
+    }
+    for (size_t i = 0; i < nclusters / 2; i++)
+    {
+        size_t t = clusters[i];
+        clusters[i] = clusters[nclusters - 1 - i];
+        clusters[nclusters - 1 - i] = t;
+    }
+
+    if (ndense && nclusters > 1)
+    {
+        // Evaluate the switch value once, into s
+        Symbol *s = symbol_genauto(ty);
+        elem *e = el_bin(OPeq, ty, el_var(s), b->Belem);
+
+        size_t m = nclusters >> 1;
+        block *blast = b;
+        block *b1 = switchtree(b, &blast, s, ty, casevals, clusters[m], clusters, m);
+        block *b2 = switchtree(b, &blast, s, ty, casevals, ncases, clusters + m, nclusters - m);
+
+        b->Belem = el_combine(e, el_bin(OPlt, TYint, el_var(s), el_long(ty, casevals[clusters[m]].val)));
+        b->BC = BCiftrue;
+        free(b->BS.Bswitch);
+        b->BS.Bswitch = nullptr;
+        list_free(&b->Bsucc,FPNULL);
+        b->appendSucc(b1);
+        b->appendSucc(b2);
+    }
+
+    free(clusters);
+    free(targets);
+    free(best);
+    free(casevals);
+}
+
+/*******************************
+ * Split switches into clusters with switchclusters().
+ * Done before the optimizer runs, so it sees the new blocks and the
+ * temporaries holding the switch values.
+ */
+
+void cod3_switchclusters()
+{
+    for (block *b = startblock; b; )
+    {
+        block *bnext = b->Bnext;        // skip over the blocks split off b
+        if (b->BC == BCswitch)
+            switchclusters(b);
+        b = bnext;
+    }
+}
+
 /*******************************
  * Generate code for blocks ending in a switch statement.
  * Take BCswitch and decide on
@@ -1131,15 +1658,83 @@ void doswitch(block *b)
     p -= ncases;
     //dbg_printf("vmax = x%lx, vmin = x%lx, vmax-vmin = x%lx\n",vmax,vmin,vmax - vmin);
 
-    /* Three kinds of switch strategies - pick one
+    /* Four kinds of switch strategies - pick one
      */
+    block *targets[64];                 // REGSIZE * 8 at most, REGSIZE isn't a constant
+    if (!dword && (targ_ullong)(vmax - vmin) < REGSIZE * 8)
+    {
+        list_t bl = b->Bsucc;
+        for (unsigned n = 0; n < ncases; n++)
+        {
+            bl = list_next(bl);
+            targets[n] = list_block(bl);
+        }
+        if (bittestok(vmin, vmax, ncases, targets))
+            goto Lbittest;
+    }
     if (ncases <= 3)
         goto Lifthen;
-    else if ((targ_ullong)(vmax - vmin) <= ncases * 3)
+    else if (jmptabok(vmin, vmax, ncases, sz))
         goto Ljmptab;           // >= 33% of the table is case values, rest is default
     else
         goto Lifthen;
 
+    /*************************************************************************/
+    {   // Test the bit for the switch value in a mask of the cases for each target
+    Lbittest:
+        b->BC = BCifthen;
+        block *bdefault = b->nthSucc(0);
+
+        /* If vmin is small enough, the masks can start at bit 0.
+         * This saves the SUB instruction.
+         */
+        if (vmin > 0 && vmax < REGSIZE * 8)
+            vmin = 0;
+
+        regm_t retregs = ALLREGS;
+        c = scodelem(e,&retregs,0,FALSE);
+        unsigned reg = findreg(retregs);
+        c = cat(c,getregs(retregs));
+        unsigned rex = (I64 && sz == 8) ? REX_W : 0;
+        if (vmin)
+        {   c = genc2(c,0x81,modregrmx(3,5,reg),vmin);         // SUB reg,vmin
+            code_orrex(c, rex);
+        }
+        c = genc2(c,0x81,modregrmx(3,7,reg),vmax - vmin);      // CMP reg,vmax-vmin
+        code_orrex(c, rex);
+        genjmp(c,JA,FLblock,bdefault);                          // JA default
+
+        regm_t scratchm = ALLREGS & ~retregs;
+        unsigned sreg;
+        c = cat(c, allocreg(&scratchm,&sreg,TYint));
+        for (unsigned n = 0; n < ncases; n++)
+        {
+            block *target = targets[n];
+            if (!target)
+                continue;               // already tested for
+            targ_ullong bits = 0;
+            for (unsigned i = n; i < ncases; i++)
+            {
+                if (targets[i] == target)
+                {   bits |= 1ULL << (p[i] - vmin);
+                    targets[i] = nullptr;
+                }
+            }
+            c = movregconst(c,sreg,bits,I64 ? 64 : 0);         // MOV sreg,bits
+            // BT modulo the register size ignores any high bits of reg
+            c = gen2(c,0x0FA3,modregxrmx(3,reg,sreg));         // BT sreg,reg
+            if (I64)
+                code_orrex(c, REX_W);
+            genjmp(c,JC,FLblock,target);                        // JC target
+        }
+        // sreg holds a different mask at each target, so forget its value
+        c = cat(c,getregs(mask[sreg]));
+        if (bdefault != b->Bnext)
+            genjmp(c,JMP,FLblock,bdefault);                     // JMP default
+        ce = nullptr;
+        goto L2;
+    }
+
     /*************************************************************************/
     {   // generate if-then sequence
     Lifthen:
@@ -1191,6 +1786,8 @@ void doswitch(block *b)
 
         // Generate binary tree of comparisons
         c = cat(c, ifthen(casevals, ncases, sz, reg, reg2, sreg, bdefault, bdefault != b->Bnext));
+        if (sreg != NOREG)
+            c = cat(c,getregs(mask[sreg]));     // sreg was loaded with different case values
 
         free(casevals);
 
@@ -1235,7 +1832,9 @@ void doswitch(block *b)
         }
         if (vmin)                       /* if there is a minimum        */
         {
-            c = genc2(c,0x81,modregrm(3,5,reg),vmin); /* SUB reg,vmin   */
+            c = genc2(c,0x81,modregrmx(3,5,reg),vmin); /* SUB reg,vmin   */
+            if (I64 && sz == 8)
+                code_orrex(c, REX_W);
             if (dword)
             {   genc2(c,0x81,modregrm(3,3,reg2),MSREG(vmin)); // SBB reg2,vmin
                 genjmp(c,JNE,FLblock,b->nthSucc(0)); /* JNE default  */
@@ -1247,7 +1846,7 @@ void doswitch(block *b)
         }
         if (vmax - vmin != REGMASK)     /* if there is a maximum        */
         {                               /* CMP reg,vmax-vmin            */
-            c = genc2(c,0x81,modregrm(3,7,reg),vmax-vmin);
+            c = genc2(c,0x81,modregrmx(3,7,reg),vmax-vmin);
             if (I64)
                 code_orrex(c, REX_W);
             genjmp(c,JA,FLblock,b->nthSucc(0));  /* JA default   */
@@ -1549,7 +2148,7 @@ void outjmptab(block *b)
             }
             else
             {
-                objmod->reftodatseg(jmpseg,*poffset,targ,funcsym_p->Sxtrnnum,CFoffset64 | CFswitch);
+                objmod->reftodatseg(jmpseg,*poffset,targ - funcsym_p->Soffset,funcsym_p->Sxtrnnum,CFoffset64 | CFswitch);
                 *poffset += 8;
             }
         }
@@ -3105,6 +3704,7 @@ code* prolog_loadparams(tym_t tyf, bool pushalloc, regm_t* namedargs)
                                              modregxrm(2,preg,BPRM),FLconst, offset);
                             if (XMM0 <= preg && preg <= XMM15)
                             {
+                                c2 = checkSetVexL(c2, t->Tty);
                             }
                             else
                             {
@@ -3123,6 +3723,7 @@ code* prolog_loadparams(tym_t tyf, bool pushalloc, regm_t* namedargs)
                                              modregxrm(2,preg,4),FLconst,offset);
                             if (preg >= XMM0 && preg <= XMM15)
                             {
+                                c2 = checkSetVexL(c2, t->Tty);
                             }
                             else
                             {
@@ -3183,6 +3784,7 @@ code* prolog_loadparams(tym_t tyf, bool pushalloc, regm_t* namedargs)
                     unsigned op = xmmload(t->Tty);      // MOVSS/D xreg,preg
                     unsigned xreg = r - XMM0;
                     c = gen2(c,op,modregxrmx(3,xreg,preg - XMM0));
+                    c = checkSetVexL(c, t->Tty);
                 }
                 else
                 {
@@ -3221,6 +3823,7 @@ code* prolog_loadparams(tym_t tyf, bool pushalloc, regm_t* namedargs)
                 unsigned op = xmmload(s->Stype->Tty);  // MOVSS/D xreg,mem
                 unsigned xreg = s->Sreglsw - XMM0;
                 code *c2 = genc1(CNIL,op,modregxrm(2,xreg,BPRM),FLconst,Para.size + s->Soffset);
+                checkSetVexL(c2, s->Stype->Tty);
                 if (!hasframe)
                 {   // Convert to ESP relative address rather than EBP
                     c2->Irm = modregxrm(2,xreg,4);
@@ -3267,6 +3870,75 @@ code* prolog_loadparams(tym_t tyf, bool pushalloc, regm_t* namedargs)
     return c;
 }
 
+/*******************************
+ * Determine if there are any references to the stack frame in the tree
+ * that could outlive it: addresses of stack variables, the frame pointer,
+ * stack temporaries for struct returns, and alloca().
+ */
+
+STATIC int el_anyframeref(elem *e)
+{
+    while (1)
+    {
+        if (OTunary(e->Eoper))
+            e = e->E1;
+        else if (OTbinary(e->Eoper))
+        {   if (el_anyframeref(e->E2))
+                return 1;
+            e = e->E1;
+        }
+        else if (e->Eoper == OPrelconst)
+            return (sytab[e->EV.sp.Vsym->Sclass] & SCSS) != 0;
+        else if (e->Eoper == OPframeptr || e->Eoper == OPstrthis)
+            return 1;
+        else if (e->Eoper == OPvar)
+            return strcmp(e->EV.sp.Vsym->Sident,"alloca") == 0;
+        else
+            break;
+    }
+    return 0;
+}
+
+/*******************************
+ * Determine if calls in tail position can be done as a JMP from the
+ * epilog. Not if anything could still be using the stack frame after
+ * the epilog pops it, or if the function needs it for exception handling.
+ */
+
+bool cod3_anytailcalls()
+{
+    tym_t tyf = funcsym_p->ty();
+    if (!I64 ||
+        !(config.flags4 & CFG4optimized) ||
+        config.flags & CFGtrace ||
+        config.flags2 & CFG2stomp ||
+        tyf & (mTYnaked | mTYloadds) ||
+        typfunc(tybasic(tyf)) || tybasic(tyf) == TYifunc ||
+        funcsym_p->Sfunc->Fflags3 & Fnotailrecursion ||
+        localgot)
+        return false;
+
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        if (b->Btry)
+            return false;
+        switch (b->BC)
+        {
+            case BCasm:
+            case BC_try:
+            case BCtry:
+            case BC_finally:
+            case BC_lpad:
+            case BC_ret:
+            case BCjcatch:
+                return false;
+        }
+        if (b->Belem && el_anyframeref(b->Belem))
+            return false;
+    }
+    return true;
+}
+
 /*******************************
  * Generate and return function epilog.
  * Output:
@@ -3293,7 +3965,7 @@ void epilog(block *b)
     farfunc = tyfarfunc(tym);
     if (!(b->Bflags & BFLepilog))       // if no epilog code
         goto Lret;                      // just generate RET
-    regx = (b->BC == BCret) ? AX : CX;
+    regx = (b->BC == BCret || b->Btailcall) ? AX : CX;
 
     retsize = 0;
 
@@ -3414,7 +4086,12 @@ void epilog(block *b)
     {
 Lret:
         op = tyfarfunc(tym) ? 0xCA : 0xC2;
-        if (tym == TYhfunc)
+        if (b->Btailcall)
+        {
+            c = gencs(c,0xE9,0,FLfunc,b->Btailcall);    // JMP Btailcall
+            code_orflag(c, CFselfrel | CFoff);
+        }
+        else if (tym == TYhfunc)
         {
             c = genc2(c,0xC2,0,4);                      // RET 4
         }
@@ -3500,6 +4177,7 @@ code* gen_spill_reg(Symbol* s, bool toreg)
         c = getlvalue(&cs,e,keepmsk);
         cs.orReg(s->Sreglsw - XMM0);
         c = gen(c,&cs);
+        c = checkSetVexL(c, s->Stype->Tty);
     }
     else
     {
@@ -3782,7 +4460,8 @@ int branch(block *bl,int flag)
 
                         /* And eliminate jmps to jmps   */
                         if ((op == ct->Iop || ct->Iop == JMP) &&
-                            (op == JMP || c->Iflags & CFjmp16))
+                            (op == JMP || c->Iflags & CFjmp16) &&
+                            ct->IFL2 != FLfunc)         // not a tail call
                         {   c->IFL2 = ct->IFL2;
                             c->IEV2.Vcode = ct->IEV2.Vcode;
                             /*printf("eliminating branch\n");*/
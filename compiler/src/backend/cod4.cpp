@@ -3250,6 +3250,8 @@ code *cdbscan(elem *e, regm_t *pretregs)
     cg = allocreg(&retregs, &reg, e->Ety);
 
     cs.Iop = (e->Eoper == OPbsf) ? 0x0FBC : 0x0FBD;        // BSF/BSR reg,EA
+    if (e->Eoper == OPbsf && config.avx >= 2)
+        cs.Iop = 0xF30FBC;      // TZCNT, which doesn't depend on reg like BSF does
     code_newreg(&cs, reg);
     if (sz == SHORTSIZE)
         cs.Iflags |= CFopsize;
@@ -227,11 +227,13 @@ extern  int stackchanged;
 extern  int refparam;
 extern  int reflocal;
 extern  bool anyiasm;
+extern  bool anytailcalls;
 extern  char calledafunc;
 extern  code *(*cdxxx[])(elem *,regm_t *);
 
 void stackoffsets(int);
 void codgen (void );
+block *cgcod_coldblock();
 #ifdef DEBUG
 unsigned findreg (regm_t regm , int line , const char *file );
 #define findreg(regm) findreg((regm),__LINE__,__FILE__)
@@ -285,6 +287,7 @@ code *tstresult (regm_t regm , tym_t tym , unsigned saveflag );
 code *fixresult (elem *e , regm_t retregs , regm_t *pretregs );
 code *callclib (elem *e , unsigned clib , regm_t *pretregs , regm_t keepmask );
 cd_t cdfunc;
+Symbol *tailcall(elem *e, regm_t retregs);
 cd_t cdstrthis;
 code *pushParams(elem *, unsigned);
 code *offsetinreg (elem *e , regm_t *pretregs );
@@ -332,7 +335,13 @@ cd_t cdclassinit;
 /* cod3.c */
 
 int cod3_EA(code *c);
+void checkSetVex(code *c, unsigned vreg);
+void cod3_vex(code *c);
+bool cod3_ymmdirty(code *cprolog);
+void cod3_vzeroupper(block *b);
 regm_t cod3_useBP();
+bool cod3_anytailcalls();
+void cod3_switchclusters();
 void cod3_initregs();
 void cod3_setdefault();
 void cod3_set32 (void );
@@ -453,6 +462,10 @@ code *xmmopass(elem *e, regm_t *pretregs);
 code *xmmneg(elem *e, regm_t *pretregs);
 unsigned xmmload(tym_t tym);
 unsigned xmmstore(tym_t tym);
+code *checkSetVexL(code *c, tym_t tym);
+elem *el_vectorcmp(unsigned op, tym_t tym, elem *e1, elem *e2);
+elem *el_vectorshift(unsigned op, tym_t tym, elem *e1, elem *e2);
+elem *el_vectordiv(unsigned op, tym_t tym, elem *e1, targ_llong d);
 code *cdvector(elem *e, regm_t *pretregs);
 code *cdvecsto(elem *e, regm_t *pretregs);
 code *cdvecfill(elem *e, regm_t *pretregs);
@@ -374,6 +374,9 @@ struct code
  */
 #define CFREL       0x7000000
 
+#define CFvexl      0x8000000   // VEX.L: operate on the 256 bit YMM register
+#define CFymmfree   0x10000000  // no YMM register is live across this CALL
+
 #define CFPREFIX (CFSEG | CFopsize | CFaddrsize)
 #define CFSEG   (CFes | CFss | CFds | CFcs | CFfs | CFgs)
 
@@ -79,7 +79,7 @@ void u128Div(ullong xh, ullong xl, ullong yh, ullong yl, ullong *pqh, ullong *pq
 /************************************
  * Implemement Algorithm 6.2: Selection of multiplier and shift count
  * Input:
- *      N       32 or 64
+ *      N       16, 32 or 64
  *      d       divisor (must not be 0 or a power of 2)
  *      prec    bits of precision desired
  * Output:
@@ -91,7 +91,7 @@ void u128Div(ullong xh, ullong xl, ullong yh, ullong yl, ullong *pqh, ullong *pq
 
 bool choose_multiplier(int N, ullong d, int prec, ullong *pm, int *pshpost)
 {
-    assert(N == 32 || N == 64);
+    assert(N == 16 || N == 32 || N == 64);
     assert(prec <= N);
     assert(d > 1 && (d & (d - 1)));
 
@@ -108,7 +108,7 @@ bool choose_multiplier(int N, ullong d, int prec, ullong *pm, int *pshpost)
     int shpost = b;
 
     bool mhighbit = false;
-    if (N == 32)
+    if (N <= 32)
     {
         // mlow = (2**(N + b)) / d
         ullong mlow = (1ULL << (N + b)) / d;
@@ -123,7 +123,7 @@ bool choose_multiplier(int N, ullong d, int prec, ullong *pm, int *pshpost)
             --shpost;
         }
 
-        *pm = mhigh & 0xFFFFFFFF;
+        *pm = mhigh & ((1ULL << N) - 1);
         mhighbit = mhigh >> N;
     }
     else if (N == 64)
@@ -190,7 +190,7 @@ bool choose_multiplier(int N, ullong d, int prec, ullong *pm, int *pshpost)
  * Find coefficients for Algorithm 4.2:
  * Optimized code generation of unsigned q=n/d for constant nonzero d
  * Input:
- *      N       32 or 64 (width of divide)
+ *      N       16, 32 or 64 (width of divide)
  *      d       divisor (not a power of 2)
  * Output:
  *      *pshpre  pre-shift
@@ -248,6 +248,12 @@ void test_udiv_coefficients()
 
     static S table[] =
     {
+        { 16, 3,     0, 0, 0xAAAB, 1 },
+        { 16, 7,     0, 1, 0x2493, 3 },
+        { 16, 14,    1, 0, 0x4925, 1 },
+        { 16, 100,   2, 0, 0x147B, 1 },
+        { 16, 641,   0, 1, 0x98F7, 10 },
+
         { 32, 10,    0, 0, 0xCCCCCCCD, 3 },
         { 32, 13,    0, 0, 0x4EC4EC4F, 2 },
         { 32, 14,    1, 0, 0x92492493, 2 },
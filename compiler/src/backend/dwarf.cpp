@@ -2283,6 +2283,16 @@ unsigned dwarf_typidx(type *t)
         case TYulong4:   tbase = tsulong;  goto Lvector;
         case TYllong2:   tbase = tsllong;  goto Lvector;
         case TYullong2:  tbase = tsullong; goto Lvector;
+        case TYfloat8:   tbase = tsfloat;  goto Lvector;
+        case TYdouble4:  tbase = tsdouble; goto Lvector;
+        case TYschar32:  tbase = tsschar;  goto Lvector;
+        case TYuchar32:  tbase = tsuchar;  goto Lvector;
+        case TYshort16:  tbase = tsshort;  goto Lvector;
+        case TYushort16: tbase = tsushort; goto Lvector;
+        case TYlong8:    tbase = tslong;   goto Lvector;
+        case TYulong8:   tbase = tsulong;  goto Lvector;
+        case TYllong4:   tbase = tsllong;  goto Lvector;
+        case TYullong4:  tbase = tsullong; goto Lvector;
         Lvector:
         {
             static unsigned char abbrevTypeArray[] =
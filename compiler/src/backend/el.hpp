@@ -34,6 +34,7 @@ struct elem
                                 // always 0 until CSE elimination is done
     unsigned char Eflags;
     #define EFLAGS_variadic 1   // variadic function call
+    #define EFLAGS_tailcall 2   // call the epilog jumps to instead of returning
 
     union eve EV;               // variants for each type of elem
     union
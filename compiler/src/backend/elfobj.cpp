@@ -1454,10 +1454,10 @@ void Obj::staticctor(Symbol *s,int dtor,int none)
     // Static constructors and destructors
     //dbg_printf("Obj::staticctor(%s) offset %x\n",s->Sident,s->Soffset);
     //symbol_print(s);
-    const IDXSEC seg = s->Sseg =
-        ElfObj::getsegment(".ctors", nullptr, SHT_PROGBITS, SHF_ALLOC|SHF_WRITE, 4);
+    const IDXSEC seg =
+        ElfObj::getsegment(".ctors", nullptr, SHT_PROGBITS, SHF_ALLOC|SHF_WRITE, I64 ? 8 : 4);
     const unsigned relinfo = I64 ? R_X86_64_64 : R_386_32;
-    const size_t sz = ElfObj::writerel(seg, SegData[seg]->SDoffset, relinfo, STI_TEXT, s->Soffset);
+    const size_t sz = ElfObj::writerel(seg, SegData[seg]->SDoffset, relinfo, MAP_SEG2SYMIDX(s->Sseg), s->Soffset);
     SegData[seg]->SDoffset += sz;
 }
 
@@ -1577,6 +1577,10 @@ STATIC void setup_comdat(Symbol *s)
         //s->Sfl = FLcode;      // was FLoncecode
         //prefix = ".gnu.linkonce.t";   // doesn't work, despite documentation
         prefix = ".text.";              // undocumented, but works
+        if (s->Sfunc->Fflags3 & Fhot)
+            prefix = ".text.hot.";      // grouped together by the linker
+        else if (s->Sfunc->Fflags3 & Fcold)
+            prefix = ".text.unlikely.";
         type = SHT_PROGBITS;
         flags = SHF_ALLOC|SHF_EXECINSTR;
     }
@@ -1759,12 +1763,7 @@ int Obj::codeseg(char *name,int suffix)
 
     if (!name)                          // returning to default code segment
     {
-        if (cseg != CODE)               // not the current default
-        {
-            SegData[cseg]->SDoffset = Coffset;
-            Coffset = SegData[CODE]->SDoffset;
-            cseg = CODE;
-        }
+        cseg = CODE;                    // Coffset is SegData[cseg]->SDoffset
         return cseg;
     }
 
@@ -1772,7 +1771,6 @@ int Obj::codeseg(char *name,int suffix)
                                     // find or create code segment
 
     cseg = seg;                         // new code segment index
-    Coffset = 0;
 
     return seg;
 }
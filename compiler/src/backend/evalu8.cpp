@@ -1618,6 +1618,19 @@ elem * evalu8(elem *e, goal_t goal)
                 for (int i = 0; i < 2; ++i)
                     ((targ_ullong *)&e->EV.Vcent)[i] = (targ_ullong)l1;
                 break;
+
+            // 256 bit vectors do not fit in an elem constant
+            case TYfloat8:
+            case TYdouble4:
+            case TYschar32:
+            case TYuchar32:
+            case TYshort16:
+            case TYushort16:
+            case TYlong8:
+            case TYulong8:
+            case TYllong4:
+            case TYullong4:
+                return e;
             default:
                 assert(0);
         }
@@ -38,9 +38,9 @@ inline int cse_float(elem *e)
 {
 #if TX86
     // Don't CSE floating stuff if generating
-    // inline 8087 code, the code generator
-    // can't handle it yet
-    return !(tyfloating(e->Ety) && config.inline8087 &&
+    // inline 8087 code, or vector operations,
+    // the code generator can't handle it yet
+    return !((tyfloating(e->Ety) && config.inline8087 || tyvector(e->Ety)) &&
            e->Eoper != OPvar && e->Eoper != OPconst);
 #else
     return 1;
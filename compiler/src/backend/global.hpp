@@ -362,10 +362,23 @@ void block_initvar(Symbol *s);
 void block_endfunc(int flag);
 void brcombine(void);
 void blockopt(int);
+void block_layout(void);
 void compdfo(void);
 
 #define block_initvar(s) (curblock->Binitvar = (s))
 
+/* profile.c */
+bool profile_read(const char *filename);
+void profile_func(Symbol *sfunc);
+unsigned profile_blocks(Symbol *sfunc);
+void profile_weights(void);
+void profile_term(void);
+
+/* inliner.c */
+void inline_do(Symbol *sfunc);
+void inline_keep(Symbol *sfunc);
+void inline_term(void);
+
 /* debug.c */
 extern const char *regstring[];
 
@@ -18,6 +18,7 @@
 #include        "oper.hpp"
 #include        "global.hpp"
 #include        "type.hpp"
+#include        "xmm.hpp"
 
 static char __file__[] = __FILE__;      /* for tassert.h                */
 #include        "tassert.hpp"
@@ -83,6 +84,8 @@ STATIC void buildloop(loop **pl, block *head, block *tail);
 STATIC void insert(block *b , vec_t lv);
 STATIC void movelis(elem *n,block *b,loop *l,int *pdomexit);
 STATIC int looprotate(loop *l);
+STATIC bool vectorloops(loop *startloop);
+STATIC bool unrollloops(loop *startloop);
 STATIC void markinvar(elem *n , vec_t rd);
 STATIC bool refs(symbol *v , elem *n , elem *nstop);
 STATIC void appendelem(elem *n , elem **pn);
@@ -582,7 +585,8 @@ STATIC int looprotate(loop *l)
         numblks++;                      // number of blocks in existence
         head2->Btry = head->Btry;
         head2->Bflags = head->Bflags;
-        head->Bflags = BFLnomerg;       // move flags over to head2
+        head->Bflags = BFLnomerg | (head->Bflags & BFLprofiled);  // move flags over to head2
+        head2->Bcount = head->Bcount;
         head2->Bflags |= BFLnomerg;
         head2->BC = head->BC;
         assert(head2->BC != BCswitch);
@@ -663,6 +667,827 @@ Lret:
     return FALSE;
 }
 
+/*********************************
+ * Loop unrolling.
+ * Only loops that are a single block are unrolled; that is what
+ * looprotate() and blockopt() make of simple for, while and do loops:
+ *
+ *      prehead: ...
+ *      head:    body; if (i relop N) goto head;
+ *      exit:
+ *
+ * where i is a basic IV stepped by a constant by a statement of body
+ * that is executed on every pass.
+ */
+
+#define UNROLL_MAXNODES 256     // max elem nodes in the body of an unrolled loop
+
+/*********************************
+ * Count elem nodes in e, as a measure of how big a copy of it is.
+ * Returns:
+ *      -1 if e has something in it that must not be duplicated
+ */
+
+STATIC int unrollnodes(elem *e)
+{
+    switch (e->Eoper)
+    {
+        case OPasm:
+        case OPhalt:
+        case OPctor:
+        case OPdtor:
+        case OPddtor:
+        case OPmark:
+        case OPinfo:
+            return -1;
+    }
+    int n = 1;
+    if (EOP(e))
+    {
+        int n1 = unrollnodes(e->E1);
+        if (n1 < 0)
+            return -1;
+        n += n1;
+        if (EBIN(e))
+        {
+            int n2 = unrollnodes(e->E2);
+            if (n2 < 0)
+                return -1;
+            n += n2;
+        }
+    }
+    return n;
+}
+
+/*********************************
+ * Returns:
+ *      true if x is evaluated every time e is, i.e. it is only
+ *      under comma operators in e
+ */
+
+STATIC bool unrollspine(elem *e, elem *x)
+{
+    if (e == x)
+        return true;
+    return e->Eoper == OPcomma && (unrollspine(e->E1, x) || unrollspine(e->E2, x));
+}
+
+/*********************************
+ * Truncate v to the size of ty, sign extending it if ty is signed.
+ */
+
+STATIC targ_ullong unrollwrap(tym_t ty, targ_ullong v)
+{
+    unsigned bits = tysize(ty) * 8;
+    if (bits < 64)
+    {
+        targ_ullong lowbits = (1ULL << bits) - 1;
+        v &= lowbits;
+        if (!tyuns(ty) && (v >> (bits - 1)) & 1)
+            v |= ~lowbits;
+    }
+    return v;
+}
+
+/*********************************
+ * Evaluate the loop test (a op b) done in type ty.
+ */
+
+STATIC bool unrolltest(unsigned op, tym_t ty, targ_ullong a, targ_ullong b)
+{
+    if (tyuns(ty))
+    {
+        switch (op)
+        {
+            case OPlt:   return a <  b;
+            case OPle:   return a <= b;
+            case OPgt:   return a >  b;
+            case OPge:   return a >= b;
+            case OPeqeq: return a == b;
+            case OPne:   return a != b;
+        }
+    }
+    else
+    {
+        targ_llong sa = a, sb = b;
+        switch (op)
+        {
+            case OPlt:   return sa <  sb;
+            case OPle:   return sa <= sb;
+            case OPgt:   return sa >  sb;
+            case OPge:   return sa >= sb;
+            case OPeqeq: return sa == sb;
+            case OPne:   return sa != sb;
+        }
+    }
+    assert(0);
+    return false;
+}
+
+/*********************************
+ * Find the value of the IV e on entry to loop l.
+ * It must have a single reaching definition, of a constant, in a
+ * block that dominates the preheader.
+ * Returns:
+ *      true if found, value in *pvalue
+ */
+
+STATIC bool unrollinit(loop *l, elem *e, targ_llong *pvalue)
+{
+    vec_t rd = vec_calloc(go.deftop);
+    listrds(l->Lpreheader->Boutrd, e, rd);
+
+    bool result = false;
+    unsigned i = vec_index(0, rd);
+    if (i < go.deftop && vec_index(i + 1, rd) == go.deftop)
+    {
+        elem *d = go.defnod[i].DNelem;
+        if (d->Eoper == OPeq &&
+            d->E1->Eoper == OPvar &&
+            d->E1->EV.sp.Vsym == e->EV.sp.Vsym &&
+            d->E1->EV.sp.Voffset == 0 &&
+            tysize(d->E1->Ety) == tysize(e->Ety) &&
+            d->E2->Eoper == OPconst &&
+            dom(go.defnod[i].DNblock, l->Lpreheader))
+        {
+            *pvalue = el_tolong(d->E2);
+            result = true;
+        }
+    }
+    vec_free(rd);
+    return result;
+}
+
+/*********************************
+ * Returns:
+ *      true if the loop limit e does not change within loop l
+ */
+
+STATIC bool unrollinvariant(loop *l, elem *e, symbol *iv)
+{
+    if (e->Eoper == OPconst)
+        return true;
+    if (e->Eoper != OPvar || e->Ety & mTYvolatile)
+        return false;
+    symbol *v = e->EV.sp.Vsym;
+    if (v == iv || !(v->Sflags & SFLunambig))
+        return false;
+    for (unsigned i = 0; i < go.deftop; i++)
+    {
+        if (!vec_testbit(go.defnod[i].DNblock->Bdfoidx, l->Lloop))
+            continue;
+        elem *d = go.defnod[i].DNelem;
+        if (d->Eoper == OPasm ||
+            OTassign(d->Eoper) && d->E1->Eoper == OPvar && d->E1->EV.sp.Vsym == v)
+            return false;
+    }
+    return true;
+}
+
+/*********************************
+ * Create a new block for the unrolled loop of head.
+ */
+
+STATIC block *unrollblock(block *head, int bc, elem *e)
+{
+    block *b = block_calloc();
+    numblks++;
+    assert(numblks <= maxblks);
+    b->BC = bc;
+    b->Belem = e;
+    b->Btry = head->Btry;
+    b->Bsrcpos = head->Bsrcpos;
+    return b;
+}
+
+/*********************************
+ * Find the test at the end of the single block loop l, and the
+ * increment of the basic IV it tests.
+ * Output:
+ *      *ptest  the (i relop N) test
+ *      *pincr  the elem that steps i
+ *      *pstep  how much i is stepped by on each pass
+ * Returns:
+ *      false if l does not have that shape
+ */
+
+STATIC bool unrolliv(loop *l, elem **ptest, elem **pincr, targ_llong *pstep)
+{
+    block *head = l->Lhead;
+    block *pre = l->Lpreheader;
+
+    if (head != l->Ltail || head->BC != BCiftrue || !head->Belem ||
+        head->Bflags & BFLunrolled ||
+        !pre || pre->BC != BCgoto ||
+        list_block(head->Bsucc) != head ||
+        list_block(list_next(head->Bsucc)) == head)
+        return false;
+
+    // The test (i relop N) is the last thing evaluated
+    elem *test = head->Belem;
+    while (test->Eoper == OPcomma)
+        test = test->E2;
+    switch (test->Eoper)
+    {
+        case OPlt:
+        case OPle:
+        case OPgt:
+        case OPge:
+        case OPeqeq:
+        case OPne:
+            break;
+        default:
+            return false;
+    }
+    elem *ev = test->E1;
+    if (ev->Eoper != OPvar || ev->EV.sp.Voffset != 0 ||
+        !tyintegral(ev->Ety) || ev->Ety & mTYvolatile ||
+        tysize(ev->Ety) != tysize(test->E2->Ety))
+        return false;
+
+    // i must be a basic IV, stepped by a constant on every pass
+    findbasivs(l);
+    elem *incr = nullptr;
+    for (Iv *biv = l->Livlist; biv; biv = biv->IVnext)
+    {
+        if (biv->IVbasic == ev->EV.sp.Vsym)
+        {
+            incr = *biv->IVincr;
+            break;
+        }
+    }
+    freeivlist(l->Livlist);
+    l->Livlist = nullptr;
+    if (!incr || incr->E2->Eoper != OPconst ||
+        incr->E1->EV.sp.Voffset != 0 ||
+        tysize(incr->E1->Ety) != tysize(ev->Ety) ||
+        !unrollspine(head->Belem, incr))
+        return false;
+    targ_llong c = el_tolong(incr->E2);
+    if (incr->Eoper == OPminass || incr->Eoper == OPpostdec)
+        c = -c;
+    if (c == 0)
+        return false;
+
+    *ptest = test;
+    *pincr = incr;
+    *pstep = c;
+    return true;
+}
+
+/*********************************
+ * Build the test that the next span / step passes of the loop
+ * with (test) stepping its IV by step will all be done. For (i < N) that is
+ *      i < N && (unsigned)(N - i) > span
+ * which cannot overflow.
+ * Returns:
+ *      the test, nullptr if it can't be built
+ */
+
+STATIC elem *unrollguard(elem *test, targ_llong step, targ_ullong span)
+{
+    bool up;
+    switch (test->Eoper)
+    {
+        case OPlt:
+        case OPle:
+            up = true;
+            break;
+        case OPgt:
+        case OPge:
+            up = false;
+            break;
+        default:
+            return nullptr;
+    }
+    if (up ? step <= 0 : step >= 0)
+        return nullptr;
+    tym_t tyu = touns(test->E1->Ety);
+    if (unrollwrap(tyu, span) != span)
+        return nullptr;
+
+    elem *diff = el_bin(OPmin, tyu,
+        el_copytree(up ? test->E2 : test->E1),
+        el_copytree(up ? test->E1 : test->E2));
+    diff->E1->Ety = tyu;
+    diff->E2->Ety = tyu;
+    unsigned op = (test->Eoper == OPlt || test->Eoper == OPgt) ? OPgt : OPge;
+    return el_bin(OPandand, test->Ety,
+        el_copytree(test),
+        el_bin(op, test->Ety, diff, el_long(tyu, span)));
+}
+
+/*********************************
+ * Link in a copy of the single block loop head that does several
+ * passes for each test, keeping head for the remaining passes:
+ *
+ *      prehead: ...
+ *      bg:      if (guard) goto bb; else goto head;
+ *      bb:      body; if (guard) goto bb;
+ *      bt:      if (i relop N) goto head; else goto exit;
+ *      head:    body; if (i relop N) goto head;
+ *      exit:
+ */
+
+STATIC void unrollsplice(block *head, block *bg, block *bb, block *bt)
+{
+    block *pre = list_block(head->Bpred) == head
+        ? list_block(list_next(head->Bpred)) : list_block(head->Bpred);
+    block *exit = list_block(list_next(head->Bsucc));
+    assert(list_block(pre->Bsucc) == head);
+
+    // Link the new blocks in just ahead of head
+    if (startblock == head)
+        startblock = bg;
+    else
+    {
+        block *b;
+        for (b = startblock; b->Bnext != head; b = b->Bnext)
+            assert(b->Bnext);
+        b->Bnext = bg;
+    }
+    bg->Bnext = bb;
+    bb->Bnext = bt;
+    bt->Bnext = head;
+
+    list_ptr(pre->Bsucc) = (void *)bg;
+    list_subtract(&head->Bpred, pre);
+    list_append(&bg->Bpred, pre);
+    list_append(&bg->Bsucc, bb);
+    list_append(&bg->Bsucc, head);
+    list_append(&bb->Bpred, bg);
+    list_append(&bb->Bpred, bb);
+    list_append(&bb->Bsucc, bb);
+    list_append(&bb->Bsucc, bt);
+    list_append(&bt->Bpred, bb);
+    list_append(&bt->Bsucc, head);
+    list_append(&bt->Bsucc, exit);
+    list_append(&head->Bpred, bg);
+    list_append(&head->Bpred, bt);
+    list_append(&exit->Bpred, bt);
+}
+
+/*********************************
+ * Unroll loop l, if it has the right shape.
+ * Input:
+ *      go.defnod[] and reaching definitions are up to date
+ * Returns:
+ *      true if the flow graph was changed
+ */
+
+STATIC bool loopunroll(loop *l)
+{
+    block *head = l->Lhead;
+
+    elem *test;
+    elem *incr;
+    targ_llong c;
+    if (!unrolliv(l, &test, &incr, &c))
+        return false;
+    int nodes = unrollnodes(head->Belem);
+    if (nodes < 0)
+        return false;
+    elem *ev = test->E1;
+    tym_t ty = ev->Ety;
+
+    /* If the trip count is small and known, replace the loop with
+     * that many copies of head.
+     */
+    targ_llong init;
+    if (test->E2->Eoper == OPconst && unrollinit(l, ev, &init))
+    {
+        targ_ullong i = unrollwrap(ty, init);
+        targ_ullong n = unrollwrap(ty, el_tolong(test->E2));
+        unsigned count = 0;
+        do
+        {
+            if (++count > config.unroll)
+                break;
+            i = unrollwrap(ty, i + c);
+        } while (unrolltest(test->Eoper, ty, i, n));
+
+        if (count <= config.unroll && count * nodes <= UNROLL_MAXNODES)
+        {
+            cmes3("Unrolling loop %p %d times\n", l, count);
+            elem *e = nullptr;
+            for (unsigned j = 1; j < count; j++)
+                e = el_combine(e, el_copytree(head->Belem));
+            head->Belem = el_combine(e, head->Belem);
+            head->BC = BCgoto;
+            list_subtract(&head->Bsucc, head);
+            list_subtract(&head->Bpred, head);
+            go.changes++;
+            return true;
+        }
+    }
+
+    /* Otherwise, when optimizing for speed, make a copy of the loop
+     * that does factor passes for each test, and keep the original
+     * for the remaining passes. The guard is true if the next
+     * factor - 1 tests of (i relop N) are sure to be true.
+     */
+    if (!(go.mfoptim & MFtime))
+        return false;
+
+    unsigned factor = config.unroll / 2;
+    while (factor >= 2 && factor * nodes > UNROLL_MAXNODES)
+        factor--;
+    if (factor < 2 || numblks + 3 > maxblks)
+        return false;
+
+    targ_llong step = c < 0 ? -c : c;
+    if (step > 0x10000 ||
+        !unrollinvariant(l, test->E2, ev->EV.sp.Vsym))
+        return false;
+    elem *guard = unrollguard(test, c, (factor - 1) * step);
+    if (!guard)
+        return false;
+
+    cmes3("Unrolling loop %p by %d\n", l, factor);
+    elem *e = nullptr;
+    for (unsigned j = 0; j < factor; j++)
+        e = el_combine(e, el_copytree(head->Belem));
+    block *bg = unrollblock(head, BCiftrue, el_copytree(guard));
+    block *bb = unrollblock(head, BCiftrue, el_combine(e, guard));
+    block *bt = unrollblock(head, BCiftrue, el_copytree(test));
+    bb->Bflags |= BFLunrolled;
+    head->Bflags |= BFLunrolled;
+    unrollsplice(head, bg, bb, bt);
+    go.changes++;
+    return true;
+}
+
+/*********************************
+ * Loop vectorization.
+ * A single block loop of the form:
+ *
+ *      head:    *(p + i * sz) = expr; i += 1; if (i < N) goto head;
+ *
+ * where expr is made of loads *(q + i * sz), loop invariant scalars and
+ * operators the XMM registers can do 16 bytes at a time, is given a copy
+ * that does 16 / sz passes at once with OPvector loads and OPvecsto
+ * stores. The original loop is kept for the passes left over, and for
+ * when a store to p[] could change a q[] element still to be loaded.
+ */
+
+#define VEC_MAXNODES    32      // max elem nodes in a vectorized expression
+#define VEC_MAXLOADS    8       // max loads in a vectorized expression
+
+struct Vec
+{
+    loop *l;
+    symbol *iv;
+    tym_t ty;                   // element type
+    tym_t tyv;                  // vector type
+    unsigned sz;                // element size
+    int nodes;
+    unsigned nloads;
+    elem *loads[VEC_MAXLOADS];  // each OPind loaded
+};
+
+/*********************************
+ * Returns:
+ *      the vector type holding elements of type ty, 0 if none
+ */
+
+STATIC tym_t vectype(tym_t ty)
+{
+    switch (tybasic(ty))
+    {
+        case TYfloat:   return TYfloat4;
+        case TYdouble:  return TYdouble2;
+        case TYint:
+        case TYlong:    return TYlong4;
+        case TYuint:
+        case TYulong:   return TYulong4;
+        case TYllong:   return TYllong2;
+        case TYullong:  return TYullong2;
+    }
+    return 0;
+}
+
+/*********************************
+ * Match e against the address of element i of an array:
+ *      (i * sz) + base
+ * where the scaling can be a shift, and i can be widened.
+ * Returns:
+ *      base if it does not change in the loop, nullptr if no match
+ */
+
+STATIC elem *vecaddr(Vec *v, elem *e)
+{
+    if (e->Eoper != OPadd)
+        return nullptr;
+    elem *ex = e->E1;
+    elem *base = e->E2;
+    if (base->Eoper == OPshl || base->Eoper == OPmul)
+    {
+        ex = e->E2;
+        base = e->E1;
+    }
+    if (ex->Eoper == OPshl)
+    {
+        if (ex->E2->Eoper != OPconst || (1ULL << el_tolong(ex->E2)) != v->sz)
+            return nullptr;
+    }
+    else if (ex->Eoper == OPmul)
+    {
+        if (ex->E2->Eoper != OPconst || el_tolong(ex->E2) != v->sz)
+            return nullptr;
+    }
+    else
+        return nullptr;
+    ex = ex->E1;
+    if (ex->Eoper == OPs32_64 || ex->Eoper == OPu32_64)
+        ex = ex->E1;
+    if (ex->Eoper != OPvar || ex->EV.sp.Vsym != v->iv || ex->EV.sp.Voffset != 0)
+        return nullptr;
+    if (!typtr(base->Ety) || !unrollinvariant(v->l, base, v->iv))
+        return nullptr;
+    return base;
+}
+
+/*********************************
+ * Returns:
+ *      true if e can be computed a vector at a time
+ */
+
+STATIC bool vecexpr(Vec *v, elem *e)
+{
+    if (++v->nodes > VEC_MAXNODES || e->Ety & mTYvolatile ||
+        tybasic(e->Ety) != tybasic(v->ty))
+        return false;
+    bool isfloat = tyfloating(v->ty);
+    switch (e->Eoper)
+    {
+        case OPind:
+        {
+            elem *base = vecaddr(v, e->E1);
+            if (!base || v->nloads == VEC_MAXLOADS)
+                return false;
+            /* A load done twice would be made a CSE, and cdvector()
+             * can't load an OPind CSE that isn't aligned.
+             */
+            for (unsigned i = 0; i < v->nloads; i++)
+            {
+                if (el_match(v->loads[i], e))
+                    return false;
+            }
+            v->loads[v->nloads++] = e;
+            return true;
+        }
+
+        case OPvar:
+        case OPconst:
+            // OPvecfill of a long long does not work
+            return v->sz == 4 || isfloat ?
+                unrollinvariant(v->l, e, v->iv) : false;
+
+        case OPmul:
+        case OPdiv:
+            if (!isfloat)
+                return false;
+            break;
+
+        case OPand:
+        case OPor:
+        case OPxor:
+            if (isfloat)
+                return false;
+            break;
+
+        case OPadd:
+        case OPmin:
+            break;
+
+        default:
+            return false;
+    }
+    return vecexpr(v, e->E1) && vecexpr(v, e->E2);
+}
+
+/*********************************
+ * Build the vector version of e, which passed vecexpr().
+ */
+
+STATIC elem *vecbuild(Vec *v, elem *e)
+{
+    switch (e->Eoper)
+    {
+        case OPind:
+        {
+            unsigned op = tyfloating(v->ty)
+                ? (v->sz == 4 ? LODUPS : LODUPD)
+                : LODDQU;
+            elem *ea = el_una(OPind, v->tyv, el_copytree(e->E1));
+            return el_una(OPvector, v->tyv, el_param(el_long(TYint, op), ea));
+        }
+
+        case OPvar:
+        case OPconst:
+            return el_una(OPvecfill, v->tyv, el_copytree(e));
+
+        default:
+            return el_bin(e->Eoper, v->tyv, vecbuild(v, e->E1), vecbuild(v, e->E2));
+    }
+}
+
+/*********************************
+ * Vectorize loop l, if it has the right shape.
+ * Input:
+ *      go.defnod[] and reaching definitions are up to date
+ * Returns:
+ *      true if the flow graph was changed
+ */
+
+STATIC bool loopvector(loop *l)
+{
+    block *head = l->Lhead;
+
+    elem *test;
+    elem *incr;
+    targ_llong c;
+    if (!unrolliv(l, &test, &incr, &c) ||
+        c != 1 || (test->Eoper != OPlt && test->Eoper != OPle) ||
+        numblks + 3 > maxblks)
+        return false;
+
+    // The body must be just (store, incr, test)
+    elem *e = head->Belem;
+    if (e->Eoper != OPcomma)
+        return false;
+    elem *es;
+    if (e->E1->Eoper == OPcomma && e->E1->E2 == incr && e->E2 == test)
+        es = e->E1->E1;
+    else if (e->E2->Eoper == OPcomma && e->E2->E1 == incr && e->E2->E2 == test)
+        es = e->E1;
+    else
+        return false;
+
+    switch (es->Eoper)
+    {
+        case OPeq:
+        case OPaddass:
+        case OPminass:
+        case OPmulass:
+        case OPdivass:
+        case OPandass:
+        case OPorass:
+        case OPxorass:
+            break;
+        default:
+            return false;
+    }
+    Vec v;
+    v.l = l;
+    v.iv = test->E1->EV.sp.Vsym;
+    v.ty = tybasic(es->Ety);
+    v.tyv = vectype(v.ty);
+    if (!v.tyv || es->E1->Eoper != OPind ||
+        es->E1->Ety & mTYvolatile || tybasic(es->E1->Ety) != v.ty ||
+        !unrollinvariant(l, test->E2, v.iv))
+        return false;
+    v.sz = tysize(v.ty);
+    v.nodes = 0;
+    v.nloads = 0;
+    elem *store = vecaddr(&v, es->E1->E1);
+    if (!store || !vecexpr(&v, es->E2))
+        return false;
+
+    unsigned op = es->Eoper;
+    if (op != OPeq)
+    {
+        op = op == OPaddass ? OPadd :
+             op == OPminass ? OPmin :
+             op == OPmulass ? OPmul :
+             op == OPdivass ? OPdiv :
+             op == OPandass ? OPand :
+             op == OPorass  ? OPor  : OPxor;
+        elem ex;
+        ex.Eoper = op;
+        ex.Ety = v.ty;
+        ex.E1 = es->E1;
+        ex.E2 = es->E2;
+        v.nodes = 0;
+        v.nloads = 0;
+        if (!vecexpr(&v, &ex))
+            return false;
+    }
+
+    unsigned n = 16 / v.sz;
+    elem *guard = unrollguard(test, c, n - 1);
+    if (!guard)
+        return false;
+
+    /* The vector loop loads n elements of each q[] before storing to p[].
+     * That is only the same as the scalar loop if p[] is not just after
+     * q[] in memory, i.e. (unsigned)(p - q - 1) >= 16 - 1.
+     */
+    elem *ealias = nullptr;
+    for (unsigned i = 0; i < v.nloads; i++)
+    {
+        elem *q = vecaddr(&v, v.loads[i]->E1);
+        if (el_match(q, store))
+            continue;
+        elem *diff = el_bin(OPmin, TYsize_t, el_copytree(store), el_copytree(q));
+        diff->E1->Ety = TYsize_t;
+        diff->E2->Ety = TYsize_t;
+        diff = el_bin(OPmin, TYsize_t, diff, el_long(TYsize_t, 1));
+        elem *ec = el_bin(OPge, TYbool, diff, el_long(TYsize_t, 16 - 1));
+        ealias = ealias ? el_bin(OPandand, TYbool, ealias, ec) : ec;
+    }
+
+    cmes3("Vectorizing loop %p by %d\n", l, n);
+    elem *ev;
+    if (op == OPeq)
+        ev = vecbuild(&v, es->E2);
+    else
+    {
+        elem *ex = el_bin(op, v.ty, el_copytree(es->E1), el_copytree(es->E2));
+        ev = vecbuild(&v, ex);
+        el_free(ex);
+    }
+    unsigned sto = tyfloating(v.ty)
+        ? (v.sz == 4 ? STOUPS : STOUPD)
+        : STODQU;
+    elem *evs = el_bin(OPvecsto, v.tyv,
+        el_una(OPind, v.tyv, el_copytree(es->E1->E1)),
+        el_param(el_long(TYint, sto), ev));
+    elem *ei = el_copytree(incr);
+    el_free(ei->E2);
+    ei->E2 = el_long(incr->E2->Ety, n);
+
+    block *bg = unrollblock(head, BCiftrue,
+        ealias ? el_bin(OPandand, guard->Ety, el_copytree(guard), ealias)
+               : el_copytree(guard));
+    block *bb = unrollblock(head, BCiftrue, el_combine(el_combine(evs, ei), guard));
+    block *bt = unrollblock(head, BCiftrue, el_copytree(test));
+    bb->Bflags |= BFLunrolled;
+    head->Bflags |= BFLunrolled;
+    unrollsplice(head, bg, bb, bt);
+    go.changes++;
+    return true;
+}
+
+/*********************************
+ * Vectorize the first loop in the list that can be.
+ * Returns:
+ *      true if the flow graph was changed, and the loops need to be
+ *      found again
+ */
+
+STATIC bool vectorloops(loop *startloop)
+{
+    if (!I64 || !config.fpxmmregs)
+        return false;
+    bool flowdone = false;
+    for (loop *l = startloop; l; l = l->Lnext)
+    {
+        block *head = l->Lhead;
+        if (head != l->Ltail || head->BC != BCiftrue ||
+            head->Bflags & BFLunrolled)
+            continue;
+        if (!flowdone)
+        {
+            flowrd();
+            flowdone = true;
+            if (go.deftop == 0)
+                break;
+        }
+        if (loopvector(l))
+            return true;
+    }
+    return false;
+}
+
+/*********************************
+ * Unroll the first loop in the list that can be.
+ * Returns:
+ *      true if the flow graph was changed, and the loops need to be
+ *      found again
+ */
+
+STATIC bool unrollloops(loop *startloop)
+{
+    bool flowdone = false;
+    for (loop *l = startloop; l; l = l->Lnext)
+    {
+        block *head = l->Lhead;
+        if (head != l->Ltail || head->BC != BCiftrue || head->Bflags & BFLunrolled)
+            continue;
+        if (!flowdone)
+        {
+            flowrd();
+            flowdone = true;
+            if (go.deftop == 0)
+                break;
+        }
+        if (loopunroll(l))
+            return true;
+    }
+    return false;
+}
+
 static int gref;                // parameter for markinvar()
 static block *gblock;           // parameter for markinvar()
 static vec_t lv;                // parameter for markinvar()
@@ -784,6 +1609,23 @@ restart:
         addblk = FALSE;
     }
 
+    if (!go.loopxform)
+    {
+        // Leave them until the loops have settled, see optfunc()
+        for (l = startloop; l && (config.unroll || go.mfoptim & MFtime); l = l->Lnext)
+        {
+            block *head = l->Lhead;
+            if (head == l->Ltail && head->BC == BCiftrue && !(head->Bflags & BFLunrolled))
+                go.simpleloops = true;
+        }
+    }
+    else if (go.mfoptim & MFtime && vectorloops(startloop) ||
+             config.unroll && unrollloops(startloop))
+    {
+        compdfo();
+        goto restart;
+    }
+
     /* Do the loop optimizations. Note that accessing the loops */
     /* starting from startloop will access them in least nested */
     /* one first, thus moving LIs out as far as possible.       */
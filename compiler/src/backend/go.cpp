@@ -231,6 +231,8 @@ void optfunc()
     // Some functions can take enormous amounts of time to optimize.
     // We try to put a lid on it.
     starttime = clock();
+    go.loopxform = false;
+    go.simpleloops = false;
     do
     {
         //printf("iter = %d\n", iter);
@@ -323,7 +325,16 @@ void optfunc()
 
         cmes2 ("changes = %d\n", go.changes);
         if (!(go.changes && go.mfoptim & MFloop && (clock() - starttime) < 30 * CLOCKS_PER_SEC))
-            break;
+        {
+            /* Once copy propagation and dead assignment removal have
+             * settled the loops into shape, go around again to unroll
+             * and vectorize them.
+             */
+            if (go.loopxform || !go.simpleloops ||
+                (clock() - starttime) >= 30 * CLOCKS_PER_SEC)
+                break;
+            go.loopxform = true;
+        }
     } while (1);
     cmes2("%d iterations\n",iter);
     if (go.mfoptim & MFdc)
@@ -340,6 +351,9 @@ void optfunc()
         builddags();                /* common subexpressions         */
     if (go.mfoptim & MFdv)
         deadvar();                  /* eliminate dead variables      */
+    profile_weights();              // weigh blocks by the profile
+    if (go.mfoptim & MFdc)
+        block_layout();             // move cold blocks out of the way
 
 #ifdef DEBUG
     if (debugb)
@@ -51,6 +51,8 @@ struct Go
 {
     mftype mfoptim;
     unsigned changes;   // # of optimizations performed
+    bool loopxform;     // unroll and vectorize loops in loopopt()
+    bool simpleloops;   // loopopt() found loops it could unroll or vectorize
 
     struct DN *defnod;  // array of definition elems
     unsigned deftop;    // # of entries in defnod[]
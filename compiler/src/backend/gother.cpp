@@ -29,7 +29,8 @@ STATIC void rd_compute();
 STATIC void conpropwalk(elem *n , vec_t IN);
 STATIC void chkrd(elem *n , list_t rdlist);
 STATIC elem * chkprop(elem *n , list_t rdlist);
-STATIC void arrayboundsrds(void);
+STATIC void boundschecks(void);
+STATIC int bnddefs(elem *e);
 STATIC void eqeqranges(void);
 STATIC void intranges(void);
 STATIC int loopcheck(block *start , block *inc , block *rel);
@@ -95,6 +96,7 @@ void constprop()
 {
     rd_compute();
     intranges();                // compute integer ranges
+    boundschecks();             // remove bounds checks that can't fail
     //eqeqranges();               // see if we can eliminate some relationals
     elemdatafree(&eqeqlist);
     elemdatafree(&rellist);
@@ -785,6 +787,714 @@ STATIC int loopcheck(block *start,block *inc,block *rel)
     return FALSE;
 }
 
+/*************************** Bounds Check Elimination ***************************/
+
+/* An array bounds check is the elem (i < length || _d_arrayboundsp(...)),
+ * where the call never returns. In a loop over a slice the relational
+ * has usually been tested already, by the loop condition or by a check
+ * of the same index earlier in the loop. For each pair of index i and
+ * bound y found in the checks, follow what is known about the range of
+ * i relative to y through the flow graph, and remove the checks that
+ * cannot fail.
+ */
+
+#define BNDMAX  0x40000000      // largest range values followed
+
+struct Bounds
+{
+    bool top;                   // nothing reaches here yet
+    bool hasival;               // i == ival
+    targ_ullong ival;
+    targ_ullong dist;           // y - i >= dist, if y is a variable
+    targ_ullong ymin;           // y >= ymin, if y is a variable
+    targ_ullong imax;           // i <= imax, if y is a constant
+    bool yeq;                   // w == y
+};
+
+// The index and bound being followed
+static Symbol *bndisym;
+static targ_size_t bndioff;
+static Symbol *bndysym;         // nullptr if the bound is a constant
+static targ_size_t bndyoff;
+static Symbol *bndwsym;         // a copy w of y, as for foreach over a slice
+static targ_size_t bndwoff;
+static unsigned bndsize;
+
+static int bndremoved;
+
+/*************************
+ * Return !=0 if e is a variable that the flow analysis can follow:
+ * a local or parameter only changed by direct assignments to it.
+ */
+
+STATIC int bndvar(elem *e)
+{
+    if (e->Eoper != OPvar || !tyintegral(e->Ety) || tysize(e->Ety) < 4)
+        return 0;
+    symbol *s = e->EV.sp.Vsym;
+    return sytab[s->Sclass] & SCSS && s->Sflags & SFLunambig &&
+        !(s->ty() & mTYvolatile);
+}
+
+STATIC int bndisi(elem *e)
+{
+    return e->Eoper == OPvar && e->EV.sp.Vsym == bndisym &&
+        e->EV.sp.Voffset == bndioff && tysize(e->Ety) == bndsize;
+}
+
+STATIC int bndisy(elem *e)
+{
+    return bndysym && e->Eoper == OPvar && e->EV.sp.Vsym == bndysym &&
+        e->EV.sp.Voffset == bndyoff && tysize(e->Ety) == bndsize;
+}
+
+STATIC int bndisw(elem *e)
+{
+    return bndwsym && e->Eoper == OPvar && e->EV.sp.Vsym == bndwsym &&
+        e->EV.sp.Voffset == bndwoff && tysize(e->Ety) == bndsize;
+}
+
+/*************************
+ * Return !=0 if e is y, or a copy of it known from st.
+ */
+
+STATIC int bndisbound(elem *e, Bounds *st)
+{
+    return bndisy(e) || st->yeq && bndisw(e);
+}
+
+/*************************
+ * If e is an unsigned compare of the size being followed, return it
+ * as (*pl < *pr) or (*pl <= *pr) for when e has value truth.
+ * Otherwise return 0.
+ */
+
+STATIC unsigned bndrel(elem *e, int truth, elem **pl, elem **pr)
+{
+    unsigned op = e->Eoper;
+    if (op != OPlt && op != OPle && op != OPgt && op != OPge)
+        return 0;
+    if (!tyintegral(e->E1->Ety) || !tyuns(e->E1->Ety) || tysize(e->E1->Ety) != bndsize)
+        return 0;
+    if (!truth)
+        op = rel_not(op);
+    if (op == OPgt || op == OPge)
+    {   *pl = e->E2;
+        *pr = e->E1;
+        return rel_swap(op);
+    }
+    *pl = e->E1;
+    *pr = e->E2;
+    return op;
+}
+
+/*************************
+ * The distance from i up to y known from st.
+ */
+
+STATIC targ_ullong bnddist(Bounds *st)
+{
+    targ_ullong d = st->dist;
+    if (st->hasival && st->ymin > st->ival && st->ymin - st->ival > d)
+        d = st->ymin - st->ival;
+    return d;
+}
+
+STATIC targ_ullong bndimax(Bounds *st)
+{
+    return st->hasival && st->ival < st->imax ? st->ival : st->imax;
+}
+
+STATIC void bndbottom(Bounds *st)
+{
+    st->top = false;
+    st->hasival = false;
+    st->dist = 0;
+    st->ymin = 0;
+    st->imax = ~(targ_ullong)0;
+    st->yeq = false;
+}
+
+STATIC int bndequal(Bounds *st, Bounds *st2)
+{
+    if (st->top || st2->top)
+        return st->top == st2->top;
+    return st->hasival == st2->hasival &&
+        (!st->hasival || st->ival == st2->ival) &&
+        st->dist == st2->dist && st->ymin == st2->ymin && st->imax == st2->imax &&
+        st->yeq == st2->yeq;
+}
+
+/*************************
+ * Merge st2 into st, for where two paths come together.
+ */
+
+STATIC void bndmeet(Bounds *st, Bounds *st2)
+{
+    if (st2->top)
+        return;
+    if (st->top)
+    {   *st = *st2;
+        return;
+    }
+    st->dist = bnddist(st);
+    st->imax = bndimax(st);
+    targ_ullong d2 = bnddist(st2);
+    targ_ullong m2 = bndimax(st2);
+    if (st->hasival && (!st2->hasival || st2->ival != st->ival))
+        st->hasival = false;
+    if (d2 < st->dist)
+        st->dist = d2;
+    if (st2->ymin < st->ymin)
+        st->ymin = st2->ymin;
+    if (m2 > st->imax)
+        st->imax = m2;
+    st->yeq &= st2->yeq;
+}
+
+/*************************
+ * Add to st what is known after both st and st2.
+ */
+
+STATIC void bndjoin(Bounds *st, Bounds *st2)
+{
+    if (st2->dist > st->dist)
+        st->dist = st2->dist;
+    if (st2->ymin > st->ymin)
+        st->ymin = st2->ymin;
+    if (st2->imax < st->imax)
+        st->imax = st2->imax;
+    st->yeq |= st2->yeq;
+}
+
+/*************************
+ * Add to st what is known when condition e has value truth.
+ */
+
+STATIC void bndcond(elem *e, int truth, Bounds *st)
+{
+    elem *l, *r;
+
+    while (e->Eoper == OPcomma)
+        e = e->E2;
+    if (bnddefs(e))
+        return;                 // the operands may not be what was tested
+    switch (e->Eoper)
+    {
+        case OPandand:
+            if (truth)
+            {   bndcond(e->E1, truth, st);
+                bndcond(e->E2, truth, st);
+            }
+            return;
+
+        case OPoror:
+            if (!truth)
+            {   bndcond(e->E1, truth, st);
+                bndcond(e->E2, truth, st);
+            }
+            return;
+
+        case OPnot:
+            bndcond(e->E1, !truth, st);
+            return;
+
+        case OPbool:
+            e = e->E1;
+            /* FALL-THROUGH */
+        case OPvar:
+            // y != 0
+            if (truth && bndisbound(e, st) && st->ymin < 1)
+                st->ymin = 1;
+            return;
+
+        case OPne:
+        case OPeqeq:
+            if ((e->Eoper == OPne) == (truth != 0) &&
+                bndisbound(e->E1, st) && e->E2->Eoper == OPconst && el_tolong(e->E2) == 0 &&
+                st->ymin < 1)
+                st->ymin = 1;
+            return;
+    }
+
+    unsigned op = bndrel(e, truth, &l, &r);
+    if (!op)
+        return;
+    if (bndisi(l))
+    {
+        if (bndisbound(r, st))
+        {   // i < y
+            if (op == OPlt && st->dist < 1)
+                st->dist = 1;
+        }
+        else if (!bndysym && r->Eoper == OPconst)
+        {   // i < K
+            targ_ullong k = el_tolong(r);
+            if (op == OPlt)
+            {   if (k == 0)
+                    return;
+                k--;
+            }
+            if (k < st->imax)
+                st->imax = k;
+        }
+    }
+    else if (l->Eoper == OPconst && bndisbound(r, st))
+    {   // K < y
+        targ_ullong k = el_tolong(l);
+        if (k < BNDMAX)
+        {   if (op == OPlt)
+                k++;
+            if (k > st->ymin)
+                st->ymin = k;
+        }
+    }
+    else if (l->Eoper == OPconst && r->Eoper == OPmin &&
+             bndisbound(r->E1, st) && bndisi(r->E2) && bnddist(st) >= 1)
+    {   // K < y - i, where i < y so the subtraction does not wrap
+        targ_ullong k = el_tolong(l);
+        if (k < BNDMAX)
+        {   if (op == OPlt)
+                k++;
+            if (k > st->dist)
+                st->dist = k;
+        }
+    }
+}
+
+/*************************
+ * If e is a bounds check of i, return the relational of the check.
+ * Set *pc to the constant added to i, and *pr to the bound.
+ */
+
+STATIC elem *bndcheck(elem *e, targ_ullong *pc, elem **pr)
+{
+    elem *l, *r;
+
+    if (e->Eoper != OPoror || !el_noreturn(e->E2))
+        return nullptr;
+    if (bndrel(e->E1, 1, &l, &r) != OPlt)
+        return nullptr;
+    *pc = 0;
+    if (l->Eoper == OPadd && l->E2->Eoper == OPconst)
+    {   *pc = el_tolong(l->E2);
+        if (*pc >= BNDMAX)
+            return nullptr;
+        l = l->E1;
+    }
+    if (!bndisi(l))
+        return nullptr;
+    if (bndysym ? !bndisy(r) : r->Eoper != OPconst)
+        return nullptr;
+    *pr = r;
+    return e->E1;
+}
+
+/*************************
+ * Return !=0 if e modifies i, y or w.
+ */
+
+STATIC int bnddefs(elem *e)
+{
+    while (1)
+    {
+        elem_debug(e);
+        if (OTdef(e->Eoper) && e->E1->Eoper == OPvar &&
+            (e->E1->EV.sp.Vsym == bndisym || e->E1->EV.sp.Vsym == bndysym ||
+             e->E1->EV.sp.Vsym == bndwsym))
+            return 1;
+        if (e->Eoper == OPasm)
+            return 1;
+        if (EBIN(e))
+        {   if (bnddefs(e->E2))
+                return 1;
+        }
+        else if (!EUNA(e))
+            return 0;
+        e = e->E1;
+    }
+}
+
+/*************************
+ * Return !=0 if the variable ev overlaps the one being followed at off.
+ */
+
+STATIC int bndoverlap(elem *ev, targ_size_t off)
+{
+    if (tybasic(ev->Ety) == TYstruct || tybasic(ev->Ety) == TYarray)
+        return 1;
+    targ_size_t o = ev->EV.sp.Voffset;
+    return o < off + bndsize && off < o + tysize(ev->Ety);
+}
+
+/*************************
+ * Update st for the assignment e to a variable.
+ */
+
+STATIC void bnddef(elem *e, Bounds *st)
+{
+    symbol *s = e->E1->EV.sp.Vsym;
+    if (s == bndisym && bndoverlap(e->E1, bndioff))
+    {
+        targ_ullong c = 0;
+        int iconst = EBIN(e) && e->E2->Eoper == OPconst;
+        if (iconst)
+            c = el_tolong(e->E2);
+        if (!bndisi(e->E1) || !iconst || c >= BNDMAX)
+            goto killi;
+        switch (e->Eoper)
+        {
+            case OPeq:
+                st->hasival = true;
+                st->ival = c;
+                st->dist = 0;
+                st->imax = c;
+                break;
+
+            case OPaddass:
+            case OPpostinc:
+            {   targ_ullong d = bnddist(st);
+                st->dist = d > c ? d - c : 0;
+                targ_ullong m = bndimax(st);
+                st->imax = m < BNDMAX ? m + c : ~(targ_ullong)0;
+                if (st->hasival)
+                {   st->ival += c;
+                    st->hasival = st->ival < BNDMAX;
+                }
+                break;
+            }
+
+            case OPminass:
+            case OPpostdec:
+                // Only when i cannot wrap around below 0
+                if (!st->hasival || st->ival < c)
+                    goto killi;
+                st->ival -= c;
+                st->dist = bnddist(st);
+                st->imax = st->ival;
+                break;
+
+            default:
+            killi:
+                st->hasival = false;
+                st->dist = 0;
+                st->imax = ~(targ_ullong)0;
+                break;
+        }
+    }
+    if (s == bndysym && bndoverlap(e->E1, bndyoff))
+    {
+        st->dist = 0;
+        st->ymin = 0;
+        st->yeq = false;
+    }
+    if (s == bndwsym && bndoverlap(e->E1, bndwoff))
+        st->yeq = e->Eoper == OPeq && bndisw(e->E1) && bndisy(e->E2);
+}
+
+/*************************
+ * Follow the range of i through the evaluation of e,
+ * removing bounds checks that cannot fail if remove is set.
+ */
+
+STATIC void bndwalk(elem *e, Bounds *st, int remove)
+{
+    while (1)
+    {
+        elem_debug(e);
+        unsigned op = e->Eoper;
+        targ_ullong c;
+        elem *erel, *ebound;
+
+        if (op == OPcomma)
+        {   bndwalk(e->E1, st, remove);
+            e = e->E2;
+            continue;
+        }
+
+        if ((erel = bndcheck(e, &c, &ebound)) != nullptr)
+        {
+            int safe = bndysym ? bnddist(st) > c
+                               : bndimax(st) < BNDMAX && bndimax(st) + c < (targ_ullong)el_tolong(ebound);
+            if (safe)
+            {
+                if (remove)
+                {
+#ifdef DEBUG
+                    if (debugc)
+                    {   dbg_printf("bounds check removed: ");
+                        WReqn(erel);
+                        dbg_printf("\n");
+                    }
+#endif
+                    el_free(e->E1);
+                    el_free(e->E2);
+                    e->Eoper = OPconst;
+                    e->Ety = TYint;
+                    e->EV.Vllong = 1;
+                    bndremoved++;
+                }
+            }
+            else if (c == 0)
+                bndcond(erel, 1, st);   // the check passed
+            return;
+        }
+
+        if (op == OPandand || op == OPoror)
+        {   // E2 is evaluated only sometimes
+            bndwalk(e->E1, st, remove);
+            Bounds st2 = *st;
+            bndcond(e->E1, op == OPandand, &st2);
+            bndwalk(e->E2, &st2, remove);
+            bndmeet(st, &st2);
+            return;
+        }
+
+        if (op == OPcond)
+        {
+            bndwalk(e->E1, st, remove);
+            Bounds st2 = *st;
+            bndcond(e->E1, 1, st);
+            bndcond(e->E1, 0, &st2);
+            bndwalk(e->E2->E1, st, remove);
+            bndwalk(e->E2->E2, &st2, remove);
+            bndmeet(st, &st2);
+            return;
+        }
+
+        if (!bnddefs(e))
+        {   /* Without a def of i or y in e, the order the operands
+             * are evaluated in doesn't matter, as long as a check
+             * in one operand isn't relied on in the other.
+             */
+            if (EBIN(e))
+            {   Bounds st2 = *st;
+                bndwalk(e->E1, st, remove);
+                bndwalk(e->E2, &st2, remove);
+                bndjoin(st, &st2);
+            }
+            else if (EUNA(e))
+            {   e = e->E1;
+                continue;
+            }
+            return;
+        }
+
+        if (OTdef(op) && e->E1->Eoper == OPvar &&
+            (!EBIN(e) || !bnddefs(e->E2)))
+        {
+            if (EBIN(e))
+                bndwalk(e->E2, st, remove);
+            bnddef(e, st);
+            return;
+        }
+
+        // Defs in an order we don't follow
+        bndbottom(st);
+        return;
+    }
+}
+
+/*************************
+ * Remove bounds checks of the current index and bound that
+ * cannot fail.
+ */
+
+STATIC void bndflow(Bounds *in, unsigned *nchanges)
+{
+    for (unsigned i = 0; i < dfotop; i++)
+    {   in[i].top = true;
+        nchanges[i] = 0;
+    }
+    bndbottom(&in[startblock->Bdfoidx]);
+
+    int changes;
+    do
+    {
+        changes = 0;
+        for (unsigned i = 0; i < dfotop; i++)
+        {   block *b = dfo[i];
+
+            if (in[i].top)
+                continue;
+            Bounds out = in[i];
+            if (b->Belem)
+                bndwalk(b->Belem, &out, 0);
+            int n = 0;
+            for (list_t bl = b->Bsucc; bl; bl = list_next(bl), n++)
+            {   block *bs = list_block(bl);
+                Bounds st = out;
+
+                switch (b->BC)
+                {
+                    case BCiftrue:
+                        if (list_block(b->Bsucc) != list_block(list_next(b->Bsucc)))
+                            bndcond(b->Belem, n == 0, &st);
+                        break;
+
+                    case BCgoto:
+                    case BCswitch:
+                    case BCret:
+                    case BCretexp:
+                    case BCexit:
+                        break;
+
+                    default:
+                        // Exception handling, reached from anywhere
+                        bndbottom(&st);
+                        break;
+                }
+
+                Bounds *ps = &in[bs->Bdfoidx];
+                Bounds old = *ps;
+                bndmeet(ps, &st);
+                if (!bndequal(&old, ps))
+                {   /* Stop following a range that keeps
+                     * changing around a loop
+                     */
+                    if (++nchanges[bs->Bdfoidx] > 4 && !old.top)
+                    {   if (ps->dist < old.dist)
+                            ps->dist = 0;
+                        if (ps->ymin < old.ymin)
+                            ps->ymin = 0;
+                        if (ps->imax > old.imax)
+                            ps->imax = ~(targ_ullong)0;
+                    }
+                    changes = 1;
+                }
+            }
+        }
+    } while (changes);
+
+    for (unsigned i = 0; i < dfotop; i++)
+    {
+        if (in[i].top || !dfo[i]->Belem)
+            continue;
+        Bounds st = in[i];
+        bndwalk(dfo[i]->Belem, &st, 1);
+    }
+}
+
+/*************************
+ * Gather the index and bound of each bounds check in e.
+ */
+
+struct BndKey
+{
+    Symbol *isym;
+    targ_size_t ioff;
+    Symbol *ysym;
+    targ_size_t yoff;
+    unsigned size;
+};
+
+STATIC void bndgather(elem *e, BndKey *keys, unsigned *pnkeys, unsigned maxkeys)
+{
+    while (1)
+    {
+        elem_debug(e);
+        elem *l, *r;
+
+        if (e->Eoper == OPoror && OTrel(e->E1->Eoper) && el_noreturn(e->E2))
+        {
+            bndsize = tysize(e->E1->E1->Ety);
+            if (bndrel(e->E1, 1, &l, &r) == OPlt)
+            {
+                if (l->Eoper == OPadd && l->E2->Eoper == OPconst)
+                    l = l->E1;
+                if (bndvar(l) && (r->Eoper == OPconst || bndvar(r)))
+                {
+                    BndKey k;
+                    k.isym = l->EV.sp.Vsym;
+                    k.ioff = l->EV.sp.Voffset;
+                    k.ysym = r->Eoper == OPvar ? r->EV.sp.Vsym : nullptr;
+                    k.yoff = k.ysym ? r->EV.sp.Voffset : 0;
+                    k.size = bndsize;
+                    unsigned i;
+                    for (i = 0; i < *pnkeys; i++)
+                    {   BndKey *pk = &keys[i];
+                        if (pk->isym == k.isym && pk->ioff == k.ioff &&
+                            pk->ysym == k.ysym && pk->yoff == k.yoff && pk->size == k.size)
+                            break;
+                    }
+                    if (i == *pnkeys && i < maxkeys)
+                        keys[(*pnkeys)++] = k;
+                }
+            }
+        }
+        if (EBIN(e))
+            bndgather(e->E2, keys, pnkeys, maxkeys);
+        else if (!EUNA(e))
+            return;
+        e = e->E1;
+    }
+}
+
+/*************************
+ * Look in e for a copy w = y of the bound.
+ */
+
+STATIC void bndcopy(elem *e)
+{
+    while (1)
+    {
+        elem_debug(e);
+        if (e->Eoper == OPeq && bndisy(e->E2) && bndvar(e->E1) &&
+            e->E1->EV.sp.Vsym != bndisym && e->E1->EV.sp.Vsym != bndysym)
+        {
+            bndwsym = e->E1->EV.sp.Vsym;
+            bndwoff = e->E1->EV.sp.Voffset;
+            return;
+        }
+        if (EBIN(e))
+            bndcopy(e->E2);
+        else if (!EUNA(e))
+            return;
+        e = e->E1;
+    }
+}
+
+STATIC void boundschecks()
+{
+    const unsigned maxkeys = 16;
+    BndKey keys[maxkeys];
+    unsigned nkeys = 0;
+
+    cmes("boundschecks()\n");
+    for (unsigned i = 0; i < dfotop; i++)
+    {
+        if (dfo[i]->BC == BCasm)
+            return;
+        if (dfo[i]->Belem)
+            bndgather(dfo[i]->Belem, keys, &nkeys, maxkeys);
+    }
+    if (!nkeys)
+        return;
+
+    Bounds *in = (Bounds *) util_calloc(dfotop, sizeof(Bounds));
+    unsigned *nchanges = (unsigned *) util_calloc(dfotop, sizeof(unsigned));
+    bndremoved = 0;
+    for (unsigned k = 0; k < nkeys; k++)
+    {
+        bndisym = keys[k].isym;
+        bndioff = keys[k].ioff;
+        bndysym = keys[k].ysym;
+        bndyoff = keys[k].yoff;
+        bndsize = keys[k].size;
+        bndwsym = nullptr;
+        if (bndysym)
+        {   for (unsigned i = 0; i < dfotop && !bndwsym; i++)
+                if (dfo[i]->Belem)
+                    bndcopy(dfo[i]->Belem);
+        }
+        bndflow(in, nchanges);
+    }
+    util_free(nchanges);
+    util_free(in);
+    if (bndremoved)
+        go.changes++;
+}
+
 /****************************
  * Do copy propagation.
  * Copy propagation elems are of the form OPvar=OPvar, and they are
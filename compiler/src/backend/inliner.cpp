@@ -0,0 +1,931 @@
+// Copyright (C) 2021 by The D Language Foundation, All Rights Reserved
+// http://www.digitalmars.com
+// Written by Walter Bright
+/*
+ * This source file is made available for personal use
+ * only. The license is in backendlicense.txt
+ * For any other uses, please contact Digital Mars.
+ */
+
+// Expand calls to small functions in the intermediate code, after the
+// glue layer has turned them into blocks and elems. Unlike the front end
+// inliner, this sees the calls that only appear with the lowering, such as
+// those to postblits, destructors and array operation helpers, and it can
+// inline any statement the function is made of.
+
+#if !SPP
+
+#include        <stdio.h>
+#include        <string.h>
+#include        <stdlib.h>
+
+#include        "cc.hpp"
+#include        "global.hpp"
+#include        "oper.hpp"
+#include        "el.hpp"
+#include        "type.hpp"
+#include        "aa.hpp"
+#include        "tinfo.hpp"
+
+static char __file__[] = __FILE__;      /* for tassert.h                */
+#include        "tassert.hpp"
+
+#define INLINE_SIZE      40     // biggest function (in elems) inlined where it runs once
+#define INLINE_MAXSIZE   400    // biggest function kept for inlining
+#define INLINE_MAXBLOCKS 32     // most blocks of a function kept for inlining
+#define INLINE_GROWTH    2000   // most elems inlining may add to a function
+
+/* The intermediate code of a function kept for expanding in the
+ * functions generated after it.
+ */
+struct InlineFunc
+{
+    Symbol *sfunc;
+    Symbol **locals;            // the function's local symbols,
+    unsigned nlocals;           // starting with its nparams parameters
+    unsigned nparams;
+    tym_t tyret;                // type of the value returned, TYvoid if none
+    unsigned size;              // number of elems
+    unsigned nblocks;
+    bool expr;                  // is one block that returns, so is an expression
+    bool local;                 // refers to symbols private to the object file
+    InlineFunc *next;
+};
+
+static AArray *inline_table;            // InlineFunc's indexed by function Symbol
+static InlineFunc *inline_list;         // all of them
+static unsigned inline_growth;          // elems added to the function being expanded
+
+/*********************************
+ * Return true if symbol s is in the function's stack frame.
+ */
+
+static bool inline_isLocal(Symbol *s)
+{
+    switch (s->Sclass)
+    {
+        case SCauto:
+        case SCregister:
+        case SCparameter:
+        case SCfastpar:
+        case SCshadowreg:
+        case SCregpar:
+        case SCbprel:
+        case SCstack:
+        case SCpseudo:
+            return true;
+    }
+    return false;
+}
+
+/*********************************
+ * Look at the elems of a function for things that can't be inlined.
+ * Count them into fi->size.
+ * Returns:
+ *      false if the function can't be inlined
+ */
+
+static bool inline_checkElem(InlineFunc *fi, elem *e)
+{
+    while (1)
+    {
+        fi->size++;
+        switch (e->Eoper)
+        {
+            case OPframeptr:
+            case OPgot:
+            case OPva_start:
+            case OPctor:
+            case OPdtor:
+            case OPdctor:
+            case OPddtor:
+            case OPmark:
+            case OPinfo:
+            case OPsetjmp:
+            case OPasm:
+                return false;
+
+            case OPcall:
+            case OPucall:
+                if (e->E1->Eoper == OPvar && strcmp(e->E1->EV.sp.Vsym->Sident, "alloca") == 0)
+                    return false;
+                break;
+
+            case OPvar:
+            case OPrelconst:
+            {
+                Symbol *s = e->EV.sp.Vsym;
+                if (s->Sclass == SCstatic || s->Sclass == SClocstat)
+                    fi->local = true;
+                else if (inline_isLocal(s))
+                {
+                    // Must be in the function's own symbol table, not a frame
+                    // it shares with another
+                    if (s->Sclass == SCstack || s->Sclass == SCbprel || s->Sclass == SCpseudo)
+                        return false;
+                    unsigned i;
+                    for (i = 0; i < fi->nlocals; i++)
+                        if (fi->locals[i] == s)
+                            break;
+                    if (i == fi->nlocals)
+                        return false;
+                }
+                return true;
+            }
+        }
+        if (!EOP(e))
+            return true;
+        if (EBIN(e) && !inline_checkElem(fi, e->E2))
+            return false;
+        e = e->E1;
+    }
+}
+
+/*********************************
+ * Decide if function sfunc, now in startblock, can be inlined.
+ * Returns:
+ *      InlineFunc describing it, or nullptr if it can't be inlined
+ */
+
+static InlineFunc *inline_candidate(Symbol *sfunc)
+{
+    func_t *f = sfunc->Sfunc;
+    type *t = sfunc->Stype;
+
+    if (tybasic(t->Tty) == TYifunc || f->Fflags3 & (Fnested | Ffakeeh | Fjmonitor))
+        return nullptr;
+    if (t->Tnext && (tybasic(t->Tnext->Tty) == TYstruct || tybasic(t->Tnext->Tty) == TYarray))
+        return nullptr;
+
+    InlineFunc *fi = (InlineFunc *) calloc(1, sizeof(InlineFunc));
+    assert(fi);
+    fi->sfunc = sfunc;
+    fi->tyret = TYvoid;
+
+    /* The symbol table has the parameters in the order they're passed,
+     * and the temporaries of any inlining done in the function.
+     * Put the parameters first.
+     */
+    fi->locals = (Symbol **) malloc((globsym.top + 1) * sizeof(Symbol *));
+    assert(fi->locals);
+    for (SYMIDX si = 0; si < globsym.top; si++)
+    {
+        Symbol *s = globsym.tab[si];
+        switch (s->Sclass)
+        {
+            case SCparameter:
+            case SCfastpar:
+            case SCshadowreg:
+            case SCregpar:
+                if (tybasic(s->Stype->Tty) == TYarray)
+                    goto Lno;
+                fi->locals[fi->nparams++] = s;
+                break;
+        }
+    }
+    fi->nlocals = fi->nparams;
+    for (SYMIDX si = 0; si < globsym.top; si++)
+    {
+        Symbol *s = globsym.tab[si];
+        switch (s->Sclass)
+        {
+            case SCparameter:
+            case SCfastpar:
+            case SCshadowreg:
+            case SCregpar:
+                break;
+            default:
+                fi->locals[fi->nlocals++] = s;
+                break;
+        }
+    }
+
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        if (++fi->nblocks > INLINE_MAXBLOCKS || b->Btry)
+            goto Lno;
+        switch (b->BC)
+        {
+            case BCretexp:
+            {
+                tym_t ty = tybasic(b->Belem->Ety);
+                if (ty == TYvoid || ty == TYstruct || ty == TYarray ||
+                    (fi->tyret != TYvoid && fi->tyret != ty))
+                    goto Lno;
+                fi->tyret = ty;
+                break;
+            }
+            case BCgoto:
+            case BCiftrue:
+            case BCswitch:
+            case BCret:
+            case BCexit:
+                break;
+
+            default:
+                goto Lno;
+        }
+        if (b->Belem && !inline_checkElem(fi, b->Belem))
+            goto Lno;
+        if (fi->size > INLINE_MAXSIZE)
+            goto Lno;
+    }
+    fi->expr = fi->nblocks == 1 && (startblock->BC == BCret || startblock->BC == BCretexp);
+    return fi;
+
+Lno:
+    free(fi->locals);
+    free(fi);
+    return nullptr;
+}
+
+/*********************************
+ * Make a copy of the block list starting at bstart.
+ * The blocks are numbered in Bdfoidx.
+ * Returns:
+ *      the first block of the copy
+ */
+
+static block *inline_copyBlocks(block *bstart)
+{
+    unsigned n = 0;
+    for (block *b = bstart; b; b = b->Bnext)
+        b->Bdfoidx = n++;
+
+    block **copies = (block **) malloc(n * sizeof(block *));
+    assert(copies);
+    block *bcopy = nullptr;
+    for (block *b = bstart; b; b = b->Bnext)
+    {
+        block *bn = block_calloc();
+        copies[b->Bdfoidx] = bn;
+        bn->BC = b->BC;
+        bn->Belem = el_copytree(b->Belem);
+        bn->Bsrcpos = b->Bsrcpos;
+        bn->Bdfoidx = b->Bdfoidx;
+        if (b->BC == BCswitch)
+        {
+            size_t sz = (b->BS.Bswitch[0] + 1) * sizeof(targ_llong);
+            bn->BS.Bswitch = (targ_llong *) ::malloc(sz);
+            memcpy(bn->BS.Bswitch, b->BS.Bswitch, sz);
+        }
+        if (b->Bdfoidx)
+            copies[b->Bdfoidx - 1]->Bnext = bn;
+        else
+            bcopy = bn;
+    }
+    for (block *b = bstart; b; b = b->Bnext)
+    {
+        for (list_t bl = b->Bsucc; bl; bl = list_next(bl))
+            copies[b->Bdfoidx]->appendSucc(copies[list_block(bl)->Bdfoidx]);
+    }
+    free(copies);
+    return bcopy;
+}
+
+/*********************************
+ * If the kept copy of fi runs as a straight line of blocks, each going
+ * to the next, make it one block, so it can be expanded in an expression.
+ * Blocks off the line can't be reached.
+ */
+
+static void inline_straighten(InlineFunc *fi)
+{
+    block *bstart = fi->sfunc->Sfunc->Fstartblock;
+    block *blast = bstart;
+    for (unsigned n = 0; blast->BC == BCgoto; n++)
+    {
+        if (n == fi->nblocks)
+            return;                     // an infinite loop
+        blast = blast->nthSucc(0);
+    }
+    if (blast->BC != BCret && blast->BC != BCretexp)
+        return;
+
+    elem *e = nullptr;
+    for (block *b = bstart; ; b = b->nthSucc(0))
+    {
+        e = el_combine(e, b->Belem);
+        b->Belem = nullptr;
+        if (b == blast)
+            break;
+    }
+    bstart->BC = blast->BC;
+    for (block *b = bstart->Bnext; b; )
+    {
+        block *bn = b->Bnext;
+        block_free(b);
+        b = bn;
+    }
+    list_free(&bstart->Bsucc, FPNULL);
+    bstart->Bnext = nullptr;
+    bstart->Belem = e;
+    fi->nblocks = 1;
+    fi->expr = true;
+}
+
+/*********************************
+ * If function sfunc, now in startblock, is small enough and has nothing
+ * that can't be inlined, save a copy of it for inline_do() to expand into
+ * the functions after it. Otherwise turn off Finline.
+ */
+
+void inline_keep(Symbol *sfunc)
+{
+    func_t *f = sfunc->Sfunc;
+    InlineFunc *fi = inline_candidate(sfunc);
+    if (!fi)
+    {
+        f->Fflags &= ~Finline;
+        return;
+    }
+    f->Fstartblock = inline_copyBlocks(startblock);
+    inline_straighten(fi);
+
+    if (!inline_table)
+        inline_table = new AArray(&ti_pvoid, sizeof(InlineFunc *));
+    *(InlineFunc **)inline_table->get(&sfunc) = fi;
+    fi->next = inline_list;
+    inline_list = fi;
+}
+
+/*********************************
+ * At the end of an object file, forget the functions that refer to
+ * symbols private to it, as they can't be expanded in the next one.
+ */
+
+void inline_term()
+{
+    for (InlineFunc **pfi = &inline_list; *pfi; )
+    {
+        InlineFunc *fi = *pfi;
+        if (fi->local)
+        {
+            fi->sfunc->Sfunc->Fflags &= ~Finline;
+            inline_table->del(&fi->sfunc);
+            *pfi = fi->next;
+        }
+        else
+            pfi = &fi->next;
+    }
+}
+
+/*********************************
+ * Return the InlineFunc of the function e calls, nullptr if it isn't
+ * a direct call to one.
+ */
+
+static InlineFunc *inline_callee(elem *e)
+{
+    switch (e->Eoper)
+    {
+        case OPcall:
+        case OPucall:
+        case OPcallns:
+        case OPucallns:
+            break;
+
+        default:
+            return nullptr;
+    }
+    if (e->E1->Eoper != OPvar || e->E1->EV.sp.Voffset || e->Eflags & EFLAGS_variadic)
+        return nullptr;
+    Symbol *s = e->E1->EV.sp.Vsym;
+    if (s == funcsym_p || !s->Sfunc || !(s->Sfunc->Fflags & Finline))
+        return nullptr;
+    InlineFunc **pfi = (InlineFunc **)inline_table->in(&s);
+    if (!pfi)
+        return nullptr;
+    InlineFunc *fi = *pfi;
+    if (fi->tyret != TYvoid ? tybasic(e->Ety) != fi->tyret : tybasic(e->Ety) != TYvoid)
+        return nullptr;
+    return fi;
+}
+
+/*********************************
+ * Gather the arguments of a call into args[] left to right.
+ */
+
+static void inline_args(elem *e, elem **args, unsigned *pn, unsigned max)
+{
+    if (e->Eoper == OPparam)
+    {
+        inline_args(e->E1, args, pn, max);
+        inline_args(e->E2, args, pn, max);
+    }
+    else
+    {
+        if (*pn < max)
+            args[*pn] = e;
+        ++*pn;
+    }
+}
+
+/*********************************
+ * Free the OPparam tree of a call, but not the arguments.
+ */
+
+static void inline_freeParams(elem *e)
+{
+    if (e->Eoper == OPparam)
+    {
+        inline_freeParams(e->E1);
+        inline_freeParams(e->E2);
+        e->E1 = nullptr;
+        e->E2 = nullptr;
+        el_free(e);
+    }
+}
+
+/*********************************
+ * Decide if inlining fi at a call with nargs arguments is worth it.
+ * Input:
+ *      depth   loop nesting depth of the call
+ *      cold    the call is on a path that doesn't return
+ */
+
+static bool inline_worth(InlineFunc *fi, unsigned nargs, unsigned depth, bool cold)
+{
+    unsigned callsize = 2 + 2 * nargs;  // the call, and passing the arguments
+    if (fi->size <= callsize)
+        return true;                    // no bigger than the call
+    if (cold)
+        return false;
+    unsigned limit = INLINE_SIZE << (depth < 2 ? depth : 2);
+    return fi->size <= limit && inline_growth + fi->size <= INLINE_GROWTH;
+}
+
+/*********************************
+ * Replace references to the callee's locals with references to
+ * the caller's copies of them, creating the copies as needed.
+ */
+
+static void inline_remap(elem *e, InlineFunc *fi, Symbol **map)
+{
+    while (1)
+    {
+        if (EOP(e))
+        {
+            if (EBIN(e))
+                inline_remap(e->E2, fi, map);
+            e = e->E1;
+            continue;
+        }
+        if (e->Eoper == OPvar || e->Eoper == OPrelconst)
+        {
+            Symbol *s = e->EV.sp.Vsym;
+            for (unsigned i = 0; i < fi->nlocals; i++)
+            {
+                if (fi->locals[i] == s)
+                {
+                    if (!map[i])
+                    {
+                        map[i] = symbol_genauto(s->Stype);
+                        map[i]->Salignment = s->Salignment;
+                    }
+                    e->EV.sp.Vsym = map[i];
+                    break;
+                }
+            }
+        }
+        return;
+    }
+}
+
+/*********************************
+ * Take apart call e to fi, assigning its arguments to new locals
+ * that stand in for the parameters, filling in map[].
+ * Returns:
+ *      the assignments, in the order the arguments are evaluated
+ */
+
+static elem *inline_params(elem *e, InlineFunc *fi, Symbol **map)
+{
+    elem *args[INLINE_MAXSIZE];
+    unsigned nargs = 0;
+    if (EBIN(e))
+    {
+        inline_args(e->E2, args, &nargs, INLINE_MAXSIZE);
+        inline_freeParams(e->E2);
+        e->E2 = nullptr;
+    }
+    el_free(e);
+
+    /* The arguments are left to right in reverse order of the parameters.
+     * Evaluate 'this' first, then the rest in the order they are declared.
+     */
+    unsigned n = fi->nparams;
+    bool member = (fi->sfunc->Sfunc->Fflags3 & Fmember) != 0;
+    bool reverse = tyrevfunc(fi->sfunc->Stype->Tty) != 0;
+    elem *eargs = nullptr;
+    for (unsigned j = 0; j < n; j++)
+    {
+        unsigned i;                     // parameter index
+        if (member)
+            i = j == 0 ? 0 : (reverse ? n - j : j);
+        else
+            i = reverse ? n - 1 - j : j;
+        Symbol *sp = fi->locals[i];
+        elem *ea = args[n - 1 - i];
+        if (ea->Eoper == OPstrpar)
+        {
+            elem *ex = ea->E1;
+            ea->E1 = nullptr;
+            el_free(ea);
+            ea = ex;
+        }
+
+        Symbol *stmp = symbol_genauto(sp->Stype);
+        stmp->Salignment = sp->Salignment;
+        map[i] = stmp;
+        elem *eas;
+        if (tybasic(sp->Stype->Tty) == TYstruct)
+        {
+            eas = el_bin(OPstreq, TYstruct, el_var(stmp), ea);
+            eas->ET = sp->Stype;
+        }
+        else
+            eas = el_bin(OPeq, sp->Stype->Tty, el_var(stmp), ea);
+        eargs = el_combine(eargs, eas);
+    }
+    return eargs;
+}
+
+/*********************************
+ * Check that call e to fi passes arguments that match its parameters.
+ */
+
+static bool inline_argsMatch(elem *e, InlineFunc *fi)
+{
+    elem *args[INLINE_MAXSIZE];
+    unsigned nargs = 0;
+    if (EBIN(e))
+        inline_args(e->E2, args, &nargs, INLINE_MAXSIZE);
+    if (nargs != fi->nparams)
+        return false;
+    for (unsigned i = 0; i < nargs; i++)
+    {
+        Symbol *sp = fi->locals[nargs - 1 - i];
+        tym_t tyarg = tybasic(args[i]->Eoper == OPstrpar ? args[i]->E1->Ety : args[i]->Ety);
+        tym_t typar = tybasic(sp->Stype->Tty);
+        if (typar == TYstruct
+                ? tyarg != TYstruct || type_size(sp->Stype) != type_size(args[i]->ET)
+                : tyarg == TYstruct || tyarg == TYarray || tysize(tyarg) != tysize(typar))
+            return false;
+    }
+    return true;
+}
+
+/*********************************
+ * Expand the calls in *pe to functions that are an expression.
+ */
+
+static void inline_expr(elem **pe, unsigned depth, bool cold)
+{
+    elem *e = *pe;
+    if (!EOP(e))
+        return;
+    inline_expr(&e->E1, depth, cold);
+    if (EBIN(e))
+        inline_expr(&e->E2, depth, cold);
+
+    InlineFunc *fi = inline_callee(e);
+    if (!fi || !fi->expr || !inline_worth(fi, fi->nparams, depth, cold) ||
+        !inline_argsMatch(e, fi))
+        return;
+
+    //printf("inline %s into %s\n", fi->sfunc->Sident, funcsym_p->Sident);
+    Symbol **map = (Symbol **) calloc(fi->nlocals + 1, sizeof(Symbol *));
+    assert(map);
+    elem *eargs = inline_params(e, fi, map);
+    elem *ebody = el_copytree(fi->sfunc->Sfunc->Fstartblock->Belem);
+    if (ebody)
+        inline_remap(ebody, fi, map);
+    free(map);
+    e = el_combine(eargs, ebody);
+    *pe = e ? e : el_long(TYint, 0);
+    inline_growth += fi->size;
+}
+
+/*********************************
+ * Count the statements of e, the operands of its top level commas.
+ */
+
+static unsigned inline_countStmts(elem *e)
+{
+    return e->Eoper == OPcomma ? inline_countStmts(e->E1) + inline_countStmts(e->E2) : 1;
+}
+
+/*********************************
+ * Gather the statements of e into stmts[] in the order they run.
+ */
+
+static void inline_flatten(elem *e, elem **stmts, unsigned *pn)
+{
+    while (e->Eoper == OPcomma)
+    {
+        inline_flatten(e->E1, stmts, pn);
+        e = e->E2;
+    }
+    stmts[(*pn)++] = e;
+}
+
+/*********************************
+ * Free the top level commas of e, but not the statements.
+ */
+
+static void inline_freeCommas(elem *e)
+{
+    while (e->Eoper == OPcomma)
+    {
+        elem *e2 = e->E2;
+        inline_freeCommas(e->E1);
+        e->E1 = nullptr;
+        e->E2 = nullptr;
+        el_free(e);
+        e = e2;
+    }
+}
+
+/*********************************
+ * Return true if e takes the address of s, or of any parameter if s is
+ * one, as the parameters may be reached from one another's address.
+ */
+
+static bool inline_addrOf(elem *e, Symbol *s)
+{
+    while (1)
+    {
+        if (EBIN(e))
+        {
+            if (inline_addrOf(e->E1, s))
+                return true;
+            e = e->E2;
+        }
+        else if (EUNA(e))
+            e = e->E1;
+        else
+        {
+            if (e->Eoper != OPrelconst)
+                return false;
+            Symbol *sa = e->EV.sp.Vsym;
+            if (sa == s)
+                return true;
+            return (s->Sclass == SCparameter || s->Sclass == SCshadowreg) &&
+                   (sa->Sclass == SCparameter || sa->Sclass == SCshadowreg);
+        }
+    }
+}
+
+/*********************************
+ * Return true if e has the same value wherever it is evaluated in the
+ * function: it is a constant, or a local variable whose address is
+ * never taken, so no call can change it.
+ */
+
+static bool inline_stable(elem *e)
+{
+    switch (e->Eoper)
+    {
+        case OPconst:
+        case OPrelconst:
+        case OPstring:
+            return true;
+
+        case OPvar:
+        {
+            Symbol *s = e->EV.sp.Vsym;
+            if (!inline_isLocal(s) || s->ty() & mTYvolatile)
+                return false;
+            for (block *b = startblock; b; b = b->Bnext)
+            {
+                if (b->BC == BCasm || (b->Belem && inline_addrOf(b->Belem, s)))
+                    return false;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/*********************************
+ * The call in e->E2 is to be expanded ahead of the statement e.
+ * Return true if e->E1, which is evaluated first, can be made to
+ * have the same value after the call: it is stable, or it can be
+ * copied to a temporary before the call. The left operand of an
+ * assignment is evaluated after the right one anyway.
+ */
+
+static bool inline_canHoist(elem *e)
+{
+    if (OTassign(e->Eoper) || inline_stable(e->E1))
+        return true;
+    tym_t ty = tybasic(e->E1->Ety);
+    return ty != TYstruct && ty != TYarray;
+}
+
+/*********************************
+ * Look for a statement of block b that calls a function with more
+ * blocks than one that returns, and expand it, splitting b in two around it.
+ * Returns:
+ *      the block following the expansion, nullptr if none
+ */
+
+static block *inline_split(block *b, unsigned depth, bool cold)
+{
+    switch (b->BC)
+    {
+        case BCgoto:
+        case BCiftrue:
+        case BCswitch:
+        case BCret:
+        case BCretexp:
+        case BCexit:
+            break;
+
+        default:
+            return nullptr;
+    }
+    if (!b->Belem)
+        return nullptr;
+
+    // The top level comma expressions are the statements
+    unsigned n = inline_countStmts(b->Belem);
+    elem **stmts = (elem **) malloc(n * sizeof(elem *));
+    assert(stmts);
+    n = 0;
+    inline_flatten(b->Belem, stmts, &n);
+
+    bool hasValue = b->BC == BCiftrue || b->BC == BCswitch || b->BC == BCretexp;
+    InlineFunc *fi = nullptr;
+    elem **pcall = nullptr;             // where the call is
+    unsigned i;
+    for (i = 0; i < n; i++)
+    {
+        elem *e = stmts[i];
+        pcall = &stmts[i];
+        if (!inline_callee(e))
+        {
+            /* Look for the call as the operand of a statement that can
+             * as well use its value after it's computed
+             */
+            if (EUNA(e))
+                pcall = &e->E1;
+            else if (EBIN(e) && e->Eoper != OPandand && e->Eoper != OPoror && e->Eoper != OPcomma)
+            {
+                if (!el_sideeffect(e->E1) && inline_callee(e->E2) && inline_canHoist(e))
+                    pcall = &e->E2;
+                else if (!OTassign(e->Eoper) && !el_sideeffect(e->E2))
+                    pcall = &e->E1;
+            }
+        }
+        fi = inline_callee(*pcall);
+        if (fi && !fi->expr &&
+            !(hasValue && i == n - 1 && fi->tyret == TYvoid) &&
+            inline_worth(fi, fi->nparams, depth, cold) &&
+            inline_argsMatch(*pcall, fi))
+            break;
+    }
+    if (i == n)
+    {
+        free(stmts);
+        return nullptr;
+    }
+    //printf("inline %s into %s\n", fi->sfunc->Sident, funcsym_p->Sident);
+
+    /* The call is expanded ahead of its statement, so if it is the
+     * right operand the callee may change what the left one reads.
+     * Unless that is stable, evaluate it into a temporary first.
+     */
+    elem *efirst = nullptr;
+    elem *es = stmts[i];
+    if (pcall == &es->E2 && !OTassign(es->Eoper) && !inline_stable(es->E1))
+    {
+        Symbol *s1 = symbol_genauto(es->E1);
+        efirst = el_bin(OPeq, es->E1->Ety, el_var(s1), es->E1);
+        es->E1 = el_var(s1);
+    }
+
+    // Take apart the top level commas, as the statements go in new blocks
+    inline_freeCommas(b->Belem);
+    b->Belem = nullptr;
+
+    /* Put the value returned in a temporary, unless
+     * the call is a statement of its own
+     */
+    elem *ecall = *pcall;
+    Symbol *stmp = nullptr;
+    if (pcall != &stmts[i] || (hasValue && i == n - 1))
+    {
+        stmp = symbol_genauto(fi->tyret);
+        *pcall = el_var(stmp);
+    }
+    else
+        stmts[i] = nullptr;
+
+    elem *eprefix = nullptr;
+    for (unsigned j = 0; j < i; j++)
+        eprefix = el_combine(eprefix, stmts[j]);
+    eprefix = el_combine(eprefix, efirst);
+    elem *erest = nullptr;
+    for (unsigned j = i; j < n; j++)
+        erest = el_combine(erest, stmts[j]);
+
+    // The block the expansion returns to takes over b's successors
+    block *bcont = block_calloc();
+    bcont->BC = b->BC;
+    bcont->Bsucc = b->Bsucc;
+    b->Bsucc = nullptr;
+    if (b->BC == BCswitch)
+    {
+        bcont->BS.Bswitch = b->BS.Bswitch;
+        b->BS.Bswitch = nullptr;
+    }
+    bcont->Belem = erest;
+    bcont->Btry = b->Btry;
+    bcont->Bsrcpos = b->Bsrcpos;
+    bcont->Bnext = b->Bnext;
+
+    Symbol **map = (Symbol **) calloc(fi->nlocals + 1, sizeof(Symbol *));
+    assert(map);
+    b->Belem = el_combine(eprefix, inline_params(ecall, fi, map));
+    b->BC = BCgoto;
+
+    block *bstart = inline_copyBlocks(fi->sfunc->Sfunc->Fstartblock);
+    b->appendSucc(bstart);
+    b->Bnext = bstart;
+    block *blast = nullptr;
+    for (block *bn = bstart; bn; bn = bn->Bnext)
+    {
+        blast = bn;
+        bn->Btry = b->Btry;
+        if (bn->Belem)
+            inline_remap(bn->Belem, fi, map);
+        switch (bn->BC)
+        {
+            case BCretexp:
+                if (stmp)
+                    bn->Belem = el_bin(OPeq, fi->tyret, el_var(stmp), bn->Belem);
+                /* FALL-THROUGH */
+            case BCret:
+                bn->BC = BCgoto;
+                bn->appendSucc(bcont);
+                break;
+        }
+    }
+    blast->Bnext = bcont;
+    free(map);
+    free(stmts);
+    inline_growth += fi->size;
+    return bcont;
+}
+
+/*********************************
+ * Expand calls in the function sfunc, now in startblock, to the
+ * functions kept by inline_keep().
+ */
+
+void inline_do(Symbol *sfunc)
+{
+    if (!inline_table || !inline_table->length())
+        return;
+    inline_growth = 0;
+
+    /* Without a flow graph yet, estimate how often the blocks run by
+     * how deep in loops they are, going by the back edges.
+     */
+    unsigned n = 0;
+    for (block *b = startblock; b; b = b->Bnext)
+        b->Bdfoidx = n++;
+    unsigned *depth = (unsigned *) calloc(n + 1, sizeof(unsigned));
+    assert(depth);
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        for (list_t bl = b->Bsucc; bl; bl = list_next(bl))
+        {
+            block *bs = list_block(bl);
+            if (bs->Bdfoidx <= b->Bdfoidx)
+            {
+                for (unsigned i = bs->Bdfoidx; i <= b->Bdfoidx; i++)
+                    depth[i]++;
+            }
+        }
+    }
+
+    for (block *b = startblock; b; )
+    {
+        block *bnext = b->Bnext;        // skip over what gets inlined into b
+        unsigned d = depth[b->Bdfoidx];
+        bool cold = b->BC == BCexit;
+        if (b->Belem)
+            inline_expr(&b->Belem, d, cold);
+        while (b)
+            b = inline_split(b, d, cold);
+        b = bnext;
+    }
+    free(depth);
+}
+
+#endif
@@ -756,6 +756,7 @@ void dotytab()
     static tym_t _ptr_nflat[]= { TYsptr,TYcptr,TYf16ptr,TYfptr,TYhptr,TYvptr };
     static tym_t _real[]     = { TYfloat,TYdouble,TYdouble_alias,TYldouble,
                                  TYfloat4,TYdouble2,
+                                 TYfloat8,TYdouble4,
                                };
     static tym_t _imaginary[] = {
                                  TYifloat,TYidouble,TYildouble,
@@ -768,6 +769,8 @@ void dotytab()
                                  TYlong,TYulong,TYllong,TYullong,TYdchar,
                                  TYschar16,TYuchar16,TYshort8,TYushort8,
                                  TYlong4,TYulong4,TYllong2,TYullong2,
+                                 TYschar32,TYuchar32,TYshort16,TYushort16,
+                                 TYlong8,TYulong8,TYllong4,TYullong4,
                                  TYchar16, TYcent, TYucent };
     static tym_t _ref[]      = { TYnref,TYref };
     static tym_t _func[]     = { TYnfunc,TYnpfunc,TYnsfunc,TYifunc,TYmfunc,TYjfunc,TYhfunc };
@@ -776,6 +779,7 @@ void dotytab()
     static tym_t _uns[]     = { TYuchar,TYushort,TYuint,TYulong,
                                 TYwchar_t,
                                 TYuchar16,TYushort8,TYulong4,TYullong2,
+                                TYuchar32,TYushort16,TYulong8,TYullong4,
                                 TYdchar,TYullong,TYucent,TYchar16 };
     static tym_t _mptr[]    = { TYmemptr };
     static tym_t _nullptr[] = { TYnullptr };
@@ -793,11 +797,17 @@ void dotytab()
                                  TYfloat4,TYdouble2,
                                  TYschar16,TYuchar16,TYshort8,TYushort8,
                                  TYlong4,TYulong4,TYllong2,TYullong2,
+                                 TYfloat8,TYdouble4,
+                                 TYschar32,TYuchar32,TYshort16,TYushort16,
+                                 TYlong8,TYulong8,TYllong4,TYullong4,
                              };
     static tym_t _simd[] = {
                                  TYfloat4,TYdouble2,
                                  TYschar16,TYuchar16,TYshort8,TYushort8,
                                  TYlong4,TYulong4,TYllong2,TYullong2,
+                                 TYfloat8,TYdouble4,
+                                 TYschar32,TYuchar32,TYshort16,TYushort16,
+                                 TYlong8,TYulong8,TYllong4,TYullong4,
                              };
 
     static struct
@@ -857,6 +867,17 @@ void dotytab()
 "long long[2]",          TYllong2,    TYullong2, TYllong2,    16,     0,      0,
 "unsigned long long[2]", TYullong2,   TYullong2, TYullong2,   16,     0,      0,
 
+"float[8]",              TYfloat8,    TYfloat8,  TYfloat8,    32,     0,      0,
+"double[4]",             TYdouble4,   TYdouble4, TYdouble4,   32,     0,      0,
+"signed char[32]",       TYschar32,   TYuchar32, TYschar32,   32,     0,      0,
+"unsigned char[32]",     TYuchar32,   TYuchar32, TYuchar32,   32,     0,      0,
+"short[16]",             TYshort16,   TYushort16, TYshort16,  32,     0,      0,
+"unsigned short[16]",    TYushort16,  TYushort16, TYushort16, 32,     0,      0,
+"long[8]",               TYlong8,     TYulong8,  TYlong8,     32,     0,      0,
+"unsigned long[8]",      TYulong8,    TYulong8,  TYulong8,    32,     0,      0,
+"long long[4]",          TYllong4,    TYullong4, TYllong4,    32,     0,      0,
+"unsigned long long[4]", TYullong4,   TYullong4, TYullong4,   32,     0,      0,
+
 "nullptr_t",    TYnullptr,      TYnullptr, TYptr,       2,  0x20,       0x100,
 "*",            TYnptr,         TYnptr,    TYnptr,      2,  0x20,       0x100,
 "&",            TYref,          TYref,     TYref,       -1,     0,      0,
@@ -987,6 +1008,22 @@ void dotytab()
             case TYucent:
                 sz = 8;
                 break;
+
+            /* The stack is only 16 byte aligned, so 256 bit vectors
+             * are accessed with unaligned loads and stores.
+             */
+            case TYfloat8:
+            case TYdouble4:
+            case TYschar32:
+            case TYuchar32:
+            case TYshort16:
+            case TYushort16:
+            case TYlong8:
+            case TYulong8:
+            case TYllong4:
+            case TYullong4:
+                sz = 16;
+                break;
         }
         tysize[typetab[i].ty | 0x00] = sz;
         /*printf("tyalignsize[%d] = %d\n",typetab[i].ty,typetab[i].size);*/
@@ -637,34 +637,20 @@ STATIC void writefunc2(symbol *sfunc)
     globsym.top = nsymbols;
 
     assert(startblock == nullptr);
-    if (f->Fflags & Finline)            // if keep function around
-    {   // Generate copy of function
-        block *bf;
-        block **pb;
-
-        pb = &startblock;
-        for (bf = f->Fstartblock; bf; bf = bf->Bnext)
-        {
-            b = block_calloc();
-            *pb = b;
-            pb = &b->Bnext;
-
-            *b = *bf;
-            assert(b->numSucc() == 0);
-            assert(!b->Bpred);
-            b->Belem = el_copytree(b->Belem);
-        }
-    }
-    else
-    {   startblock = sfunc->Sfunc->Fstartblock;
-        sfunc->Sfunc->Fstartblock = nullptr;
-    }
+    startblock = sfunc->Sfunc->Fstartblock;
+    sfunc->Sfunc->Fstartblock = nullptr;
     assert(startblock);
 
     /* Do any in-line expansion of function calls inside sfunc  */
     assert(funcsym_p == nullptr);
     funcsym_p = sfunc;
     tyf = tybasic(sfunc->ty());
+    if (f->Fflags3 & Fdoinline)
+        inline_do(sfunc);
+    if (f->Fflags & Finline)            // if keep function around
+        inline_keep(sfunc);             // for expanding it in later functions
+    if (config.flags4 & CFG4optimized)
+        cod3_switchclusters();          // split up switches with scattered cases
 
     // TX86 computes parameter offsets in stackoffsets()
     //printf("globsym.top = %d\n", globsym.top);
@@ -749,6 +735,7 @@ STATIC void writefunc2(symbol *sfunc)
         eecontext.EEin--;
         eecontext_convs(marksi);
     }
+    numblks += profile_blocks(sfunc);   // count branches, or read the counts
     maxblks = 3 * numblks;              // allow for increase in # of blocks
     // If we took the address of one parameter, assume we took the
     // address of all non-register parameters.
@@ -776,6 +763,7 @@ STATIC void writefunc2(symbol *sfunc)
     assert(funcsym_p == sfunc);
     if (eecontext.EEcompile != 1)
     {
+        profile_func(sfunc);            // mark as hot or cold
         if (symbol_iscomdat(sfunc))
         {
             csegsave = cseg;
@@ -787,6 +775,16 @@ STATIC void writefunc2(symbol *sfunc)
                 objmod->codeseg(funcsym_p->Sident, 1);
                                         // generate new code segment
             }
+            else if (sfunc->Sfunc->Fflags3 & (Fhot | Fcold))
+            {
+                /* Group the hot functions together, and the cold
+                 * ones away from the rest, to use fewer cache lines and pages
+                 */
+                sfunc->Sseg = objmod->codeseg((char *)((sfunc->Sfunc->Fflags3 & Fhot)
+                                ? ".text.hot" : ".text.unlikely"), 0);
+            }
+            else
+                objmod->codeseg(nullptr, 0);    // back to the default code segment
         cod3_align();                   // align start of function
         objmod->func_start(sfunc);
         searchfixlist(sfunc);           // backpatch any refs to this function
@@ -82,6 +82,8 @@ code* save87() { assert(0); return nullptr; }
 code* tstresult(regm_t regm, tym_t tym, unsigned saveflag) { assert(0); return nullptr; }
 int cod3_EA(code* c) { assert(0); return 0; }
 regm_t cod3_useBP() { assert(0); return 0; }
+bool cod3_anytailcalls() { assert(0); return false; }
+void cod3_switchclusters() { assert(0); }
 regm_t regmask(tym_t tym, tym_t tyf) { assert(0); return 0; }
 targ_size_t cod3_bpoffset(symbol* s) { assert(0); return 0; }
 unsigned char loadconst(elem* e, int im) { assert(0); return 0; }
@@ -0,0 +1,844 @@
+// Copyright (C) 2021 by The D Language Foundation, All Rights Reserved
+// http://www.digitalmars.com
+// Written by Walter Bright
+/*
+ * This source file is made available for personal use
+ * only. The license is in backendlicense.txt
+ * For any other uses, please contact Digital Mars.
+ */
+
+// Read a profile of a previous run of the program, and use it to
+// mark functions as hot or cold, and to weight the blocks of functions.
+// Also count the branches taken by a run of the program, for such a profile.
+
+#if !SPP
+
+#include        <stdio.h>
+#include        <string.h>
+#include        <stdlib.h>
+
+#include        "cc.hpp"
+#include        "global.hpp"
+#include        "oper.hpp"
+#include        "el.hpp"
+#include        "type.hpp"
+#include        "dt.hpp"
+#include        "obj.hpp"
+#include        "aa.hpp"
+#include        "tinfo.hpp"
+
+static char __file__[] = __FILE__;      /* for tassert.h                */
+#include        "tassert.hpp"
+
+struct Profile
+{
+    targ_ullong calls;          // number of times the function was called
+    targ_ullong functime;       // time spent in the function itself
+};
+
+static AArray *profile_table;           // Profile's indexed by mangled name
+static targ_ullong profile_hotlimit;    // functions taking this much time or more are hot
+
+/* The branch counts written by a program compiled with -profile=edges.
+ * The file is a sequence of records, one for each function of each
+ * module, each a multiple of 8 bytes long:
+ *      unsigned magic          PROFILE_MAGIC
+ *      unsigned namelen        length of the mangled name
+ *      unsigned checksum       of the flow graph of the function
+ *      unsigned ncounters
+ *      targ_ullong counts[ncounters]
+ *      char name[namelen]      padded with 0's
+ * counts[0] is the number of calls, the rest are counts of the edges
+ * of the flow graph that are not on its spanning tree.
+ */
+
+#define PROFILE_MAGIC   0x4F475044      // "DPGO"
+#define PROFILE_HEADER  16              // size of the fixed part of a record
+
+struct EdgeProfile
+{
+    unsigned checksum;          // of the flow graph the counts are for
+    unsigned ncounters;
+    targ_ullong *counts;        // nullptr if the runs disagree on the flow graph
+};
+
+static AArray *profile_edges;           // EdgeProfile's indexed by mangled name
+static bool profile_byedges;            // profile_table was made from branch counts
+
+static Symbol *profile_sym;             // the counters of this object file
+static DtBuilder *profile_dtb;          // the data of profile_sym
+static unsigned profile_size;           // size of profile_dtb
+static bool profile_terminating;        // generating the code that writes them
+static targ_ullong profile_calls;       // calls of the current function, if
+                                        //  its blocks have counts
+
+/************************************
+ * Predicate for sorting times for qsort(), largest first.
+ */
+
+static int profile_cmp(const void *p1, const void *p2)
+{
+    targ_ullong t1 = *(const targ_ullong *)p1;
+    targ_ullong t2 = *(const targ_ullong *)p2;
+    return t1 < t2 ? 1 : t1 > t2 ? -1 : 0;
+}
+
+/**************************************
+ * Read the trace.log written by a program compiled with -profile.
+ * Only the call graph part is needed, its lines for each function are:
+ *      name <tab> calls <tab> tree time <tab> func time
+ * with the callers and callees before and after indented by a tab.
+ */
+
+static bool profile_readlog(FILE *fp)
+{
+    char line[4096];
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '=')             // start of the timer table
+            break;
+        if (line[0] == '\t' || line[0] == '-' || line[0] == '\n')
+            continue;
+
+        char *p = strchr(line, '\t');
+        if (!p)
+            continue;
+        *p++ = 0;
+        char *q;
+        targ_ullong calls = strtoull(p, &q, 10);
+        if (q == p || *q != '\t')
+            continue;
+        strtoull(q + 1, &p, 10);        // tree time, not needed
+        if (p == q + 1 || *p != '\t')
+            continue;
+        targ_ullong functime = strtoull(p + 1, &q, 10);
+        if (q == p + 1)
+            continue;
+
+        // A function may appear in the profile of several runs merged together
+        Profile *pr = (Profile *)profile_table->in(line);
+        if (!pr)
+            pr = (Profile *)profile_table->get(strdup(line));
+        pr->calls += calls;
+        pr->functime += functime;
+    }
+    return !ferror(fp);
+}
+
+/**************************************
+ * Read the branch counts written by a program compiled with -profile=edges.
+ * The time taken by a function is estimated by the number of branches
+ * it took.
+ */
+
+static bool profile_readcounts(FILE *fp)
+{
+    if (!profile_edges)
+        profile_edges = new AArray(&ti_achar, sizeof(EdgeProfile));
+
+    unsigned header[PROFILE_HEADER / 4];
+    while (fread(header, sizeof(header), 1, fp) == 1)
+    {
+        if (header[0] != PROFILE_MAGIC || header[3] == 0)
+            return false;
+        unsigned namelen = header[1];
+        unsigned n = header[3];
+        size_t size = n * sizeof(targ_ullong) + ((namelen + 7) & ~7);
+        targ_ullong *counts = (targ_ullong *)malloc(size + 1);
+        assert(counts);
+        if (fread(counts, size, 1, fp) != 1)
+        {
+            free(counts);
+            return false;
+        }
+        char *name = (char *)(counts + n);
+        name[namelen] = 0;
+
+        Profile *pr = (Profile *)profile_table->in(name);
+        if (!pr)
+            pr = (Profile *)profile_table->get(strdup(name));
+        pr->calls += counts[0];
+        for (unsigned i = 0; i < n; i++)
+            pr->functime += counts[i];
+
+        // The runs of several programs may be in the file
+        EdgeProfile *ep = (EdgeProfile *)profile_edges->in(name);
+        if (!ep)
+        {
+            ep = (EdgeProfile *)profile_edges->get(strdup(name));
+            ep->checksum = header[2];
+            ep->ncounters = n;
+            ep->counts = counts;
+            continue;
+        }
+        if (ep->counts && ep->checksum == header[2] && ep->ncounters == n)
+        {
+            for (unsigned i = 0; i < n; i++)
+                ep->counts[i] += counts[i];
+        }
+        else if (ep->counts)
+        {
+            free(ep->counts);           // the function changed between runs
+            ep->counts = nullptr;
+        }
+        free(counts);
+    }
+    return !ferror(fp);
+}
+
+/**************************************
+ * Read the trace.log written by a program compiled with -profile,
+ * or the trace.cnt written by one compiled with -profile=edges.
+ * Returns:
+ *      false if the file could not be read
+ */
+
+bool profile_read(const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+        return false;
+
+    if (!profile_table)
+        profile_table = new AArray(&ti_achar, sizeof(Profile));
+
+    unsigned magic;
+    profile_byedges = fread(&magic, sizeof(magic), 1, fp) == 1 && magic == PROFILE_MAGIC;
+    rewind(fp);
+    bool ok = profile_byedges ? profile_readcounts(fp) : profile_readlog(fp);
+    fclose(fp);
+    if (!ok)
+        return false;
+
+    /* The hot functions are the fewest that together take 90% of the time.
+     * Find the smallest time of those.
+     */
+    size_t n = profile_table->length();
+    if (!n)
+        return true;
+    Profile *values = (Profile *)profile_table->values();
+    targ_ullong *times = (targ_ullong *)malloc(n * sizeof(targ_ullong));
+    assert(times);
+    targ_ullong total = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        times[i] = values[i].functime;
+        total += times[i];
+    }
+    delete [] (char *)values;
+    qsort(times, n, sizeof(targ_ullong), &profile_cmp);
+    profile_hotlimit = ~(targ_ullong)0;
+    targ_ullong sum = 0;
+    for (size_t i = 0; i < n && times[i] && sum < total - total / 10; i++)
+    {
+        sum += times[i];
+        profile_hotlimit = times[i];
+    }
+    free(times);
+    return true;
+}
+
+/**************************************
+ * Mark sfunc as hot or cold according to the profile, if there is one.
+ * A function that was never called in the profiled run is cold.
+ * Branch counts are only made for the modules compiled with -profile=edges,
+ * so a function missing from those is left alone.
+ */
+
+void profile_func(Symbol *sfunc)
+{
+    if (!profile_table || !profile_table->length())
+        return;
+    func_t *f = sfunc->Sfunc;
+    f->Fflags3 &= ~(Fhot | Fcold);
+    Profile *pr = (Profile *)profile_table->in(sfunc->Sident);
+    if (!pr)
+    {
+        if (!profile_byedges)
+            f->Fflags3 |= Fcold;
+    }
+    else if (pr->calls == 0)
+        f->Fflags3 |= Fcold;
+    else if (pr->functime >= profile_hotlimit)
+        f->Fflags3 |= Fhot;
+}
+
+/* The flow graph of a function, numbering its blocks in Bnext order.
+ * The exit of the function is the node after the last block, and
+ * edges[0] is a made up edge from it back to the start, counting
+ * the calls.
+ */
+
+struct Edge
+{
+    unsigned from;              // index of the block the edge leaves
+    unsigned to;                // index of the block it goes to
+    list_t bl;                  // the edge in the Bsucc of from, nullptr if it
+                                //  goes to the exit
+    unsigned weight;            // guess at how often it is taken
+    int counter;                // index of its counter, -1 if it is on the
+                                //  spanning tree
+};
+
+struct FlowGraph
+{
+    block **blocks;
+    unsigned nblocks;           // the exit is node nblocks
+    Edge *edges;
+    unsigned nedges;
+    unsigned ncounters;
+    unsigned checksum;
+};
+
+/************************************
+ * Determine if branches of the current function can be counted.
+ */
+
+static bool profile_canedge()
+{
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        if (b->Btry)
+            return false;
+        switch (b->BC)
+        {
+            case BCgoto:
+            case BCiftrue:
+            case BCret:
+            case BCretexp:
+            case BCexit:
+            case BCswitch:
+                break;
+
+            default:
+                return false;           // EH and asm
+        }
+    }
+    return true;
+}
+
+/************************************
+ * Predicate for sorting edges for qsort(), most often taken first,
+ * keeping the order of the flow graph otherwise.
+ */
+
+static int profile_edgecmp(const void *p1, const void *p2)
+{
+    const Edge *e1 = *(const Edge **)p1;
+    const Edge *e2 = *(const Edge **)p2;
+    if (e1->weight != e2->weight)
+        return e1->weight < e2->weight ? 1 : -1;
+    return e1 < e2 ? -1 : e1 > e2;
+}
+
+static unsigned profile_root(unsigned *parent, unsigned i)
+{
+    while (parent[i] != i)
+        i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+/************************************
+ * Build the flow graph of the current function, and pick the edges
+ * to count: those that are not on a maximum spanning tree, where the
+ * weight of an edge guesses how often it is taken. The counts of the
+ * edges on the tree follow from the others.
+ */
+
+static void profile_graph(FlowGraph *g)
+{
+    unsigned nblocks = 0;
+    unsigned nedges = 1;
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        b->Bdfoidx = nblocks++;
+        nedges += b->Bsucc ? list_nitems(b->Bsucc) : 1;
+    }
+    g->nblocks = nblocks;
+    g->blocks = (block **)malloc(nblocks * sizeof(block *));
+    g->nedges = nedges;
+    g->edges = (Edge *)calloc(nedges, sizeof(Edge));
+    assert(g->blocks && g->edges);
+
+    unsigned checksum = nblocks;
+    Edge *e = g->edges;
+    e->from = nblocks;                  // exit to start
+    e->to = 0;
+    e++;
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        g->blocks[b->Bdfoidx] = b;
+        checksum = checksum * 31 + b->BC;
+        if (!b->Bsucc)
+        {
+            e->from = b->Bdfoidx;
+            e->to = nblocks;
+            e->weight = 0;
+            e++;
+            continue;
+        }
+        for (list_t bl = b->Bsucc; bl; bl = list_next(bl))
+        {
+            e->from = b->Bdfoidx;
+            e->to = list_block(bl)->Bdfoidx;
+            e->bl = bl;
+            e->weight = e->to <= e->from ? 2 : 1;   // loops are taken more often
+            checksum = checksum * 31 + e->to;
+            e++;
+        }
+        checksum = checksum * 31 + list_nitems(b->Bsucc);
+    }
+    g->checksum = checksum;
+
+    // Kruskal's algorithm
+    Edge **order = (Edge **)malloc((nedges - 1) * sizeof(Edge *));
+    unsigned *parent = (unsigned *)malloc((nblocks + 1) * sizeof(unsigned));
+    assert(order && parent);
+    for (unsigned i = 1; i < nedges; i++)
+        order[i - 1] = &g->edges[i];
+    qsort(order, nedges - 1, sizeof(Edge *), &profile_edgecmp);
+    for (unsigned i = 0; i <= nblocks; i++)
+        parent[i] = i;
+    for (unsigned i = 0; i < nedges - 1; i++)
+    {
+        Edge *ed = order[i];
+        unsigned r1 = profile_root(parent, ed->from);
+        unsigned r2 = profile_root(parent, ed->to);
+        ed->counter = -1;
+        if (r1 != r2)
+            parent[r1] = r2;
+        else
+            ed->counter = 0;            // not on the tree
+    }
+    free(parent);
+    free(order);
+
+    g->ncounters = 1;
+    for (unsigned i = 1; i < nedges; i++)
+    {
+        if (g->edges[i].counter == 0)
+            g->edges[i].counter = g->ncounters++;
+    }
+}
+
+static void profile_graphfree(FlowGraph *g)
+{
+    free(g->blocks);
+    free(g->edges);
+}
+
+/************************************
+ * Generate:
+ *      ++counts[counter]
+ * for the function whose record starts at offset in profile_sym.
+ */
+
+static elem *profile_inc(unsigned offset, unsigned counter)
+{
+    elem *e = el_bin(OPadd, TYnptr, el_ptr(profile_sym),
+                     el_long(TYsize_t, offset + PROFILE_HEADER + counter * sizeof(targ_ullong)));
+    e = el_una(OPind, TYullong, e);
+    return el_bin(OPaddass, TYullong, e, el_long(TYullong, 1));
+}
+
+/************************************
+ * Insert e at the start of block b.
+ */
+
+static void profile_prepend(block *b, elem *e)
+{
+    b->Belem = el_combine(e, b->Belem);
+}
+
+/************************************
+ * Add a record for sfunc to the counters of the object file.
+ * Returns:
+ *      offset of the record
+ */
+
+static unsigned profile_record(Symbol *sfunc, unsigned checksum, unsigned ncounters)
+{
+    if (!profile_dtb)
+    {
+        profile_sym = symbol_calloc("__dpgo");
+        profile_sym->Stype = type_fake(TYullong);
+        profile_sym->Stype->Tmangle = mTYman_c;
+        profile_sym->Stype->Tcount++;
+        profile_sym->Sclass = SCstatic;
+        profile_sym->Sfl = FLdata;
+        profile_sym->Sflags |= SFLlivexit;
+        profile_dtb = new DtBuilder();
+        profile_size = 0;
+    }
+    unsigned offset = profile_size;
+    size_t namelen = strlen(sfunc->Sident);
+    unsigned pad = (8 - (namelen & 7)) & 7;
+    profile_dtb->dword(PROFILE_MAGIC);
+    profile_dtb->dword(namelen);
+    profile_dtb->dword(checksum);
+    profile_dtb->dword(ncounters);
+    profile_dtb->nzeros(ncounters * sizeof(targ_ullong));
+    profile_dtb->nbytes(namelen, sfunc->Sident);
+    if (pad)
+        profile_dtb->nzeros(pad);
+    profile_size += PROFILE_HEADER + ncounters * sizeof(targ_ullong) + namelen + pad;
+    return offset;
+}
+
+/************************************
+ * Add counters to the edges of the flow graph of the current function
+ * that are not on the spanning tree. A counter goes at the start of
+ * the block the edge leaves if that block has no other way out, else
+ * at the start of the block the edge goes to if there is no other way
+ * in, else into a new block on the edge.
+ * Functions with exception handling or inline assembler only count calls.
+ * Returns:
+ *      number of blocks added
+ */
+
+static unsigned profile_instrument(Symbol *sfunc)
+{
+    if (!profile_canedge())
+    {
+        switch (startblock->BC)
+        {
+            case BCgoto:
+            case BCiftrue:
+            case BCret:
+            case BCretexp:
+            case BCexit:
+            case BCswitch:
+                if (startblock->Btry)
+                    break;
+                profile_prepend(startblock, profile_inc(profile_record(sfunc, 0, 1), 0));
+                break;
+        }
+        return 0;
+    }
+
+    FlowGraph g;
+    profile_graph(&g);
+    unsigned offset = profile_record(sfunc, g.checksum, g.ncounters);
+
+    unsigned *nin = (unsigned *)calloc(g.nblocks + 1, sizeof(unsigned));
+    unsigned *nout = (unsigned *)calloc(g.nblocks + 1, sizeof(unsigned));
+    assert(nin && nout);
+    for (unsigned i = 0; i < g.nedges; i++)
+    {
+        nin[g.edges[i].to]++;
+        nout[g.edges[i].from]++;
+    }
+
+    unsigned added = 0;
+    for (unsigned i = 0; i < g.nedges; i++)
+    {
+        Edge *e = &g.edges[i];
+        if (e->counter < 0)
+            continue;
+        elem *einc = profile_inc(offset, e->counter);
+        if (e->from == g.nblocks)
+            profile_prepend(startblock, einc);
+        else if (nout[e->from] == 1)
+            profile_prepend(g.blocks[e->from], einc);
+        else if (nin[e->to] == 1)
+            profile_prepend(g.blocks[e->to], einc);
+        else
+        {
+            block *bfrom = g.blocks[e->from];
+            block *bn = block_calloc();
+            bn->BC = BCgoto;
+            bn->Belem = einc;
+            bn->Bsrcpos = list_block(e->bl)->Bsrcpos;
+            list_append(&bn->Bsucc, list_block(e->bl));
+            list_ptr(e->bl) = bn;
+            bn->Bnext = bfrom->Bnext;
+            bfrom->Bnext = bn;
+            added++;
+        }
+    }
+    free(nin);
+    free(nout);
+    profile_graphfree(&g);
+    return added;
+}
+
+/************************************
+ * Work out the number of times each block of the current function
+ * was run from the branch counts in ep, and put it in Bcount.
+ * The count of each edge on the spanning tree follows from the counts
+ * of the other edges in or out of one of its ends.
+ */
+
+static void profile_apply(EdgeProfile *ep)
+{
+    if (!profile_canedge())
+        return;
+    FlowGraph g;
+    profile_graph(&g);
+    if (g.checksum != ep->checksum || g.ncounters != ep->ncounters)
+    {
+        profile_graphfree(&g);          // the function changed since the run
+        return;
+    }
+
+    unsigned nnodes = g.nblocks + 1;
+    targ_llong *ecount = (targ_llong *)calloc(g.nedges, sizeof(targ_llong));
+    char *eknown = (char *)calloc(g.nedges, 1);
+    targ_llong *ncount = (targ_llong *)calloc(nnodes, sizeof(targ_llong));
+    char *nknown = (char *)calloc(nnodes, 1);
+    // for each node, the sum of the known edges in and out, the number of
+    // unknown ones, and the last of those
+    targ_llong *insum = (targ_llong *)malloc(nnodes * sizeof(targ_llong));
+    targ_llong *outsum = (targ_llong *)malloc(nnodes * sizeof(targ_llong));
+    unsigned *inunknown = (unsigned *)malloc(nnodes * sizeof(unsigned));
+    unsigned *outunknown = (unsigned *)malloc(nnodes * sizeof(unsigned));
+    unsigned *inlast = (unsigned *)malloc(nnodes * sizeof(unsigned));
+    unsigned *outlast = (unsigned *)malloc(nnodes * sizeof(unsigned));
+    assert(ecount && eknown && ncount && nknown && insum && outsum &&
+           inunknown && outunknown && inlast && outlast);
+
+    for (unsigned i = 0; i < g.nedges; i++)
+    {
+        if (g.edges[i].counter >= 0)
+        {
+            ecount[i] = ep->counts[g.edges[i].counter];
+            eknown[i] = 1;
+        }
+    }
+
+    int changes;
+    do
+    {
+        changes = 0;
+        memset(insum, 0, nnodes * sizeof(targ_llong));
+        memset(outsum, 0, nnodes * sizeof(targ_llong));
+        memset(inunknown, 0, nnodes * sizeof(unsigned));
+        memset(outunknown, 0, nnodes * sizeof(unsigned));
+        for (unsigned i = 0; i < g.nedges; i++)
+        {
+            Edge *e = &g.edges[i];
+            if (eknown[i])
+            {
+                insum[e->to] += ecount[i];
+                outsum[e->from] += ecount[i];
+            }
+            else
+            {
+                inunknown[e->to]++;
+                inlast[e->to] = i;
+                outunknown[e->from]++;
+                outlast[e->from] = i;
+            }
+        }
+        for (unsigned v = 0; v < nnodes; v++)
+        {
+            if (!nknown[v])
+            {
+                if (inunknown[v] == 0)
+                    ncount[v] = insum[v];
+                else if (outunknown[v] == 0)
+                    ncount[v] = outsum[v];
+                else
+                    continue;
+                nknown[v] = 1;
+                changes = 1;
+            }
+            if (inunknown[v] == 1 && !eknown[inlast[v]])
+            {
+                ecount[inlast[v]] = ncount[v] - insum[v];
+                eknown[inlast[v]] = 1;
+                changes = 1;
+            }
+            if (outunknown[v] == 1 && !eknown[outlast[v]])
+            {
+                ecount[outlast[v]] = ncount[v] - outsum[v];
+                eknown[outlast[v]] = 1;
+                changes = 1;
+            }
+        }
+    } while (changes);
+
+    for (unsigned i = 0; i < g.nblocks; i++)
+    {
+        if (nknown[i])
+        {
+            // Runs cut short by exceptions can make the counts disagree
+            block *b = g.blocks[i];
+            b->Bcount = ncount[i] < 0 ? 0 : ncount[i];
+            b->Bflags |= BFLprofiled;
+        }
+    }
+    profile_calls = ep->counts[0] ? ep->counts[0] : 1;
+
+    free(outlast);
+    free(inlast);
+    free(outunknown);
+    free(inunknown);
+    free(outsum);
+    free(insum);
+    free(nknown);
+    free(ncount);
+    free(eknown);
+    free(ecount);
+    profile_graphfree(&g);
+}
+
+/**************************************
+ * Before the current function sfunc is optimized, add the code to count
+ * its branches for -profile=edges, or read the counts of its blocks
+ * from the profile.
+ * Returns:
+ *      number of blocks added
+ */
+
+unsigned profile_blocks(Symbol *sfunc)
+{
+    profile_calls = 0;
+    if (config.flags4 & CFG4profgen)
+        return profile_terminating ? 0 : profile_instrument(sfunc);
+    if (profile_edges)
+    {
+        EdgeProfile *ep = (EdgeProfile *)profile_edges->in(sfunc->Sident);
+        if (ep && ep->counts)
+            profile_apply(ep);
+    }
+    return 0;
+}
+
+/**************************************
+ * At the end of optimizing the current function, set the weights of
+ * its blocks from the counts of the profile. A block made by the
+ * optimizer is run no more often than the blocks next to it.
+ */
+
+void profile_weights()
+{
+    if (!profile_calls)
+        return;
+
+    const targ_ullong unknown = ~(targ_ullong)0;
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        if (!(b->Bflags & BFLprofiled))
+            b->Bcount = unknown;
+    }
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        for (list_t bl = b->Bsucc; bl; bl = list_next(bl))
+        {
+            block *bs = list_block(bl);
+            if (b->Bflags & BFLprofiled && !(bs->Bflags & BFLprofiled) && bs->Bcount > b->Bcount)
+                bs->Bcount = b->Bcount;
+            if (bs->Bflags & BFLprofiled && !(b->Bflags & BFLprofiled) && b->Bcount > bs->Bcount)
+                b->Bcount = bs->Bcount;
+        }
+    }
+
+    /* Once per call is a weight of 1, as it is for the loop nesting
+     * the weights are otherwise guessed from. A block that was never
+     * run weighs nothing.
+     */
+    for (block *b = startblock; b; b = b->Bnext)
+    {
+        if (b->Bcount == unknown)
+            continue;                   // keep the guess
+        targ_ullong w = (b->Bcount + profile_calls - 1) / profile_calls;
+        b->Bweight = w > 1000000 ? 1000000 : w;
+    }
+}
+
+/**************************************
+ * At the end of an object file, output the counters of its functions,
+ * and the code to write them to trace.cnt when the program exits:
+ *      static void __dpgo_write()
+ *      {
+ *          int fd = open("trace.cnt", O_WRONLY | O_CREAT | O_APPEND, 0666);
+ *          write(fd, &__dpgo, sizeof(__dpgo));
+ *          close(fd);
+ *      }
+ *      static void __dpgo_init() { atexit(&__dpgo_write); }
+ * with __dpgo_init() run before main().
+ */
+
+void profile_term()
+{
+    if (!profile_dtb)
+        return;
+    Symbol *sdata = profile_sym;
+    sdata->Sdt = profile_dtb->finish();
+    delete profile_dtb;
+    profile_dtb = nullptr;
+    profile_sym = nullptr;
+    outdata(sdata);
+
+    profile_terminating = true;
+
+    static type *tfunc;
+    if (!tfunc)
+    {
+        tfunc = type_function(TYnfunc, nullptr, 0, false, tsvoid);
+        tfunc->Tmangle = mTYman_c;
+        tfunc->Tcount++;
+    }
+
+    type *ptypes[3];
+    ptypes[0] = tspvoid;
+    ptypes[1] = tsint;
+    type *t = type_function(TYnfunc, ptypes, 2, true, tsint);
+    t->Tmangle = mTYman_c;
+    Symbol *sopen = symbol_name("open", SCextern, t);
+
+    ptypes[0] = tsint;
+    ptypes[1] = tspvoid;
+    ptypes[2] = tssize;
+    t = type_function(TYnfunc, ptypes, 3, false, tssize);
+    t->Tmangle = mTYman_c;
+    Symbol *swrite = symbol_name("write", SCextern, t);
+
+    t = type_function(TYnfunc, ptypes, 1, false, tsint);
+    t->Tmangle = mTYman_c;
+    Symbol *sclose = symbol_name("close", SCextern, t);
+
+    ptypes[0] = tspvoid;
+    t = type_function(TYnfunc, ptypes, 1, false, tsint);
+    t->Tmangle = mTYman_c;
+    Symbol *satexit = symbol_name("atexit", SCextern, t);
+
+    Symbol *sfwrite = symbol_name("__dpgo_write", SCstatic, tfunc);
+    localgot = nullptr;
+    cstate.CSpsymtab = &sfwrite->Sfunc->Flocsym;
+    static const char filename[] = "trace.cnt";
+    Symbol *sfile = out_readonly_sym(TYchar, (void *)filename, sizeof(filename));
+    elem *e = el_params(el_long(TYint, 0666),
+                        el_long(TYint, 0x441),  // O_WRONLY | O_CREAT | O_APPEND
+                        el_ptr(sfile),
+                        nullptr);
+    e = el_bin(OPcall, TYint, el_var(sopen), e);
+    e->Eflags |= EFLAGS_variadic;
+    Symbol *sfd = symbol_genauto(TYint);
+    e = el_bin(OPeq, TYint, el_var(sfd), e);
+    elem *ew = el_params(el_long(TYsize_t, profile_size), el_ptr(sdata), el_var(sfd), nullptr);
+    ew = el_bin(OPcall, TYsize_t, el_var(swrite), ew);
+    elem *ec = el_bin(OPcall, TYint, el_var(sclose), el_var(sfd));
+    e = el_combine(e, el_combine(ew, ec));
+    block *b = block_calloc();
+    b->BC = BCret;
+    b->Belem = e;
+    sfwrite->Sfunc->Fstartblock = b;
+    writefunc(sfwrite);
+
+    Symbol *sinit = symbol_name("__dpgo_init", SCstatic, tfunc);
+    localgot = nullptr;
+    cstate.CSpsymtab = &sinit->Sfunc->Flocsym;
+    e = el_bin(OPcall, TYint, el_var(satexit), el_ptr(sfwrite));
+    b = block_calloc();
+    b->BC = BCret;
+    b->Belem = e;
+    sinit->Sfunc->Fstartblock = b;
+    writefunc(sinit);
+    objmod->staticctor(sinit, 0, 0);
+
+    profile_terminating = false;
+}
+
+#endif
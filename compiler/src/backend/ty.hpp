@@ -104,11 +104,23 @@ enum TYM
     TYllong2            = 0x46, // long[2]
     TYullong2           = 0x47, // ulong[2]
 
+    // AVX 256 bit vector types
+    TYfloat8            = 0x48, // float[8]
+    TYdouble4           = 0x49, // double[4]
+    TYschar32           = 0x4A, // byte[32]
+    TYuchar32           = 0x4B, // ubyte[32]
+    TYshort16           = 0x4C, // short[16]
+    TYushort16          = 0x4D, // ushort[16]
+    TYlong8             = 0x4E, // int[8]
+    TYulong8            = 0x4F, // uint[8]
+    TYllong4            = 0x50, // long[4]
+    TYullong4           = 0x51, // ulong[4]
+
 #define TYaarray        TYnptr
 #define TYdelegate      (I64 ? TYcent : TYllong)
 #define TYdarray        (I64 ? TYucent : TYullong)
 
-    TYMAX               = 0x48,
+    TYMAX               = 0x52,
 };
 
 #define mTYbasic        0xFF    /* bit mask for basic types     */
@@ -206,7 +218,7 @@ extern unsigned tytab[];
 #define tyxmmreg(ty)    (tytab[(ty) & 0xFF] & TYFLxmmreg)
 
 // Is a vector type
-#define tyvector(ty)    (tybasic(ty) >= TYfloat4 && tybasic(ty) <= TYullong2)
+#define tyvector(ty)    (tybasic(ty) >= TYfloat4 && tybasic(ty) <= TYullong4)
 
 /* Types that are chars or shorts       */
 #define tyshort(ty)     (tytab[(ty) & 0xFF] & TYFLshort)
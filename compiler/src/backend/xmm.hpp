@@ -323,6 +323,12 @@ enum
 // AVX
     XGETBV = 0x0F01D0,
     XSETBV = 0x0F01D1,
+    VINSERTF128 = 0x660F3A18,   // VEX.256.66.0F3A 18 /r ib VINSERTF128 ymm1, ymm2, xmm3/m128, imm8
+
+// AVX2, VEX encoded only; VEX.W1 selects the quadword VPSLLVQ and VPSRLVQ
+    VPSLLVD = 0x660F3847,       // VEX.128.66.0F38.W0 47 /r VPSLLVD xmm1, xmm2, xmm3/m128
+    VPSRLVD = 0x660F3845,       // VEX.128.66.0F38.W0 45 /r VPSRLVD xmm1, xmm2, xmm3/m128
+    VPSRAVD = 0x660F3846,       // VEX.128.66.0F38.W0 46 /r VPSRAVD xmm1, xmm2, xmm3/m128
 
 // AES
     AESENC     = 0x660F38DC,
@@ -548,6 +548,8 @@ const unsigned FUNCFLAGinlineScanned      = 0x20;    // function has been scanne
 const unsigned FUNCFLAGinferScope         = 0x40;    // infer 'scope' for parameters
 const unsigned FUNCFLAGprintf             = 0x200;   // is a printf-like function
 const unsigned FUNCFLAGscanf              = 0x400;   // is a scanf-like function
+const unsigned FUNCFLAGnoEscape           = 0x800;   // address taken where it doesn't escape
+const unsigned FUNCFLAGoverridden         = 0x1000;  // a class in the compilation overrides it
 
 class FuncDeclaration : public Declaration
 {
@@ -600,6 +602,7 @@ public:
     // this one is overriding
     Type *tintro;
     bool inferRetType;                  // true if return type is to be inferred
+    bool lazySemantic;                  // true if semantic() was put off by -lazy until first use
     StorageClass storage_class2;        // storage class for template onemember's
 
     // Things that should really go into Scope
@@ -17,6 +17,9 @@
 #include "errors.hpp"
 #include "root/rmem.hpp"
 #include "root/root.hpp"
+#include "root/aav.hpp"
+
+#include <pthread.h>
 
 #include "macro.hpp"
 
@@ -39,6 +42,11 @@ Macro::Macro(const utf8_t *name, size_t namelen, const utf8_t *text, size_t text
     this->text = text;
     this->textlen = textlen;
     inuse = 0;
+
+    memo = nullptr;
+    memolen = 0;
+    deps = nullptr;
+    ndeps = 0;
 }
 
 
@@ -72,6 +80,10 @@ Macro *Macro::define(Macro **ptable, const utf8_t *name, size_t namelen, const u
         {
             table->text = text;
             table->textlen = textlen;
+            table->memo = nullptr;
+            table->memolen = 0;
+            table->deps = nullptr;
+            table->ndeps = 0;
             return table;
         }
     }
@@ -216,23 +228,182 @@ size_t extractArgN(const utf8_t *p, size_t end, const utf8_t **pmarg, size_t *pm
 }
 
 
+/* Bumped whenever an expansion depends on more than the macro table and
+ * its own argument, i.e. a recursive invocation was suppressed because
+ * an enclosing macro is in use, or the nesting limit was hit. Such
+ * expansions are not memoized.
+ */
+static thread_local unsigned contextDependent;
+
+/* A macro name looked up during an expansion, with the definition it
+ * resolved to. m and text are null if the name was not defined.
+ */
+struct MacroUse
+{
+    Macro *m;
+    const utf8_t *name;
+    size_t namelen;
+    const utf8_t *text;
+};
+
+/* Every macro name looked up so far, in order, so an expansion can find
+ * out which definitions it went through.
+ */
+static thread_local Array<MacroUse> *expanded;
+
+static void used(Macro *m, const utf8_t *name, size_t namelen, const utf8_t *text)
+{
+    MacroUse mu;
+    mu.m = m;
+    mu.name = name;
+    mu.namelen = namelen;
+    mu.text = text;
+    expanded->push(mu);
+}
+
+// Compound macros with more dependencies than this are not worth memoizing
+#define MEMO_MAXDEPS    64
+
+/* Memoized expansions shared by the macro tables of all modules, keyed by
+ * the macro's replacement text. Macros read from the .ddoc files are
+ * defined in every module's table with the same text, so an expansion
+ * made for one module can be reused for another whose table resolves
+ * every name it went through to the same definitions.
+ * Entries are never changed once added.
+ */
+struct SharedMemo
+{
+    const utf8_t *name;
+    size_t namelen;
+    const utf8_t *memo;
+    size_t memolen;
+    MacroUse *deps;             // m is not meaningful here
+    size_t ndeps;
+};
+
+static AA *sharedMemos;
+static pthread_mutex_t sharedMemosLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*****************************************************
+ * A memoized expansion was made with none of the macros it went through
+ * in use. It stays correct as long as that is still the case, as an
+ * in-use macro would be suppressed rather than expanded.
+ */
+bool Macro::memoValid()
+{
+    if (!memo || inuse)
+        return false;
+    for (size_t i = 0; i < ndeps; i++)
+    {
+        if (deps[i].m && deps[i].m->inuse)
+            return false;
+    }
+    return true;
+}
+
+/*****************************************************
+ * Look for an expansion of this macro memoized for another module's
+ * table. It can be used here if every name it looked up resolves to
+ * the same definition in table, and none of those is in use.
+ * If so, make it this macro's memo.
+ */
+bool Macro::memoShared(Macro *table)
+{
+    if (memo || inuse)
+        return false;
+
+    pthread_mutex_lock(&sharedMemosLock);
+    SharedMemo *sm = (SharedMemo *)dmd_aaGetRvalue(sharedMemos, (void *)text);
+    pthread_mutex_unlock(&sharedMemosLock);
+    if (!sm || sm->namelen != namelen || memcmp(sm->name, name, namelen) != 0)
+        return false;
+
+    MacroUse *d = (MacroUse *)mem.xmalloc(sm->ndeps * sizeof(MacroUse));
+    for (size_t i = 0; i < sm->ndeps; i++)
+    {
+        d[i] = sm->deps[i];
+        Macro *m = table->search(d[i].name, d[i].namelen);
+        if (m ? (m->text != d[i].text || m->inuse) : d[i].text != nullptr)
+        {
+            mem.xfree(d);
+            return false;
+        }
+        d[i].m = m;
+    }
+    deps = d;
+    ndeps = sm->ndeps;
+    memolen = sm->memolen;
+    memo = sm->memo;
+    return true;
+}
+
+/*****************************************************
+ * Remember p[0..len] as the argument-free expansion of this macro.
+ * expanded[depstart .. length] are the names it looked up.
+ */
+void Macro::memoize(const utf8_t *p, size_t len, size_t depstart)
+{
+    MacroUse tmp[MEMO_MAXDEPS];
+    size_t n = 0;
+    for (size_t i = depstart; i < expanded->length; i++)
+    {
+        MacroUse *d = &(*expanded)[i];
+        size_t j = 0;
+        while (j < n && !(tmp[j].text == d->text && tmp[j].namelen == d->namelen &&
+                          memcmp(tmp[j].name, d->name, d->namelen) == 0))
+            j++;
+        if (j < n)
+            continue;
+        if (n == MEMO_MAXDEPS)
+            return;
+        tmp[n++] = *d;
+    }
+    deps = (MacroUse *)mem.xmalloc(n * sizeof(MacroUse));
+    if (n)
+        memcpy(deps, tmp, n * sizeof(MacroUse));
+    ndeps = n;
+    memolen = len;
+    memo = memdup(p, len);
+
+    SharedMemo *sm = new SharedMemo();
+    sm->name = name;
+    sm->namelen = namelen;
+    sm->memo = memo;
+    sm->memolen = memolen;
+    sm->deps = deps;
+    sm->ndeps = ndeps;
+    pthread_mutex_lock(&sharedMemosLock);
+    SharedMemo **psm = (SharedMemo **)dmd_aaGet(&sharedMemos, (void *)text);
+    if (!*psm)
+        *psm = sm;
+    pthread_mutex_unlock(&sharedMemosLock);
+}
+
 /*****************************************************
  * Expand macro in place in buf.
  * Only look at the text in buf from start to end.
+ * The expansion of an argument-free $(NAME) is remembered in the
+ * macro, so repeated uses like $(LPAREN) or theme macros are copied
+ * rather than rescanned. Each module has its own macro table and
+ * expansion runs on a single thread per table; expansions of macros
+ * from the .ddoc files are also shared between tables (see SharedMemo).
  */
 
 void Macro::expand(OutBuffer *buf, size_t start, size_t *pend,
         const utf8_t *arg, size_t arglen)
 {
     // limit recursive expansion
-    static int nest;
+    static thread_local int nest;
     if (nest > global.recursionLimit)
     {
+        contextDependent++;
         error(Loc(), "DDoc macro expansion limit exceeded; more than %d expansions.",
               global.recursionLimit);
         return;
     }
     nest++;
+    if (!expanded)
+        expanded = new Array<MacroUse>();
 
     size_t end = *pend;
     assert(start <= end);
@@ -362,9 +533,13 @@ void Macro::expand(OutBuffer *buf, size_t start, size_t *pend,
 
                 if (!m)
                 {
+                    // The expansion depends on name not being defined
+                    used(nullptr, memdup(name, namelen), namelen, nullptr);
                     static const char undef[] = "DDOC_UNDEFINED_MACRO";
                     m = search((const utf8_t *)undef, strlen(undef));
-                    if (m)
+                    if (!m)
+                        used(nullptr, (const utf8_t *)undef, strlen(undef), nullptr);
+                    else
                     {
                         // Macro was not defined, so this is an expansion of
                         //   DDOC_UNDEFINED_MACRO. Prepend macro name to args.
@@ -389,8 +564,20 @@ void Macro::expand(OutBuffer *buf, size_t start, size_t *pend,
 
                 if (m)
                 {
+                    if (marglen == 0 && (m->memoValid() || m->memoShared(this)))
+                    {   // Replace $(NAME) with its remembered expansion
+                        used(m, m->name, m->namelen, m->text);
+                        for (size_t i = 0; i < m->ndeps; i++)
+                            expanded->push(m->deps[i]);
+                        buf->remove(u, v + 1 - u);
+                        buf->insert(u, m->memo, m->memolen);
+                        end += m->memolen - (v + 1 - u);
+                        u += m->memolen;
+                        continue;
+                    }
                     if (m->inuse && marglen == 0)
                     {   // Remove macro invocation
+                        contextDependent++;
                         buf->remove(u, v + 1 - u);
                         end -= v + 1 - u;
                     }
@@ -410,6 +597,7 @@ void Macro::expand(OutBuffer *buf, size_t start, size_t *pend,
                          *   marg is same as arg (with blue paint added)
                          * Just leave in place.
                          */
+                        contextDependent++;
                     }
                     else
                     {
@@ -426,6 +614,9 @@ void Macro::expand(OutBuffer *buf, size_t start, size_t *pend,
                         end += 2 + m->textlen + 2;
 
                         // Scan replaced text for further expansion
+                        const unsigned cd = contextDependent;
+                        used(m, m->name, m->namelen, m->text);
+                        const size_t depstart = expanded->length;
                         m->inuse++;
                         size_t mend = v + 1 + 2+m->textlen+2;
                         expand(buf, v + 1, &mend, marg, marglen);
@@ -434,6 +625,8 @@ void Macro::expand(OutBuffer *buf, size_t start, size_t *pend,
 
                         buf->remove(u, v + 1 - u);
                         end -= v + 1 - u;
+                        if (marglen == 0 && cd == contextDependent)
+                            m->memoize((const utf8_t *)buf->slice().ptr + u, mend - (v + 1), depstart);
                         u += mend - (v + 1);
                         mem.xfree(const_cast<utf8_t *>(marg));
                         //printf("u = %d, end = %d\n", u, end);
@@ -455,4 +648,6 @@ void Macro::expand(OutBuffer *buf, size_t start, size_t *pend,
     mem.xfree(const_cast<utf8_t *>(arg));
     *pend = end;
     nest--;
+    if (nest == 0)
+        expanded->setDim(0);
 }
@@ -10,6 +10,7 @@
 
 #include "root/dsystem.hpp"
 #include "root/rmem.hpp"
+#include "root/hash.hpp"
 
 #include "mars.hpp"
 #include "module.hpp"
@@ -33,6 +34,8 @@ Dsymbols Module::deferred;  // deferred Dsymbol's needing semantic() run on them
 Dsymbols Module::deferred2; // deferred Dsymbol's needing semantic2() run on them
 Dsymbols Module::deferred3; // deferred Dsymbol's needing semantic3() run on them
 unsigned Module::dprogress;
+unsigned Module::lazyFuncs;
+unsigned Module::lazyUsed;
 
 void Module::_init()
 {
@@ -48,6 +51,7 @@ Module::Module(const char *filename, Identifier *ident, int doDocComment, int do
     md = nullptr;
     errors = 0;
     numlines = 0;
+    srchash = 0;
     members = nullptr;
     isDocFile = 0;
     isPackageFile = false;
@@ -438,6 +442,9 @@ Module *Module::parse()
     utf8_t *buf = (utf8_t *)srcfile->buffer;
     size_t buflen = srcfile->len;
 
+    // Remember what was parsed for dependency files
+    srchash = calcHash64(buf, buflen);
+
     if (buflen >= 2)
     {
         /* Convert all non-UTF-8 formats to UTF-8.
@@ -333,6 +333,18 @@ static const char ddoc_decl_dd_e[] = ")\n";
  */
 
 void gendocfile(Module *m)
+{
+    gendocbody(m);
+    gendocexpand(m);
+}
+
+/****************************************************
+ * First half of gendocfile(): walk the module's AST and define the
+ * predefined macros and BODY in m->macrotable. Only one thread may run
+ * this at a time, as it interns identifiers and may run semantic on
+ * template mixins.
+ */
+void gendocbody(Module *m)
 {
     static OutBuffer mbuf;
     static int mbuf_done;
@@ -428,8 +440,21 @@ void gendocfile(Module *m)
     }
 
     //printf("BODY= '%.*s'\n", buf.length(), buf.slice().ptr);
-    Macro::define(&m->macrotable, (const utf8_t *)"BODY", 4, (const utf8_t *)buf.slice().ptr, buf.length());
+    const size_t bodylen = buf.length();
+    Macro::define(&m->macrotable, (const utf8_t *)"BODY", 4, (const utf8_t *)buf.extractData(), bodylen);
 
+    assert(m->docfile);
+    ensurePathToNameExists(Loc(), m->docfile->toChars());
+}
+
+/****************************************************
+ * Second half of gendocfile(): expand $(DDOC) using m->macrotable and
+ * write the documentation file. Only touches m's own macro table, so it
+ * can run for different modules at the same time.
+ */
+void gendocexpand(Module *m)
+{
+    OutBuffer buf;
     OutBuffer buf2;
     buf2.writestring("$(DDOC)\n");
     size_t end = buf2.length();
@@ -466,10 +491,8 @@ void gendocfile(Module *m)
     }
 
     // Transfer image to file
-    assert(m->docfile);
     m->docfile->setbuffer(buf.slice().ptr, buf.length());
     m->docfile->ref = 1;
-    ensurePathToNameExists(Loc(), m->docfile->toChars());
     writeFile(m->loc, m->docfile);
 }
 
@@ -17,3 +17,5 @@ struct OutBuffer;
 
 void escapeDdocString(OutBuffer *buf, size_t start);
 void gendocfile(Module *m);
+void gendocbody(Module *m);
+void gendocexpand(Module *m);
@@ -12,6 +12,7 @@
 #include "root/rmem.hpp"
 #include "root/speller.hpp"
 #include "root/aav.hpp"
+#include "root/threadpool.hpp"
 
 #include "mars.hpp"
 #include "dsymbol.hpp"
@@ -226,7 +227,7 @@ const char *Dsymbol::toPrettyChars(bool QualifyTypes)
     if (!parent)
     {
         const char *s = toChars();
-        if (!QualifyTypes)
+        if (!QualifyTypes && !ThreadPool::concurrent)
             prettystring = (const utf8_t *)s;
         return s;
     }
@@ -265,7 +266,7 @@ const char *Dsymbol::toPrettyChars(bool QualifyTypes)
         *--q = '.';
     }
     free(comp);
-    if (!QualifyTypes)
+    if (!QualifyTypes && !ThreadPool::concurrent)   // shared with other threads
         prettystring = (utf8_t *)s;
     return s;
 }
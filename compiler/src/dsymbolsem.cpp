@@ -164,6 +164,50 @@ static void resolveBase(ClassDeclaration *cd, Scope *sc, Scope *&scx, ClassDecla
     cd->_scope = nullptr;
 }
 
+/*********************************
+ * With -lazy, functions declared at module scope of an imported module
+ * are not analysed when the module is. They keep the scope that
+ * setScope() gave them, and semantic() runs the first time a lookup
+ * resolves to them and they are used (overload resolution and
+ * functionSemantic() already handle forward references this way).
+ * Returns:
+ *      true if semantic() for s was put off
+ */
+static bool putOffSemantic(Dsymbol *s)
+{
+    if (!global.params.lazySemantic)
+        return false;
+    FuncDeclaration *fd = s->isFuncDeclaration();
+    if (!fd || fd->semanticRun != PASSinit || !fd->_scope || fd->errors)
+        return false;
+    Module *m = fd->parent ? fd->parent->isModule() : nullptr;
+    if (!m || m->isRoot())
+        return false;
+
+    // These have effects on the module beyond their own signature
+    if (fd->isFuncLiteralDeclaration() ||
+        fd->isCtorDeclaration() ||
+        fd->isPostBlitDeclaration() ||
+        fd->isDtorDeclaration() ||
+        fd->isStaticCtorDeclaration() ||
+        fd->isStaticDtorDeclaration() ||
+        fd->isInvariantDeclaration() ||
+        fd->isUnitTestDeclaration() ||
+        fd->isNewDeclaration())
+        return false;
+
+    // Lookup and deprecation checks look at these before semantic() runs
+    fd->protection = fd->_scope->protection;
+    fd->storage_class |= fd->_scope->stc & STCdeprecated;
+
+    if (!fd->lazySemantic)
+    {
+        fd->lazySemantic = true;
+        Module::lazyFuncs++;
+    }
+    return true;
+}
+
 class DsymbolSemanticVisitor : public Visitor
 {
 public:
@@ -1244,6 +1288,8 @@ public:
             for (size_t i = 0; i < d->length; i++)
             {
                 Dsymbol *s = (*d)[i];
+                if (putOffSemantic(s))
+                    continue;
                 dsymbolSemantic(s, sc2);
                 errors |= s->errors;
             }
@@ -1646,6 +1692,8 @@ public:
             Dsymbol *s = (*m->members)[i];
 
             //printf("\tModule('%s'): '%s'.semantic()\n", m->toChars(), s->toChars());
+            if (putOffSemantic(s))
+                continue;
             dsymbolSemantic(s, sc);
             m->runDeferredSemantic();
         }
@@ -2499,6 +2547,8 @@ public:
         if (funcdecl->semanticRun >= PASSsemanticdone)
             return;
         assert(funcdecl->semanticRun <= PASSsemantic);
+        if (funcdecl->lazySemantic && funcdecl->semanticRun == PASSinit)
+            Module::lazyUsed++;
         funcdecl->semanticRun = PASSsemantic;
 
         if (funcdecl->_scope)
@@ -3059,6 +3109,11 @@ public:
                      */
                     funcdecl->foverrides.push(fdv);
 
+                    /* And that fdv is overridden, for the class hierarchy
+                     * analysis that calls functions without overrides directly
+                     */
+                    fdv->flags |= FUNCFLAGoverridden;
+
                     /* This works by whenever this function is called,
                      * it actually returns tintro, which gets dynamically
                      * cast to type. But we know that tintro is a base
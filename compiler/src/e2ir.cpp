@@ -56,6 +56,7 @@ elem *toElemDtor(Expression *e, IRState *irs);
 elem *toElemStructLit(StructLiteralExp *sle, IRState *irs, Symbol *sym, bool fillHoles);
 Symbol *toStringSymbol(const char *str, size_t len, size_t sz);
 Symbol *toStringSymbol(StringExp *se);
+void Expression_toDt(Expression *e, DtBuilder& dtb);
 void toObjFile(Dsymbol *ds, bool multiobj);
 Symbol *toImport(Dsymbol *ds);
 Symbol *toInitializer(AggregateDeclaration *ad);
@@ -104,6 +105,60 @@ elem *useOPstrpar(elem *e)
     return e;
 }
 
+/******************************************
+ * Class hierarchy analysis: decide how a call to virtual function fd
+ * through an object of static type t can be made.
+ * If no class in the compilation overrides fd, and every class that
+ * derives from t is in the compilation, as for non-static classes local
+ * to a function that isn't a template, fd is the only function it can call.
+ * If classes outside the compilation can derive from t, fd is only the
+ * likely one.
+ * Returns:
+ *      0       virtual call
+ *      1       fd is likely, call it directly if the vtbl[] has it
+ *      2       direct call
+ */
+
+static int devirtualize(FuncDeclaration *fd, Type *t)
+{
+    ClassDeclaration *cd = t ? t->isClassHandle() : nullptr;
+    if (!cd || cd->isInterfaceDeclaration() ||
+        fd->flags & FUNCFLAGoverridden || fd->isAbstract())
+        return 0;
+
+    /* A class nested in a function can only be derived from inside
+     * that function, as the derived class needs the same context.
+     * A static one can be derived from anywhere its type can be named,
+     * e.g. through typeof() of a function returning it.
+     */
+    Module *m = cd->getModule();
+    Dsymbol *p = cd->toParent2();
+    if (m && m->isRoot() && !cd->isInstantiated() &&
+        cd->isNested() && p && p->isFuncDeclaration())
+        return 2;
+    return 1;
+}
+
+/******************************************
+ * Rewrite virtual call e, the likely target of which is sfunc, as:
+ *      ((tmp = fp) == &sfunc) ? sfunc(params) : (*tmp)(params)
+ * which can expand the direct call inline.
+ * The params are evaluated once, as they have no side effects.
+ */
+
+static elem *guardedCall(elem *e, Symbol *sfunc)
+{
+    elem *ec = e->E1;                   // (*fp)
+    Symbol *stmp = symbol_genauto(type_fake(ec->E1->Ety));
+    elem *eeq = el_bin(OPeq, ec->E1->Ety, el_var(stmp), ec->E1);
+    ec->E1 = el_var(stmp);
+
+    elem *edirect = el_bin(e->Eoper, e->Ety, el_var(sfunc), el_copytree(e->E2));
+    edirect->Eflags = e->Eflags;
+    elem *etest = el_bin(OPeqeq, TYbool, eeq, el_ptr(sfunc));
+    return el_bin(OPcond, e->Ety, etest, el_bin(OPcolon, e->Ety, edirect, e));
+}
+
 /************************************
  * Call a function.
  */
@@ -131,6 +186,7 @@ elem *callfunc(Loc loc,
     TypeFunction *tf;
     int op;
     elem *eresult = ehidden;
+    Symbol *sguess = nullptr;           // likely function of a virtual call
 
     t = t->toBasetype();
     if (t->ty == Tdelegate)
@@ -260,6 +316,8 @@ elem *callfunc(Loc loc,
             eside = el_combine(ec, eside);
         }
         Symbol *sfunc = toSymbol(fd);
+        int devirt = esel || !fd->isVirtual() || directcall || fd->isFinalFunc()
+                        ? 0 : devirtualize(fd, ectype);
 
         if (esel)
         {
@@ -267,10 +325,8 @@ elem *callfunc(Loc loc,
         }
         else if (!fd->isVirtual() ||
             directcall ||               // BUG: fix
-            fd->isFinalFunc()
-           /* Future optimization: || (whole program analysis && not overridden)
-            */
-           )
+            fd->isFinalFunc() ||
+            devirt == 2)
         {
             // make static call
             ec = el_var(sfunc);
@@ -279,6 +335,19 @@ elem *callfunc(Loc loc,
         {
             // make virtual call
             assert(ethis);
+            if (devirt == 1 && global.params.useInline)
+            {
+                /* Evaluate 'this' up front, so the call can be made
+                 * either way without evaluating it twice
+                 */
+                if (el_sideeffect(ethis))
+                {
+                    Symbol *stmp = symbol_genauto(type_fake(ethis->Ety));
+                    eside = el_combine(eside, el_bin(OPeq, ethis->Ety, el_var(stmp), ethis));
+                    ethis = el_var(stmp);
+                }
+                sguess = sfunc;
+            }
             elem *ev = el_same(&ethis);
             ev = el_una(OPind, TYnptr, ev);
             unsigned vindex = fd->vtblIndex;
@@ -441,6 +510,10 @@ if (I32) assert(tysize[TYnptr] == 4);
 
         if (tf->parameterList.varargs)
             e->Eflags |= EFLAGS_variadic;
+
+        if (sguess && ep && !el_sideeffect(ep) &&
+            retmethod != RETstack && !tf->isref && tybasic(tyret) != TYstruct)
+            e = guardedCall(e, sguess);
     }
 
     if (retmethod == RETstack)
@@ -703,6 +776,116 @@ elem *getTypeInfo(Loc loc, Type *t, IRState *irs)
     return e;
 }
 
+/************************************
+ * Get the capacity, in elements, of the dynamic array at address ea,
+ * by calling _d_arraysetcapacity(ti, 0, ea).
+ * It is 0 unless the array can be appended to in place.
+ */
+
+elem *arrayCapacity(Loc loc, Type *t, elem *ea, IRState *irs)
+{
+    elem *ep = el_params(ea, el_long(TYsize_t, 0), getTypeInfo(loc, t, irs), nullptr);
+    return el_bin(OPcall, TYsize_t, el_var(getRtlsym(RTLSYM_ARRAYSETCAPACITY)), ep);
+}
+
+/************************************
+ * Record the length of the dynamic array e as the used length of
+ * its GC block, by calling _d_arrayshrinkfit(ti, e).
+ */
+
+elem *arrayShrinkFit(Loc loc, Type *t, elem *e, IRState *irs)
+{
+    elem *ep = el_params(useOPstrpar(e), getTypeInfo(loc, t, irs), nullptr);
+    return el_bin(OPcall, TYvoid, el_var(getRtlsym(RTLSYM_ARRAYSHRINKFIT)), ep);
+}
+
+/************************************
+ * Determine if e is a value that can be put into static data, and
+ * that refers to no data that could be written to through it.
+ */
+
+static bool isStaticConst(Expression *e)
+{
+    Type *tb = e->type->toBasetype();
+    switch (e->op)
+    {
+        case TOKint64:
+        case TOKfloat64:
+        case TOKcomplex80:
+        case TOKnull:
+            return true;
+
+        case TOKstring:
+        case TOKarrayliteral:
+            if (tb->ty != Tsarray && tb->nextOf()->isMutable())
+                return false;
+            if (e->op == TOKarrayliteral)
+            {
+                ArrayLiteralExp *ale = (ArrayLiteralExp *)e;
+                if (!ale->elements)
+                    return false;
+                for (size_t i = 0; i < ale->elements->length; i++)
+                {
+                    if (!isStaticConst(ale->getElement(i)))
+                        return false;
+                }
+            }
+            return true;
+
+        case TOKstructliteral:
+        {
+            StructLiteralExp *sle = (StructLiteralExp *)e;
+            if (sle->sd->isNested())
+                return false;
+            for (size_t i = 0; i < sle->elements->length; i++)
+            {
+                Expression *el = (*sle->elements)[i];
+                if (el && !isStaticConst(el))
+                    return false;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/************************************
+ * If the elements exps[] (with nullptr standing for basis) are constants
+ * worth copying as a block rather than storing one by one, put them
+ * into a read-only static array of type tsarray and return its symbol.
+ * Runs of equal elements count once, as they are set together.
+ */
+
+static Symbol *toStaticConstArray(Expressions *exps, Expression *basis, Type *tsarray, size_t minruns)
+{
+    size_t runs = 0;
+    Expression *eprev = nullptr;
+    for (size_t i = 0; i < exps->length; i++)
+    {
+        Expression *el = (*exps)[i] ? (*exps)[i] : basis;
+        if (!isStaticConst(el))
+            return nullptr;
+        if (!eprev || !el->equals(eprev))
+            runs++;
+        eprev = el;
+    }
+    if (runs < minruns)
+        return nullptr;
+
+    DtBuilder dtb;
+    for (size_t i = 0; i < exps->length; i++)
+        Expression_toDt((*exps)[i] ? (*exps)[i] : basis, dtb);
+
+    Symbol *s = symbol_generate(SCstatic, Type_toCtype(tsarray));
+    s->Sdt = dtb.finish();
+    s->Sfl = FLdata;
+    out_readonly(s);
+    outdata(s);
+    return s;
+}
+
 /********************************************
  * Determine if t is a struct that has postblit.
  */
@@ -861,11 +1044,25 @@ Lagain:
             }
             break;
     }
-    if (sz > 1 && sz <= 8 &&
-        evalue->Eoper == OPconst && el_allbits(evalue, 0))
+    if (sz > 1 && sz <= 8 && evalue->Eoper == OPconst)
     {
-        r = RTLSYM_MEMSET8;
-        edim = el_bin(OPmul, TYsize_t, edim, el_long(TYsize_t, sz));
+        /* If every byte of evalue is the same, set the array a byte at a
+         * time, which the code generator expands inline for small arrays.
+         */
+        targ_ullong value = evalue->EV.Vullong;
+        targ_ullong bytes = 0x0101010101010101ULL;
+        if (sz < 8)
+        {
+            value &= (1ULL << (sz * 8)) - 1;
+            bytes &= (1ULL << (sz * 8)) - 1;
+        }
+        if (value == (value & 0xFF) * bytes)
+        {
+            r = RTLSYM_MEMSET8;
+            edim = el_bin(OPmul, TYsize_t, edim, el_long(TYsize_t, sz));
+            el_free(evalue);
+            evalue = el_long(TYuchar, value & 0xFF);
+        }
     }
 
     evalue = useOPstrpar(evalue);
@@ -2108,9 +2305,36 @@ elem *toElem(Expression *e, IRState *irs)
         /************************************
          */
 
+        /***************************************
+         * Integer vectors are divided by a constant, which semantic()
+         * left folded into e2, with el_vectordiv().
+         */
+
+        elem *toElemVectorDiv(BinExp *be, int op)
+        {
+            elem *e = el_vectordiv(op, totym(be->type), toElem(be->e1, irs), vectorDivisor(be->e2));
+            el_setLoc(e, be->loc);
+            return e;
+        }
+
+        static targ_llong vectorDivisor(Expression *e2)
+        {
+            assert(e2->op == TOKvector);
+            return ((VectorExp *)e2)->e1->toInteger();
+        }
+
+        static bool isIntegralVector(Type *t)
+        {
+            t = t->toBasetype();
+            return t->ty == Tvector && t->isintegral();
+        }
+
         void visit(DivExp *e)
         {
-            result = toElemBin(e, OPdiv);
+            if (isIntegralVector(e->e1->type))
+                result = toElemVectorDiv(e, OPdiv);
+            else
+                result = toElemBin(e, OPdiv);
         }
 
         /***************************************
@@ -2118,7 +2342,10 @@ elem *toElem(Expression *e, IRState *irs)
 
         void visit(ModExp *e)
         {
-            result = toElemBin(e, OPmod);
+            if (isIntegralVector(e->e1->type))
+                result = toElemVectorDiv(e, OPmod);
+            else
+                result = toElemBin(e, OPmod);
         }
 
         /***************************************
@@ -2152,6 +2379,14 @@ elem *toElem(Expression *e, IRState *irs)
                     ce->print();
                     assert(0);
             }
+            if (t1->ty == Tvector)
+            {
+                // Element by element, giving a mask
+                elem *e = el_vectorcmp(eop, totym(ce->type), toElem(ce->e1, irs), toElem(ce->e2, irs));
+                el_setLoc(e, ce->loc);
+                result = e;
+                return;
+            }
             if (!t1->isfloating())
             {
                 // Convert from floating point compare to equivalent
@@ -2215,7 +2450,13 @@ elem *toElem(Expression *e, IRState *irs)
 
             //printf("EqualExp::toElem()\n");
             elem *e;
-            if (t1->ty == Tstruct && ((TypeStruct *)t1)->sym->fields.length == 0)
+            if (t1->ty == Tvector)
+            {
+                // Element by element, giving a mask
+                e = el_vectorcmp(eop, totym(ee->type), toElem(ee->e1, irs), toElem(ee->e2, irs));
+                el_setLoc(e, ee->loc);
+            }
+            else if (t1->ty == Tstruct && ((TypeStruct *)t1)->sym->fields.length == 0)
             {
                 // we can skip the compare if the structs are empty
                 e = el_long(TYbool, ee->op == TOKequal);
@@ -3002,20 +3243,63 @@ elem *toElem(Expression *e, IRState *irs)
                         e2 = el_var(s2);
                     }
 
+                    /* The enclosing loop caches the capacity of the array
+                     * it appends to, see appendLoopVar() in s2ir.c
+                     */
+                    Symbol *scap = nullptr;
+                    if (irs->appendCap && ce->e1->op == TOKvar &&
+                        ((VarExp *)ce->e1)->var == irs->appendVar)
+                    {
+                        assert(e1->Eoper == OPvar);
+                        scap = irs->appendCap;
+                    }
+                    elem *earr = el_copytree(e1);
+
                     // Extend array with _d_arrayappendcTX(TypeInfo ti, e1, 1)
                     e1 = el_una(OPaddr, TYnptr, e1);
                     elem *ep = el_param(e1, getTypeInfo(ce->e1->loc, ce->e1->type, irs));
                     ep = el_param(el_long(TYsize_t, 1), ep);
                     e = el_bin(OPcall, TYdarray, el_var(getRtlsym(RTLSYM_ARRAYAPPENDCTX)), ep);
                     toTraceGC(irs, e, &ce->loc);
-                    symbol *stmp = symbol_genauto(Type_toCtype(tb1));
-                    e = el_bin(OPeq, TYdarray, el_var(stmp), e);
+                    if (scap)
+                    {
+                        /* Bump the length in place while it is below the capacity,
+                         * the runtime only needs to be called when the block is full:
+                         *   e1.length < cap
+                         *      ? e1.length += 1
+                         *      : (cap && _d_arrayshrinkfit(ti, e1),
+                         *         e1 = _d_arrayappendcTX(ti, &e1, 1),
+                         *         cap = _d_arraysetcapacity(ti, 0, &e1))
+                         * The used length in the block is only brought up to date
+                         * before calling the runtime and when the loop is done.
+                         */
+                        elem *ecap = el_bin(OPeq, TYsize_t, el_var(scap),
+                            arrayCapacity(ce->e1->loc, ce->e1->type,
+                                el_una(OPaddr, TYnptr, el_copytree(earr)), irs));
+                        e = el_bin(OPeq, TYdarray, el_copytree(earr), e);
+                        elem *efit = el_bin(OPandand, TYvoid, el_var(scap),
+                            arrayShrinkFit(ce->e1->loc, ce->e1->type, el_copytree(earr), irs));
+                        e = el_combine(efit, el_combine(e, ecap));
+
+                        elem *ebump = el_una(OPind, TYsize_t, el_una(OPaddr, TYnptr, el_copytree(earr)));
+                        ebump = el_bin(OPaddass, TYsize_t, ebump, el_long(TYsize_t, 1));
+                        elem *elen = el_una(I64 ? OP128_64 : OP64_32, TYsize_t, el_copytree(earr));
+                        elem *ec = el_bin(OPlt, TYint, elen, el_var(scap));
+                        e = el_bin(OPcond, TYvoid, ec, el_bin(OPcolon, TYvoid, ebump, e));
+                    }
+                    else
+                    {
+                        symbol *stmp = symbol_genauto(Type_toCtype(tb1));
+                        e = el_bin(OPeq, TYdarray, el_var(stmp), e);
+                        el_free(earr);
+                        earr = el_var(stmp);
+                    }
 
-                    // Assign e2 to last element in stmp[]
-                    // *(stmp.ptr + (stmp.length - 1) * szelem) = e2
+                    // Assign e2 to last element in earr[]
+                    // *(earr.ptr + (earr.length - 1) * szelem) = e2
 
-                    elem *eptr = array_toPtr(tb1, el_var(stmp));
-                    elem *elength = el_una(I64 ? OP128_64 : OP64_32, TYsize_t, el_var(stmp));
+                    elem *eptr = array_toPtr(tb1, el_copytree(earr));
+                    elem *elength = el_una(I64 ? OP128_64 : OP64_32, TYsize_t, el_copytree(earr));
                     elength = el_bin(OPmin, TYsize_t, elength, el_long(TYsize_t, 1));
                     elength = el_bin(OPmul, TYsize_t, elength, el_long(TYsize_t, ce->e2->type->size()));
                     eptr = el_bin(OPadd, TYnptr, eptr, elength);
@@ -3036,7 +3320,7 @@ elem *toElem(Expression *e, IRState *irs)
 
                     e = el_combine(e2x, e);
                     e = el_combine(e, eeq);
-                    e = el_combine(e, el_var(stmp));
+                    e = el_combine(e, earr);
                 }
                 else
                 {
@@ -3056,7 +3340,10 @@ elem *toElem(Expression *e, IRState *irs)
 
         void visit(DivAssignExp *e)
         {
-            result = toElemBinAssign(e, OPdivass);
+            if (isIntegralVector(e->e1->type))
+                result = toElemVectorOpAssign(e, OPdiv);
+            else
+                result = toElemBinAssign(e, OPdivass);
         }
 
         /***************************************
@@ -3064,7 +3351,10 @@ elem *toElem(Expression *e, IRState *irs)
 
         void visit(ModAssignExp *e)
         {
-            result = toElemBinAssign(e, OPmodass);
+            if (isIntegralVector(e->e1->type))
+                result = toElemVectorOpAssign(e, OPmod);
+            else
+                result = toElemBinAssign(e, OPmodass);
         }
 
         /***************************************
@@ -3078,9 +3368,38 @@ elem *toElem(Expression *e, IRState *irs)
         /***************************************
          */
 
+        /***************************************
+         * There are no vector op= shifts or integer divides in the backend,
+         * so rewrite as:
+         *      (tmp = &e1), (*tmp = *tmp op e2)
+         */
+
+        elem *toElemVectorOpAssign(BinAssignExp *be, int op)
+        {
+            tym_t tym = totym(be->type);
+            elem *ea = addressElem(toElem(be->e1, irs), be->e1->type->pointerTo());
+            elem *ec = nullptr;
+            if (el_sideeffect(ea))
+            {
+                elem *et = el_copytotmp(&ea);
+                ec = ea;
+                ea = et;
+            }
+            elem *el = el_una(OPind, tym, el_copytree(ea));
+            elem *er = (op == OPdiv || op == OPmod)
+                ? el_vectordiv(op, tym, el_una(OPind, tym, ea), vectorDivisor(be->e2))
+                : el_vectorshift(op, tym, el_una(OPind, tym, ea), toElem(be->e2, irs));
+            elem *e = el_combine(ec, el_bin(OPeq, tym, el, er));
+            el_setLoc(e, be->loc);
+            return e;
+        }
+
         void visit(ShlAssignExp *e)
         {
-            result = toElemBinAssign(e, OPshlass);
+            if (e->e1->type->toBasetype()->ty == Tvector)
+                result = toElemVectorOpAssign(e, OPshl);
+            else
+                result = toElemBinAssign(e, OPshlass);
         }
 
         /***************************************
@@ -3097,7 +3416,10 @@ elem *toElem(Expression *e, IRState *irs)
                 CastExp *ce = (CastExp *)e->e1;
                 t1 = ce->e1->type;
             }
-            result = toElemBinAssign(e, t1->isunsigned() ? OPshrass : OPashrass);
+            if (t1->toBasetype()->ty == Tvector)
+                result = toElemVectorOpAssign(e, t1->isunsigned() ? OPshr : OPashr);
+            else
+                result = toElemBinAssign(e, t1->isunsigned() ? OPshrass : OPashrass);
         }
 
         /***************************************
@@ -3105,7 +3427,10 @@ elem *toElem(Expression *e, IRState *irs)
 
         void visit(UshrAssignExp *e)
         {
-            result = toElemBinAssign(e, OPshrass);
+            if (e->e1->type->toBasetype()->ty == Tvector)
+                result = toElemVectorOpAssign(e, OPshr);
+            else
+                result = toElemBinAssign(e, OPshrass);
         }
 
         /***************************************
@@ -3210,9 +3535,21 @@ elem *toElem(Expression *e, IRState *irs)
         /***************************************
          */
 
+        elem *toElemVectorShift(BinExp *be, int op)
+        {
+            elem *el = toElem(be->e1, irs);
+            elem *er = toElem(be->e2, irs);
+            elem *e = el_vectorshift(op, totym(be->type), el, er);
+            el_setLoc(e, be->loc);
+            return e;
+        }
+
         void visit(ShlExp *e)
         {
-            result = toElemBin(e, OPshl);
+            if (e->e1->type->toBasetype()->ty == Tvector)
+                result = toElemVectorShift(e, OPshl);
+            else
+                result = toElemBin(e, OPshl);
         }
 
         /***************************************
@@ -3220,7 +3557,11 @@ elem *toElem(Expression *e, IRState *irs)
 
         void visit(ShrExp *e)
         {
-            result = toElemBin(e, e->e1->type->isunsigned() ? OPshr : OPashr);
+            OPER op = e->e1->type->isunsigned() ? OPshr : OPashr;
+            if (e->e1->type->toBasetype()->ty == Tvector)
+                result = toElemVectorShift(e, op);
+            else
+                result = toElemBin(e, op);
         }
 
         /***************************************
@@ -3228,6 +3569,11 @@ elem *toElem(Expression *e, IRState *irs)
 
         void visit(UshrExp *se)
         {
+            if (se->e1->type->toBasetype()->ty == Tvector)
+            {
+                result = toElemVectorShift(se, OPshr);
+                return;
+            }
             elem *eleft  = toElem(se->e1, irs);
             eleft->Ety = touns(eleft->Ety);
             elem *eright = toElem(se->e2, irs);
@@ -3381,7 +3727,8 @@ elem *toElem(Expression *e, IRState *irs)
 
                 if (!de->func->isVirtual() ||
                     directcall ||
-                    de->func->isFinalFunc())
+                    de->func->isFinalFunc() ||
+                    devirtualize(de->func, de->e1->type) == 2)
                 {
                     ep = el_ptr(sfunc);
                 }
@@ -3724,7 +4071,29 @@ elem *toElem(Expression *e, IRState *irs)
         void visit(VectorExp *ve)
         {
             elem *e;
-            if (ve->e1->op == TOKarrayliteral)
+            if (ve->e1->op == TOKarrayliteral && ve->type->size(Loc()) > 16)
+            {
+                /* A 256 bit constant does not fit in an elem, so
+                 * build it in a temporary:
+                 *   *(&stmp + i * esize) = e1[i], ..., stmp
+                 */
+                Symbol *stmp = symbol_genauto(Type_toCtype(ve->type));
+                ArrayLiteralExp *ale = (ArrayLiteralExp *)ve->e1;
+                e = nullptr;
+                for (size_t i = 0; i < ve->dim; i++)
+                {
+                    Expression *el = ale->getElement(i);
+                    tym_t tym = totym(el->type);
+                    elem *ea = el_bin(OPadd, TYnptr, el_ptr(stmp),
+                                      el_long(TYsize_t, i * el->type->size(Loc())));
+                    elem *eeq = el_bin(OPeq, tym, el_una(OPind, tym, ea), toElem(el, irs));
+                    e = el_combine(e, eeq);
+                }
+                elem *ev = el_var(stmp);
+                ev->Ety = totym(ve->type);
+                e = el_combine(e, ev);
+            }
+            else if (ve->e1->op == TOKarrayliteral)
             {
                 e = el_calloc();
                 e->Eoper = OPconst;
@@ -3805,6 +4174,13 @@ elem *toElem(Expression *e, IRState *irs)
             {
                 // For other vector expressions this just a paint operation.
                 result = toElem(vae->e1, irs);
+                if (result->Eoper == OPvector)
+                {
+                    // Which computes into an XMM register, so view it as
+                    // an array in a temporary
+                    result = exp2_copytotemp(result);
+                    result->E2->Ety = totym(vae->type);
+                }
             }
             result->Ety = totym(vae->type);
             el_setLoc(result, vae->loc);
@@ -4801,12 +5177,21 @@ elem *toElem(Expression *e, IRState *irs)
             }
 
             elem *e;
+            Symbol *sdata;
             if (tb->ty == Tsarray && dim)
             {
                 Symbol *stmp = nullptr;
                 e = ExpressionsToStaticArray(ale->loc, ale->elements, &stmp, 0, ale->basis);
                 e = el_combine(e, el_ptr(stmp));
             }
+            else if (dim && !tb->nextOf()->isMutable() &&
+                     (sdata = toStaticConstArray(ale->elements, ale->basis, tb->nextOf()->sarrayOf(dim), 0)) != nullptr)
+            {
+                /* No one can write to the elements, so there is no need for
+                 * a new array each time: refer to a single one in read-only data.
+                 */
+                e = el_ptr(sdata);
+            }
             else if (ale->elements)
             {
                 /* Instead of passing the initializers on the stack, allocate the
@@ -5032,6 +5417,24 @@ elem *toElem(Expression *e, IRState *irs)
             }
             symbol *stmp = *psym;
 
+            /* Copy more than a few different constants from an image of the
+             * whole array in read-only data
+             */
+            if (Symbol *sdata = toStaticConstArray(exps, basis, tsarray, 5))
+            {
+                ::type *ta = Type_toCtype(tsarray);
+                elem *ev = tybasic(stmp->Stype->Tty) == TYnptr ? el_var(stmp) : el_ptr(stmp);
+                ev = el_bin(OPadd, TYnptr, ev, el_long(TYsize_t, offset));
+                ev = el_una(OPind, TYstruct, ev);
+                ev->ET = ta;
+                elem *es = el_var(sdata);
+                es->Ety = TYstruct;
+                es->ET = ta;
+                elem *e = el_bin(OPstreq, TYstruct, ev, es);
+                e->ET = ta;
+                return e;
+            }
+
             elem *e = nullptr;
             for (size_t i = 0; i < dim; )
             {
@@ -5117,11 +5520,16 @@ elem *toElem(Expression *e, IRState *irs)
                 assert(t->ty == Taarray);
                 Type *ta = t;
 
-                symbol *skeys = nullptr;
-                elem *ekeys = ExpressionsToStaticArray(aale->loc, aale->keys, &skeys);
+                /* The runtime only reads the keys and values, so constant ones
+                 * can be passed straight from read-only data
+                 */
+                symbol *skeys = toStaticConstArray(aale->keys, nullptr,
+                    ((TypeAArray *)ta)->index->sarrayOf(dim), 0);
+                elem *ekeys = skeys ? nullptr : ExpressionsToStaticArray(aale->loc, aale->keys, &skeys);
 
-                symbol *svalues = nullptr;
-                elem *evalues = ExpressionsToStaticArray(aale->loc, aale->values, &svalues);
+                symbol *svalues = toStaticConstArray(aale->values, nullptr,
+                    ((TypeAArray *)ta)->next->sarrayOf(dim), 0);
+                elem *evalues = svalues ? nullptr : ExpressionsToStaticArray(aale->loc, aale->values, &svalues);
 
                 elem *ev = el_pair(TYdarray, el_long(TYsize_t, dim), el_ptr(svalues));
                 elem *ek = el_pair(TYdarray, el_long(TYsize_t, dim), el_ptr(skeys  ));
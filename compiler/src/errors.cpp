@@ -153,6 +153,8 @@ void verrorPrint(const Loc& loc, COLOR headerColor, const char *header, const ch
 {
     const char *p = loc.toChars();
 
+    // Keep the parts of one message together if worker threads report too
+    flockfile(stderr);
     if (global.params.color)
         setConsoleColorBright(true);
     if (*p)
@@ -172,13 +174,14 @@ void verrorPrint(const Loc& loc, COLOR headerColor, const char *header, const ch
     tmp.vprintf(format, ap);
     fprintf(stderr, "%s\n", tmp.peekChars());
     fflush(stderr);
+    funlockfile(stderr);
 }
 
 // header is "Error: " by default (see errors.h)
 void verror(const Loc& loc, const char *format, va_list ap,
                 const char *p1, const char *p2, const char *header)
 {
-    global.errors++;
+    __atomic_add_fetch(&global.errors, 1, __ATOMIC_RELAXED);
     if (!global.gag)
     {
         verrorPrint(loc, COLOR_RED, header, format, ap, p1, p2);
@@ -208,7 +211,7 @@ void vwarning(const Loc& loc, const char *format, va_list ap)
         {
             verrorPrint(loc, COLOR_YELLOW, "Warning: ", format, ap);
             if (global.params.warnings == DIAGNOSTICerror)
-                global.warnings++;  // warnings don't count if gagged
+                __atomic_add_fetch(&global.warnings, 1, __ATOMIC_RELAXED);  // warnings don't count if gagged
         }
         else
         {
@@ -13,8 +13,12 @@
 #include "expression.hpp"
 #include "scope.hpp"
 #include "aggregate.hpp"
+#include "attrib.hpp"
 #include "declaration.hpp"
 #include "module.hpp"
+#include "statement.hpp"
+#include "template.hpp"
+#include "visitor.hpp"
 
 /************************************
  * Aggregate the data collected by the escapeBy??() functions.
@@ -1232,3 +1236,716 @@ void findAllOuterAccessedVariables(FuncDeclaration *fd, VarDeclarations *vars)
         }
     }
 }
+
+/************************************************************
+ * Inference of allocations that can go on the stack because nothing
+ * refers to them after the function they are made in returns:
+ *  1. the closure of a function, when the delegates that need it are
+ *     only passed to parameters that don't escape or held in variables
+ *     that don't escape
+ *  2. a class instance created by `new`, when the reference to it is
+ *     held in a variable that doesn't escape
+ * A variable doesn't escape if every use of it is accounted for: a
+ * delegate may be called, a class reference may be used to get at fields
+ * and to call methods that don't let `this` escape, and both may be
+ * tested, compared with `is`, overwritten and passed to parameters that
+ * don't escape. Any other use, taking its address included, is taken
+ * to escape.
+ */
+
+bool walkPostorder(Expression *e, StoppableVisitor *v);
+bool walkPostorder(Statement *s, StoppableVisitor *v);
+
+static bool valueEscapes(FuncDeclaration *fd, VarDeclaration *v, ClassDeclaration *cd, int depth);
+
+#define ESCAPE_DEPTH    4       // how deep to follow calls
+#define STACKNEW_MAX    1024    // largest class instance to put on the stack
+
+/* Is e a use of v?
+ * The `this` generated for invariant calls has no var set.
+ */
+static bool isUse(Expression *e, VarDeclaration *v)
+{
+    if (e->op == TOKvar)
+        return ((VarExp *)e)->var == v;
+    if (e->op == TOKthis || e->op == TOKsuper)
+    {
+        VarDeclaration *vthis = ((ThisExp *)e)->var;
+        return vthis ? vthis == v : v->isThisDeclaration() != nullptr;
+    }
+    return false;
+}
+
+/* Skip the casts that convert a delegate or class reference
+ * to another type of the same kind without changing it.
+ */
+static Expression *skipCasts(Expression *e)
+{
+    while (e->op == TOKcast)
+    {
+        Expression *e1 = ((CastExp *)e)->e1;
+        Type *tto = e->type->toBasetype();
+        Type *tfrom = e1->type->toBasetype();
+        if (tto->ty == Tdelegate && tfrom->ty == Tdelegate)
+            ;
+        else if (tto->ty == Tclass && tfrom->ty == Tclass &&
+                 !((TypeClass *)tto)->sym->isInterfaceDeclaration() &&
+                 !((TypeClass *)tfrom)->sym->isInterfaceDeclaration())
+            ;
+        else
+            break;
+        e = e1;
+    }
+    return e;
+}
+
+/* Does e refer to a field of the object v refers to, so taking its
+ * address would point into the object?
+ */
+static bool refersToField(Expression *e, VarDeclaration *v)
+{
+    class FieldRef : public StoppableVisitor
+    {
+    public:
+        VarDeclaration *v;
+
+        FieldRef(VarDeclaration *v) : v(v) {}
+
+        void visit(Expression *)
+        {
+        }
+
+        void visit(DotVarExp *e)
+        {
+            if (isUse(e->e1, v))
+                stop = true;
+        }
+    };
+
+    FieldRef fr(v);
+    return walkPostorder(e, &fr);
+}
+
+/* Get parameter j of the function called by ce, or nullptr if it is
+ * one of the variadic arguments.
+ */
+static Parameter *callParameter(CallExp *ce, size_t j, TypeFunction **ptf)
+{
+    Type *t = ce->e1->type ? ce->e1->type->toBasetype() : nullptr;
+    if (t && (t->ty == Tdelegate || t->ty == Tpointer))
+        t = t->nextOf()->toBasetype();
+    if (!t || t->ty != Tfunction)
+        return nullptr;
+    TypeFunction *tf = (TypeFunction *)t;
+    if (j >= tf->parameterList.length())
+        return nullptr;
+    *ptf = tf;
+    return tf->parameterList[j];
+}
+
+/* Can argument j of ce escape from the called function?
+ */
+static bool argumentEscapes(CallExp *ce, size_t j, int depth)
+{
+    TypeFunction *tf;
+    Parameter *p = callParameter(ce, j, &tf);
+    if (!p || p->storageClass & (STCref | STCout | STClazy))
+        return true;
+    if (!tf->parameterEscapes(p))
+        return false;           // scope parameter
+
+    FuncDeclaration *f = ce->f;
+    if (!f || !f->parameters || f->parameters->length != tf->parameterList.length())
+        return true;
+    if (f->isVirtual() && !f->isFinalFunc())
+        return true;            // an override might keep it
+    return valueEscapes(f, (*f->parameters)[j], nullptr, depth + 1);
+}
+
+/* Forward every expression to v, walking the initializers of the
+ * variables declared by a DeclarationExp first.
+ */
+class DeclarationWalker : public StoppableVisitor
+{
+public:
+    StoppableVisitor *v;
+
+    DeclarationWalker(StoppableVisitor *v) : v(v) {}
+
+    void visit(Expression *e)
+    {
+        e->accept(v);
+        stop = v->stop;
+    }
+
+    void visit(DeclarationExp *e)
+    {
+        walkDsymbol(e->declaration);
+        if (!stop)
+            visit((Expression *)e);
+    }
+
+    void walkDsymbol(Dsymbol *s)
+    {
+        if (stop)
+            return;
+        if (AttribDeclaration *ad = s->isAttribDeclaration())
+        {
+            Dsymbols *decl = ad->include(nullptr);
+            for (size_t i = 0; decl && i < decl->length; i++)
+                walkDsymbol((*decl)[i]);
+        }
+        else if (VarDeclaration *vd = s->isVarDeclaration())
+        {
+            if (vd->isDataseg() || vd->storage_class & STCmanifest || !vd->_init)
+                return;
+            if (ExpInitializer *ie = vd->_init->isExpInitializer())
+                walkPostorder(ie->exp, this);
+            else if (!vd->_init->isVoidInitializer())
+                stop = true;    // can't tell what it refers to
+        }
+        else if (TemplateMixin *tm = s->isTemplateMixin())
+        {
+            for (size_t i = 0; tm->members && i < tm->members->length; i++)
+                walkDsymbol((*tm->members)[i]);
+        }
+        else if (TupleDeclaration *td = s->isTupleDeclaration())
+        {
+            for (size_t i = 0; i < td->objects->length; i++)
+            {
+                RootObject *o = (*td->objects)[i];
+                if (o->dyncast() == DYNCAST_EXPRESSION && ((Expression *)o)->op == TOKdsymbol)
+                    walkDsymbol(((DsymbolExp *)o)->s);
+            }
+        }
+    }
+};
+
+/* Walk the expressions of every statement in a function body.
+ * When v is set, also count the harmless uses of v that appear
+ * directly in a statement: tested as a condition, or returned from
+ * a constructor as the implicit `this`.
+ * Stops on inline assembler, which might do anything.
+ */
+class StatementWalker : public StoppableVisitor
+{
+public:
+    DeclarationWalker dw;
+    VarDeclaration *v;
+    bool ctor;                  // walking a constructor
+    bool refReturn;             // walking a function that returns by ref
+    size_t harmless;
+
+    StatementWalker(StoppableVisitor *ev, VarDeclaration *v, FuncDeclaration *fd)
+        : dw(ev), v(v), harmless(0)
+    {
+        ctor = fd->isCtorDeclaration() != nullptr;
+        refReturn = fd->type && fd->type->ty == Tfunction && ((TypeFunction *)fd->type)->isref;
+    }
+
+    void walk(Expression *e)
+    {
+        if (e && !stop)
+        {
+            walkPostorder(e, &dw);
+            stop = dw.stop;
+        }
+    }
+
+    void condition(Expression *e)
+    {
+        if (e && v && isUse(e, v))
+            harmless++;
+        walk(e);
+    }
+
+    void visit(Statement *)
+    {
+    }
+
+    void visit(ExpStatement *s)
+    {
+        walk(s->exp);
+    }
+
+    void visit(ForwardingStatement *s)
+    {
+        if (s->statement && !stop)
+            walkPostorder(s->statement, this);
+    }
+
+    void visit(WhileStatement *s)
+    {
+        condition(s->condition);
+    }
+
+    void visit(DoStatement *s)
+    {
+        condition(s->condition);
+    }
+
+    void visit(ForStatement *s)
+    {
+        condition(s->condition);
+        walk(s->increment);
+    }
+
+    void visit(ForeachStatement *s)
+    {
+        walk(s->aggr);
+    }
+
+    void visit(ForeachRangeStatement *s)
+    {
+        walk(s->lwr);
+        walk(s->upr);
+    }
+
+    void visit(IfStatement *s)
+    {
+        if (s->match)
+            dw.walkDsymbol(s->match);
+        stop |= dw.stop;
+        condition(s->condition);
+    }
+
+    void visit(PragmaStatement *s)
+    {
+        for (size_t i = 0; s->args && i < s->args->length; i++)
+            walk((*s->args)[i]);
+    }
+
+    void visit(SwitchStatement *s)
+    {
+        walk(s->condition);
+    }
+
+    void visit(CaseStatement *s)
+    {
+        walk(s->exp);
+    }
+
+    void visit(CaseRangeStatement *s)
+    {
+        walk(s->first);
+        walk(s->last);
+    }
+
+    void visit(GotoCaseStatement *s)
+    {
+        walk(s->exp);
+    }
+
+    void visit(ReturnStatement *s)
+    {
+        if (!s->exp || !v)
+            walk(s->exp);
+        else if (refReturn && refersToField(s->exp, v))
+            stop = true;
+        else
+        {
+            if (ctor && isUse(s->exp, v))
+                harmless++;
+            walk(s->exp);
+        }
+    }
+
+    void visit(WithStatement *s)
+    {
+        walk(s->exp);
+        if (s->wthis)
+            dw.walkDsymbol(s->wthis);
+        stop |= dw.stop;
+    }
+
+    void visit(ThrowStatement *s)
+    {
+        walk(s->exp);
+    }
+
+    void visit(AsmStatement *)
+    {
+        stop = true;
+    }
+};
+
+/* Count the uses of a variable v in a function body, and how many of
+ * them don't let it escape.
+ */
+class EscapeWalker : public StoppableVisitor
+{
+public:
+    VarDeclaration *v;
+    ClassDeclaration *cd;       // exact class of the object v refers to, if known
+    int depth;
+    size_t uses;
+    size_t harmless;
+
+    EscapeWalker(VarDeclaration *v, ClassDeclaration *cd, int depth)
+        : v(v), cd(cd), depth(depth), uses(0), harmless(0)
+    {
+    }
+
+    /* Does calling method m on v let v escape?
+     */
+    bool thisEscapes(FuncDeclaration *m, bool direct)
+    {
+        FuncDeclaration *f = m;
+        if (!direct && m->isVirtual())
+        {
+            if (cd && m->vtblIndex >= 0 && (size_t)m->vtblIndex < cd->vtbl.length)
+                f = cd->vtbl[m->vtblIndex]->isFuncDeclaration();
+            else if (!m->isFinalFunc())
+                return true;    // don't know which override is called
+        }
+        if (!f)
+            return true;
+        if (!f->needThis())
+            return false;
+        return valueEscapes(f, f->vthis, cd, depth + 1);
+    }
+
+    void visit(Expression *e)
+    {
+        if (isUse(e, v))
+            uses++;
+    }
+
+    void visit(AssignExp *e)
+    {
+        if (isUse(e->e1, v))
+            harmless++;         // overwriting v
+    }
+
+    void visit(IdentityExp *e)
+    {
+        if (isUse(skipCasts(e->e1), v))
+            harmless++;
+        if (isUse(skipCasts(e->e2), v))
+            harmless++;
+    }
+
+    void visit(LogicalExp *e)
+    {
+        if (isUse(e->e1, v))
+            harmless++;
+        if (isUse(e->e2, v))
+            harmless++;
+    }
+
+    void visit(NotExp *e)
+    {
+        if (isUse(e->e1, v))
+            harmless++;
+    }
+
+    void visit(CastExp *e)
+    {
+        if (isUse(e->e1, v) && e->to->toBasetype()->ty == Tbool)
+            harmless++;
+    }
+
+    void visit(CondExp *e)
+    {
+        if (isUse(e->econd, v))
+            harmless++;
+    }
+
+    void visit(AddrExp *e)
+    {
+        if (isUse(e->e1, v) || refersToField(e->e1, v))
+            stop = true;
+    }
+
+    void visit(SymOffExp *e)
+    {
+        if (e->var == v)
+            stop = true;        // &v, which can be dereferenced anywhere
+    }
+
+    void visit(DotVarExp *e)
+    {
+        if (!isUse(e->e1, v))
+            return;
+        VarDeclaration *field = e->var->isVarDeclaration();
+        if (!field)
+            return;             // a method, accounted for by its call
+        if (!field->isField())
+        {
+            harmless++;
+            return;
+        }
+        /* Members of struct and static array fields could have their
+         * address taken without an AddrExp, so leave them out.
+         */
+        Type *tb = field->type->toBasetype();
+        if (tb->ty != Tstruct && tb->ty != Tsarray)
+            harmless++;
+    }
+
+    void visit(DeclarationExp *e)
+    {
+        VarDeclaration *vd = e->declaration->isVarDeclaration();
+        if (vd && vd->isRef() && vd->_init)
+        {
+            ExpInitializer *ie = vd->_init->isExpInitializer();
+            if (ie && refersToField(ie->exp, v))
+                stop = true;
+        }
+    }
+
+    void visit(CallExp *e)
+    {
+        if (isUse(e->e1, v))
+        {
+            if (v->type->toBasetype()->ty == Tdelegate)
+                harmless++;     // calling it
+        }
+        else if (e->e1->op == TOKdotvar)
+        {
+            DotVarExp *dve = (DotVarExp *)e->e1;
+            FuncDeclaration *m = dve->var->isFuncDeclaration();
+            if (m && isUse(dve->e1, v) &&
+                !thisEscapes(m, e->directcall || dve->e1->op == TOKsuper))
+                harmless++;
+        }
+
+        for (size_t j = 0; e->arguments && j < e->arguments->length; j++)
+        {
+            Expression *arg = (*e->arguments)[j];
+            if (isUse(skipCasts(arg), v))
+            {
+                if (!argumentEscapes(e, j, depth))
+                    harmless++;
+            }
+            else if (refersToField(arg, v))
+            {
+                TypeFunction *tf;
+                Parameter *p = callParameter(e, j, &tf);
+                if (!p || p->storageClass & (STCref | STCout))
+                    stop = true;
+            }
+        }
+    }
+};
+
+/* Functions and variables being looked at, which are assumed not to
+ * escape while their own uses are checked.
+ */
+static FuncDeclaration *inferFuncs[ESCAPE_DEPTH + 1];
+static VarDeclaration *inferVars[ESCAPE_DEPTH + 1];
+static int inferDim;
+
+/* Can variable v of function body fd escape?
+ * cd is the exact class of the object v refers to, if known.
+ */
+static bool bodyEscapes(FuncDeclaration *fd, VarDeclaration *v, ClassDeclaration *cd, int depth)
+{
+    if (v->nestedrefs.length)
+        return true;            // a nested function refers to it
+    if (v->storage_class & (STCref | STCout | STClazy))
+        return true;
+    Type *tb = v->type->toBasetype();
+    if (tb->ty == Tclass)
+    {
+        if (((TypeClass *)tb)->sym->isInterfaceDeclaration())
+            return true;
+    }
+    else if (tb->ty != Tdelegate)
+        return true;
+
+    EscapeWalker ew(v, cd, depth);
+    StatementWalker sw(&ew, v, fd);
+    walkPostorder(fd->fbody, &sw);
+    //printf("bodyEscapes(%s, %s) uses = %d, harmless = %d + %d\n", fd->toChars(), v->toChars(), (int)ew.uses, (int)ew.harmless, (int)sw.harmless);
+    return sw.stop || ew.stop || ew.uses != ew.harmless + sw.harmless;
+}
+
+/* Can parameter or `this` v of function fd escape from it?
+ */
+static bool valueEscapes(FuncDeclaration *fd, VarDeclaration *v, ClassDeclaration *cd, int depth)
+{
+    if (!v || depth > ESCAPE_DEPTH)
+        return true;
+
+    /* A recursive call passes it on to a use that is being checked already
+     */
+    for (int i = 0; i < inferDim; i++)
+    {
+        if (inferFuncs[i] == fd && inferVars[i] == v)
+            return false;
+    }
+
+    if (!fd->fbody || fd->semanticRun < PASSsemantic3done || fd->semantic3Errors || fd->naked)
+        return true;
+
+    inferFuncs[inferDim] = fd;
+    inferVars[inferDim] = v;
+    inferDim++;
+    bool result = bodyEscapes(fd, v, cd, depth);
+    inferDim--;
+    return result;
+}
+
+/* Return the nested function whose address e takes, or nullptr.
+ */
+static FuncDeclaration *addressOfFunction(Expression *e)
+{
+    if (e->op == TOKcast)
+        e = ((CastExp *)e)->e1;
+    if (e->op == TOKfunction)
+        return ((FuncExp *)e)->fd;
+    if (e->op == TOKdelegate)
+    {
+        DelegateExp *de = (DelegateExp *)e;
+        if (de->e1->op == TOKvar)
+            return ((VarExp *)de->e1)->var->isFuncDeclaration();
+    }
+    return nullptr;
+}
+
+/* Find the delegates and `new` expressions in the body of fd that
+ * don't escape.
+ */
+class StackAllocator : public StoppableVisitor
+{
+public:
+    FuncDeclaration *fd;
+    Expressions seen;           // delegates already accounted for
+
+    StackAllocator(FuncDeclaration *fd) : fd(fd) {}
+
+    /* The address of f taken by e doesn't escape.
+     */
+    void noEscape(FuncDeclaration *f, Expression *e)
+    {
+        if (!f->tookAddressOf)
+            return;
+        if (e->op == TOKcast)
+            e = ((CastExp *)e)->e1;
+        if (e->op == TOKfunction)
+        {
+            // Function literals appear only once
+            f->tookAddressOf = 0;
+        }
+        else
+        {
+            for (size_t i = 0; i < seen.length; i++)
+            {
+                if (seen[i] == e)
+                    return;
+            }
+            seen.push(e);
+            f->tookAddressOf--;
+        }
+        f->flags |= FUNCFLAGnoEscape;
+    }
+
+    void newOnStack(VarDeclaration *vd, NewExp *ne)
+    {
+        if (ne->onstack || ne->allocator || ne->thisexp || ne->newargs)
+            return;
+        Type *tb = ne->newtype->toBasetype();
+        if (tb->ty != Tclass)
+            return;
+        ClassDeclaration *cd = ((TypeClass *)tb)->sym;
+        if (cd->isInterfaceDeclaration() || cd->isAbstract() || cd->isscope ||
+            cd->sizeok != SIZEOKdone || cd->structsize > STACKNEW_MAX)
+            return;
+        for (ClassDeclaration *c = cd; c; c = c->baseClass)
+        {
+            // Instances on the stack are never finalized
+            if (c->dtor || c->aggNew)
+                return;
+        }
+        if (ne->member && valueEscapes(ne->member, ne->member->vthis, cd, 1))
+            return;
+        if (bodyEscapes(fd, vd, cd, 0))
+            return;
+
+        ne->onstack = true;
+        if (global.params.vescape && !global.gag)
+            message(ne->loc, "vescape: `new %s` is allocated on the stack", cd->toChars());
+    }
+
+    void visit(Expression *)
+    {
+    }
+
+    void visit(CallExp *e)
+    {
+        for (size_t j = 0; e->arguments && j < e->arguments->length; j++)
+        {
+            Expression *arg = (*e->arguments)[j];
+            FuncDeclaration *f = addressOfFunction(arg);
+            if (!f || !f->tookAddressOf)
+                continue;
+            TypeFunction *tf;
+            Parameter *p = callParameter(e, j, &tf);
+            if (p && tf->parameterEscapes(p) && !argumentEscapes(e, j, 0))
+                noEscape(f, arg);
+        }
+    }
+
+    void visit(DeclarationExp *e)
+    {
+        VarDeclaration *vd = e->declaration->isVarDeclaration();
+        if (!vd || vd->isDataseg() || !vd->_init)
+            return;
+        ExpInitializer *ie = vd->_init->isExpInitializer();
+        if (!ie || (ie->exp->op != TOKconstruct && ie->exp->op != TOKblit))
+            return;
+        AssignExp *ae = (AssignExp *)ie->exp;
+        if (!isUse(ae->e1, vd))
+            return;
+        Expression *ei = ae->e2;
+        if (ei->op == TOKcast && ((CastExp *)ei)->e1->op == TOKnew)
+            ei = ((CastExp *)ei)->e1;
+        if (ei->op == TOKnew)
+            newOnStack(vd, (NewExp *)ei);
+        else if (FuncDeclaration *f = addressOfFunction(ei))
+        {
+            if (f->tookAddressOf && !bodyEscapes(fd, vd, nullptr, 0))
+                noEscape(f, ei);
+        }
+    }
+};
+
+/*********************************************
+ * After semantic3 of fd, put the closures of the delegates created in it
+ * and the class instances it creates with `new` on the stack if they
+ * can't escape from it.
+ * With -vescape, list what was put on the stack.
+ */
+void inferStackAllocations(FuncDeclaration *fd)
+{
+    if (!fd->fbody)
+        return;
+
+    StackAllocator sa(fd);
+    StatementWalker sw(&sa, nullptr, fd);
+    walkPostorder(fd->fbody, &sw);
+
+    if (!global.params.vescape || global.gag || !fd->closureVars.length || fd->needsClosure())
+        return;
+
+    /* Report the closure if any of the delegates that refer to it
+     * was found not to escape.
+     */
+    for (size_t i = 0; i < fd->closureVars.length; i++)
+    {
+        VarDeclaration *v = fd->closureVars[i];
+        for (size_t j = 0; j < v->nestedrefs.length; j++)
+        {
+            for (Dsymbol *s = v->nestedrefs[j]; s && s != fd; s = s->parent)
+            {
+                FuncDeclaration *fx = s->isFuncDeclaration();
+                if (fx && fx->flags & FUNCFLAGnoEscape)
+                {
+                    message(fd->loc, "vescape: closure of `%s` is allocated on the stack", fd->toPrettyChars());
+                    return;
+                }
+            }
+        }
+    }
+}
@@ -9,6 +9,7 @@
 
 #include "root/dsystem.hpp"
 #include "root/rmem.hpp"
+#include "root/hash.hpp"
 #include "root/root.hpp"
 
 #include "mars.hpp"
@@ -1289,6 +1290,34 @@ static Expression *rewriteOpAssign(BinExp *exp)
     return e;
 }
 
+/****************************************
+ * Integer vectors are divided by multiplying with a factor worked out
+ * from the divisor, so exp->e2 has to be a nonzero constant that is the
+ * same in every element. It is left folded for the glue layer.
+ * Returns:
+ *      true    an error was issued
+ */
+
+static bool checkVectorDivisor(BinExp *exp)
+{
+    Type *tb = exp->e1->type->toBasetype();
+    if (tb->ty != Tvector || !tb->isintegral())
+        return false;
+    Expression *e2 = exp->e2->optimize(WANTvalue);
+    if (e2->op == TOKvector)
+    {
+        Expression *ex = ((VectorExp *)e2)->e1;
+        d_uns64 sz = ((TypeVector *)tb)->elementType()->size(Loc());
+        if (ex->op == TOKint64 && (ex->toInteger() & (~0ULL >> (64 - sz * 8))) != 0)
+        {
+            exp->e2 = e2;
+            return false;
+        }
+    }
+    exp->error("`%s` can only be divided by a nonzero constant", tb->toChars());
+    return true;
+}
+
 /****************************************
  * Preprocess arguments to function.
  * Output:
@@ -4275,7 +4304,12 @@ public:
             return;
         }
 
-        if (Expression *ex = typeCombine(exp, sc))
+        if (shift && exp->e1->type->toBasetype()->ty == Tvector &&
+            exp->e2->type->toBasetype()->ty != Tvector)
+        {
+            // a scalar shift count applies to every element, do not broadcast it
+        }
+        else if (Expression *ex = typeCombine(exp, sc))
         {
             result = ex;
             return;
@@ -4296,6 +4330,8 @@ public:
             result = exp->incompatibleTypes();
             return;
         }
+        if ((exp->op == TOKdivass || exp->op == TOKmodass) && checkVectorDivisor(exp))
+            return setError();
 
         if (exp->e1->op == TOKerror || exp->e2->op == TOKerror)
             return setError();
@@ -4373,7 +4409,6 @@ public:
             return setError();
         }
 
-        sc->_module->contentImportedFiles.push(name);
         if (global.params.verbose)
             message("file      %.*s\t(%s)", (int)se->len, (char *)se->string, name);
         if (global.params.moduleDeps != nullptr)
@@ -4406,6 +4441,9 @@ public:
             else
             {
                 f.ref = 1;
+                // Only record files that were read, so the hashes stay in step
+                sc->_module->contentImportedFiles.push(name);
+                sc->_module->contentImportedHashes.push(calcHash64(f.buffer, f.len));
                 se = new StringExp(e->loc, f.buffer, f.len);
             }
         }
@@ -8943,6 +8981,8 @@ public:
             result = exp->incompatibleTypes();
             return;
         }
+        else if (checkVectorDivisor(exp))
+            return setError();
         result = exp;
     }
 
@@ -8988,6 +9028,8 @@ public:
             result = exp->incompatibleTypes();
             return;
         }
+        if (checkVectorDivisor(exp))
+            return setError();
 
         if (exp->checkArithmeticBin())
             return setError();
@@ -9690,6 +9732,10 @@ public:
             return setError();
         }
 
+        // Vectors compare element by element, giving a mask
+        if (t1->ty == Tvector)
+            exp->type = ((TypeVector *)t1)->toBooleanVector();
+
         //printf("CmpExp: %s, type = %s\n", e->toChars(), e->type->toChars());
         result = exp;
     }
@@ -9786,6 +9832,8 @@ public:
             result = exp->incompatibleTypes();
             return;
         }
+        if (t1->ty == Tvector)
+            exp->type = ((TypeVector *)t1)->toBooleanVector();
 
         result = exp;
     }
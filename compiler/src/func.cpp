@@ -128,6 +128,7 @@ FuncDeclaration::FuncDeclaration(Loc loc, Loc endloc, Identifier *id, StorageCla
      * nullptr for the return type.
      */
     inferRetType = (type && type->nextOf() == nullptr);
+    lazySemantic = false;
     storage_class2 = 0;
     hasReturnExp = 0;
     nrvo_can = 1;
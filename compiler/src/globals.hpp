@@ -84,12 +84,14 @@ struct Param
     bool showColumns;   // print character (column) numbers in diagnostics
     bool vtls;          // identify thread local variables
     char vgc;           // identify gc usage
+    bool vescape;       // identify allocations put on the stack
     bool vfield;        // identify non-mutable field variables
     bool vcomplex = true;      // identify complex/imaginary type usage
     char symdebug;      // insert debug symbolic information
     bool symdebugref;   // insert debug information for all referenced types, too
     bool alwaysframe;   // always emit standard stack frame
     bool optimize;      // run optimizer
+    int unroll = -1;    // unroll loops of up to this many iterations, -1 for default
     bool map;           // generate linker .map file
     bool is64bit = (sizeof(size_t) == 8);       // generate 64 bit code
     bool isLP64;        // generate code for LP64
@@ -98,6 +100,7 @@ struct Param
     bool stackstomp;    // add stack stomping code
     bool useUnitTests;  // generate unittest code
     bool useInline = false;     // inline expand functions
+    bool lazySemantic;  // only analyse imported functions that are used
     bool useDIP25;      // implement http://wiki.dlang.org/DIP25
     bool release;       // build release version
     bool preservePaths; // true means don't strip path from source file
@@ -119,7 +122,7 @@ struct Param
     unsigned cplusplus = CppStdRevisionCpp17;     // version of C++ name mangling to support
     bool showGaggedErrors;  // print gagged errors anyway
 
-    CPU cpu;                // CPU instruction set to target
+    CPU cpu = baseline;     // CPU instruction set to target
 
     CHECKENABLE useInvariants = CHECKENABLEdefault;     // generate class invariant checks
     CHECKENABLE useIn = CHECKENABLEdefault;             // generate precondition checks
@@ -150,10 +153,13 @@ struct Param
     DString hdrdir;        // write 'header' file to docdir directory
     DString hdrname;       // write 'header' file to docname
     bool hdrStripPlainFunctions; // strip the bodies of plain (non-template) functions
+    bool hdrOnly;          // only parse and write 'header' files, no semantic analysis
 
     bool doJsonGeneration;    // write JSON file
     DString jsonfilename;     // write JSON file to jsonfilename
 
+    unsigned jobs = 1;        // number of threads used to generate output files
+
     Strings *debugids;     // debug identifiers
 
     Strings *versionids;   // version identifiers
@@ -165,6 +171,12 @@ struct Param
     DString moduleDepsFile;     // filename for deps output
     OutBuffer *moduleDeps;      // contents to be written to deps file
 
+    bool profileEdges;          // count branches taken, for -profile-use
+    DString profileUse;         // profile of a previous run to optimize for
+
+    bool makeDeps;              // write a Makefile style dependency file
+    DString makeDepsFile;       // filename for it, default is the object file name with .dep
+
     // Hidden debug switches
     bool debugb;
     bool debugc;
@@ -46,6 +46,7 @@ void Statement_toIR(Statement *s, IRState *irs);
 void insertFinallyBlockCalls(block *startblock);
 elem *toEfilename(Module *m);
 Symbol *toSymbol(Dsymbol *s);
+FuncDeclaration *toFuncDeclaration(Symbol *s);
 void buildClosure(FuncDeclaration *fd, IRState *irs);
 Symbol *toStringSymbol(const char *str, size_t len, size_t pad);
 
@@ -123,6 +124,8 @@ void obj_write_deferred(Library *library)
             //  so output it into it's own object file without ModuleInfo
             objmod->initfile(idbuf.peekChars(), nullptr, mname);
             toObjFile(s, false);
+            profile_term();
+            inline_term();
             objmod->termfile();
         }
         else
@@ -291,6 +294,9 @@ void genObjFile(Module *m, bool multiobj)
     {
         bool v = global.params.verbose;
         global.params.verbose = false;
+        // The C main() comes after the branch counters are written out
+        unsigned flags4 = config.flags4;
+        config.flags4 &= ~CFG4profgen;
 
         for (size_t i = 0; i < m->members->length; i++)
         {
@@ -299,6 +305,7 @@ void genObjFile(Module *m, bool multiobj)
             toObjFile(member, global.params.multiobj);
         }
 
+        config.flags4 = flags4;
         global.params.verbose = v;
         return;
     }
@@ -449,6 +456,8 @@ void genObjFile(Module *m, bool multiobj)
 
     if (m->doppelganger)
     {
+        profile_term();
+        inline_term();
         objmod->termfile();
         return;
     }
@@ -460,6 +469,8 @@ void genObjFile(Module *m, bool multiobj)
     if (global.params.useModuleInfo && Module::moduleinfo /*|| needModuleInfo()*/)
         genModuleInfo(m);
 
+    profile_term();                     // branch counters of -profile=edges
+    inline_term();                      // forget what can't be inlined in the next object file
     objmod->termfile();
 }
 
@@ -665,6 +676,49 @@ UnitTestDeclaration *needsDeferredNested(FuncDeclaration *fd)
     return nullptr;
 }
 
+/***************************************
+ * Generate code for the functions of module m that e calls directly,
+ * if it isn't done yet, so the backend inliner has them to expand in e.
+ */
+
+static void genCallees(elem *e, Module *m)
+{
+    while (EOP(e))
+    {
+        switch (e->Eoper)
+        {
+            case OPcall:
+            case OPucall:
+            case OPcallns:
+            case OPucallns:
+                if (e->E1->Eoper == OPvar)
+                {
+                    FuncDeclaration *fd = toFuncDeclaration(e->E1->EV.sp.Vsym);
+
+                    // Only ones declared at module level or in its aggregates,
+                    // not ones that need the context of an enclosing function
+                    Dsymbol *p = fd ? fd->toParent2() : nullptr;
+                    while (p && !p->isFuncDeclaration() && !p->isModule())
+                        p = p->toParent2();
+
+                    if (p == m && fd->semanticRun == PASSsemantic3done &&
+                        !fd->isInstantiated() &&
+                        !fd->isUnitTestDeclaration() &&
+                        !fd->isStaticCtorDeclaration() && !fd->isStaticDtorDeclaration())
+                    {
+                        symbol *localgotsave = localgot;
+                        toObjFile(fd, false);
+                        localgot = localgotsave;
+                    }
+                }
+                break;
+        }
+        if (EBIN(e))
+            genCallees(e->E2, m);
+        e = e->E1;
+    }
+}
+
 void FuncDeclaration_toObjFile(FuncDeclaration *fd, bool multiobj)
 {
     ClassDeclaration *cd = fd->parent->isClassDeclaration();
@@ -1142,6 +1196,25 @@ void FuncDeclaration_toObjFile(FuncDeclaration *fd, bool multiobj)
         return;
     }
 
+    if (global.params.useInline && !global.params.multiobj &&
+        (global.params.is64bit || !global.params.pic))
+    {
+        /* Have the backend inliner expand calls in it to functions generated
+         * before it, generating the ones of this module first.
+         * Keep it for later functions if it may be small enough.
+         */
+        f->Fflags3 |= Fdoinline;
+        for (block *b = f->Fstartblock; b; b = b->Bnext)
+        {
+            if (b->Belem)
+                genCallees(b->Belem, m);
+        }
+        if (!fd->isNested() && !fd->needsClosure() && !fd->v_arguments && !fd->v_argptr &&
+            !fd->naked && retmethod != RETstack && fd->inlining != PINLINEnever &&
+            !fd->isMain() && !ud && !fd->isStaticCtorDeclaration() && !fd->isStaticDtorDeclaration())
+            f->Fflags |= Finline;
+    }
+
     writefunc(s);
     // Restore symbol table
     cstate.CSpsymtab = symtabsave;
@@ -1278,19 +1351,20 @@ unsigned totym(Type *tx)
         {
             TypeVector *tv = (TypeVector *)tx;
             TypeBasic *tb = tv->elementType();
+            const bool ymm = tv->size(Loc()) == 32;
             switch (tb->ty)
             {
                 case Tvoid:
-                case Tint8:     t = TYschar16;  break;
-                case Tuns8:     t = TYuchar16;  break;
-                case Tint16:    t = TYshort8;   break;
-                case Tuns16:    t = TYushort8;  break;
-                case Tint32:    t = TYlong4;    break;
-                case Tuns32:    t = TYulong4;   break;
-                case Tint64:    t = TYllong2;   break;
-                case Tuns64:    t = TYullong2;  break;
-                case Tfloat32:  t = TYfloat4;   break;
-                case Tfloat64:  t = TYdouble2;  break;
+                case Tint8:     t = ymm ? TYschar32  : TYschar16;  break;
+                case Tuns8:     t = ymm ? TYuchar32  : TYuchar16;  break;
+                case Tint16:    t = ymm ? TYshort16  : TYshort8;   break;
+                case Tuns16:    t = ymm ? TYushort16 : TYushort8;  break;
+                case Tint32:    t = ymm ? TYlong8    : TYlong4;    break;
+                case Tuns32:    t = ymm ? TYulong8   : TYulong4;   break;
+                case Tint64:    t = ymm ? TYllong4   : TYllong2;   break;
+                case Tuns64:    t = ymm ? TYullong4  : TYullong2;  break;
+                case Tfloat32:  t = ymm ? TYfloat8   : TYfloat4;   break;
+                case Tfloat64:  t = ymm ? TYdouble4  : TYdouble2;  break;
                 default:
                     assert(0);
                     break;
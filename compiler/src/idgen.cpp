@@ -381,6 +381,7 @@ Msgtable msgtable[] =
     { "volatileLoad"},
     { "volatileStore"},
     { "_popcnt"},
+    { "popcnt"},
     { "inp"},
     { "inpl"},
     { "inpw"},
@@ -17,6 +17,7 @@ class Dsymbol;
 class Identifier;
 struct Symbol;
 class FuncDeclaration;
+class VarDeclaration;
 struct Blockx;
 struct elem;
 struct Label;
@@ -45,6 +46,9 @@ struct IRState
     block *defaultBlock;
     block *finallyBlock;
 
+    VarDeclaration *appendVar;  // array appended to by the enclosing loop
+    Symbol *appendCap;          // capacity of appendVar[] cached by that loop
+
     IRState(IRState *irs, Statement *s)
     {
         prev = irs;
@@ -68,6 +72,8 @@ struct IRState
             deferToObj = irs->deferToObj;
             varsInScope = irs->varsInScope;
             labels = irs->labels;
+            appendVar = irs->appendVar;
+            appendCap = irs->appendCap;
         }
         else
         {
@@ -79,6 +85,8 @@ struct IRState
             deferToObj = nullptr;
             varsInScope = nullptr;
             labels = nullptr;
+            appendVar = nullptr;
+            appendCap = nullptr;
         }
     }
 
@@ -105,6 +113,8 @@ struct IRState
             deferToObj = irs->deferToObj;
             varsInScope = irs->varsInScope;
             labels = irs->labels;
+            appendVar = irs->appendVar;
+            appendCap = irs->appendCap;
         }
         else
         {
@@ -116,6 +126,8 @@ struct IRState
             deferToObj = nullptr;
             varsInScope = nullptr;
             labels = nullptr;
+            appendVar = nullptr;
+            appendCap = nullptr;
         }
     }
 
@@ -140,6 +152,8 @@ struct IRState
         startaddress = nullptr;
         varsInScope = nullptr;
         labels = nullptr;
+        appendVar = nullptr;
+        appendCap = nullptr;
     }
 
     Label **lookupLabel(Statement *s);
@@ -883,3 +883,19 @@ void json_generate(OutBuffer *buf, Modules *modules)
     json.arrayEnd();
     json.removeComma();
 }
+
+/***********************************
+ * Generate the JSON object for a single module, formatted exactly as it
+ * appears as an element of the array written by json_generate(buf, modules),
+ * including the trailing ",\n". The result only depends on m, so fragments
+ * for different modules can be generated concurrently.
+ */
+void json_generate(OutBuffer *buf, Module *m)
+{
+    ToJsonVisitor json(buf);
+
+    // Pretend we're just past the "[\n" that opens the module array
+    json.indentLevel = 1;
+    buf->writeByte(' ');
+    m->accept(&json);
+}
@@ -13,5 +13,7 @@
 #include "arraytypes.hpp"
 
 struct OutBuffer;
+class Module;
 
 void json_generate(OutBuffer *, Modules *);
+void json_generate(OutBuffer *, Module *);
@@ -12,7 +12,9 @@
 
 #include "root/dsystem.hpp"
 #include "root/port.hpp"
+#include "root/array.hpp"
 
+struct MacroUse;
 
 struct Macro
 {
@@ -27,6 +29,15 @@ struct Macro
 
     int inuse;                  // macro is in use (don't expand)
 
+    const utf8_t *memo;         // expansion of $(NAME) with no arguments, once known
+    size_t memolen;             // length of memo
+    MacroUse *deps;             // macro names looked up while computing memo
+    size_t ndeps;
+
+    bool memoValid();
+    bool memoShared(Macro *table);
+    void memoize(const utf8_t *p, size_t len, size_t depstart);
+
     Macro(const utf8_t *name, size_t namelen, const utf8_t *text, size_t textlen);
     Macro *search(const utf8_t *name, size_t namelen);
 
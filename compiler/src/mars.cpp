@@ -16,6 +16,9 @@
 #include <string.h>
 
 #include <errno.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
 
 #include "root/rmem.hpp"
 #include "root/root.hpp"
@@ -23,6 +26,7 @@
 #include "root/file.hpp"
 #include "root/filename.hpp"
 #include "root/stringtable.hpp"
+#include "root/threadpool.hpp"
 
 #include "mars.hpp"
 #include "module.hpp"
@@ -47,6 +51,7 @@ void printCtfePerformanceStats();
 
 static const char* parse_arch_arg(Strings *args, const char* arch);
 static const char* parse_conf_arg(Strings *args);
+static CPU nativeCPU();
 
 void inlineScan(Module *m);
 
@@ -117,17 +122,24 @@ Usage:\n\
   -H             generate 'header' file\n\
   -Hddirectory   write 'header' file to directory\n\
   -Hffilename    write 'header' file to filename\n\
+  -Honly         only parse and write 'header' files (no semantic or code)\n\
   --help         print help and exit\n\
   -Ipath         where to look for imports\n\
   -ignore        ignore unsupported pragmas\n\
   -inline        do function inlining\n\
+  -j[=nnn]       generate output files on nnn threads (default: all cores)\n\
   -Jpath         where to look for string imports\n\
   -Llinkerflag   pass linkerflag to link\n\
+  -lazy          only run semantic on imported functions that are used\n\
   -lib           generate library rather than object files\n\
   -m32           generate 32 bit code\n\
   -m64           generate 64 bit code\n\
   -main          add default main() (e.g. for unittesting)\n\
   -map           generate linker .map file\n\
+  -mcpu=<id>     generate instructions for architecture identified by 'id'\n\
+  -mcpu=?        list all architecture options\n\
+  -MD            write Makefile dependencies, with content hashes, to obj.dep\n\
+  -MFfilename    write Makefile dependencies to filename\n\
   -noboundscheck no array bounds checking (deprecated, use -boundscheck=off)\n\
   -O             optimize\n\
   -o-            do not write object file\n\
@@ -135,6 +147,9 @@ Usage:\n\
   -offilename    name output file to filename\n\
   -op            preserve source path for output files\n\
   -profile       profile runtime performance of generated code\n\
+  -profile=edges count branches taken, writing them to trace.cnt\n\
+  -profile-use=filename  with -O, optimize for the trace.log of a -profile run,\n\
+                 or the trace.cnt of a -profile=edges run\n\
   -property      enforce property syntax\n\
   -release       compile release version\n\
   -run srcfile args...   run resulting program, passing args\n\
@@ -142,9 +157,11 @@ Usage:\n\
   -transition=id show additional info about language change identified by 'id'\n\
   -transition=?  list all language changes\n\
   -unittest      compile in unit tests\n\
+  -unroll=nnn    with -O, unroll loops of up to nnn iterations (0 disables)\n\
   -v             verbose\n\
   -vcolumns      print character (column) numbers in diagnostics\n\
   -verrors=num   limit the number of error messages (0 means unlimited)\n\
+  -vescape       list all closures and objects allocated on the stack\n\
   -vgc           list all gc allocations including hidden ones\n\
   -vtls          list all variables going into thread local storage\n\
   --version      print compiler version and exit\n\
@@ -169,6 +186,270 @@ void addDefaultVersions()
     VersionCondition::addPredefinedGlobalIdent("all");
 }
 
+struct OutputJobs
+{
+    Modules *modules;
+    size_t first;               // index of the first module of this batch
+    OutBuffer *bufs;            // one output buffer per module in the batch
+};
+
+static void jsonJob(void *ctx, size_t i)
+{
+    OutputJobs *jj = (OutputJobs *)ctx;
+    json_generate(&jj->bufs[i], (*jj->modules)[jj->first + i]);
+}
+
+/**************************************
+ * Write the JSON description of modules[] to the -Xf file (or stdout).
+ * The document is streamed: module fragments are generated in batches,
+ * one worker thread per module, and each batch is written out in module
+ * order before the next is started. Memory use is bounded by the batch
+ * size rather than by the size of the whole document.
+ */
+static void generateJson(Modules *modules)
+{
+    const char *name = global.params.jsonfilename.ptr;
+    const char *jsonfilename = nullptr;
+    FILE *fp;
+
+    if (name && name[0] == '-' && name[1] == 0)
+    {   // Write to stdout; assume it succeeds
+        fp = stdout;
+    }
+    else
+    {
+        /* The filename generation code here should be harmonized with Module::setOutfile()
+         */
+        if (name && *name)
+        {
+            jsonfilename = FileName::defaultExt(name, global.json_ext.ptr);
+        }
+        else
+        {
+            // Generate json file name from first obj name
+            const char *n = global.params.objfiles[0];
+            n = FileName::name(n);
+
+            //if (!FileName::absolute(name))
+                //name = FileName::combine(dir, name);
+
+            jsonfilename = FileName::forceExt(n, global.json_ext.ptr);
+        }
+
+        ensurePathToNameExists(Loc(), jsonfilename);
+
+        fp = fopen(jsonfilename, "wb");
+        if (!fp)
+        {
+            error(Loc(), "Error writing file '%s'", jsonfilename);
+            fatal();
+        }
+    }
+
+    const unsigned nthreads = global.params.jobs;
+    const size_t batch = nthreads * 2;
+    OutBuffer *bufs = new OutBuffer[batch];
+    OutputJobs jj;
+    jj.modules = modules;
+    jj.bufs = bufs;
+
+    bool ok = true;
+    if (modules->length == 0)
+        ok = fputs("[]", fp) >= 0;
+    else
+        ok = fputs("[\n", fp) >= 0;
+
+    for (size_t first = 0; ok && first < modules->length; first += batch)
+    {
+        size_t n = modules->length - first;
+        if (n > batch)
+            n = batch;
+        for (size_t i = 0; i < n; i++)
+        {
+            bufs[i].reset();
+            if (global.params.verbose)
+                message("json gen %s", (*modules)[first + i]->toChars());
+        }
+        jj.first = first;
+        ThreadPool::run(n, nthreads, &jsonJob, &jj);
+
+        for (size_t i = 0; ok && i < n; i++)
+        {
+            OutBuffer *buf = &bufs[i];
+            size_t len = buf->length();
+            const bool last = first + i + 1 == modules->length;
+            if (last)
+            {   // Replace the trailing ",\n" with the close of the array
+                assert(len >= 2);
+                len -= 2;
+            }
+            ok = fwrite(buf->slice().ptr, 1, len, fp) == len;
+            if (ok && last)
+                ok = fputs("\n]", fp) >= 0;
+        }
+    }
+
+    delete[] bufs;
+
+    if (fp != stdout && fclose(fp) != 0)
+        ok = false;
+    if (!ok && jsonfilename)
+    {
+        ::remove(jsonfilename);
+        error(Loc(), "Error writing file '%s'", jsonfilename);
+        fatal();
+    }
+}
+
+static void hdrJob(void *ctx, size_t i)
+{
+    OutputJobs *jj = (OutputJobs *)ctx;
+    genhdrfile((*jj->modules)[jj->first + i]);
+}
+
+static void docJob(void *ctx, size_t i)
+{
+    OutputJobs *jj = (OutputJobs *)ctx;
+    gendocexpand((*jj->modules)[jj->first + i]);
+}
+
+/**************************************
+ * Write the documentation files for modules[]. The AST walk that builds
+ * each module's BODY runs on this thread; the macro expansion, which is
+ * where the time goes, runs on the worker threads one module each.
+ */
+static void generateDocs(Modules *modules)
+{
+    const unsigned nthreads = global.params.jobs;
+    const size_t batch = nthreads * 2;
+    OutputJobs jj;
+    jj.modules = modules;
+    jj.bufs = nullptr;
+
+    for (size_t first = 0; first < modules->length; first += batch)
+    {
+        size_t n = modules->length - first;
+        if (n > batch)
+            n = batch;
+        for (size_t i = 0; i < n; i++)
+            gendocbody((*modules)[first + i]);
+        jj.first = first;
+        ThreadPool::run(n, nthreads, &docJob, &jj);
+    }
+}
+
+/**************************************
+ * Write fname to buf, escaped for use in a Makefile rule.
+ */
+static void writeMakeName(OutBuffer *buf, const char *fname)
+{
+    for (; *fname; fname++)
+    {
+        switch (*fname)
+        {
+            case ' ':
+            case '\t':
+            case '#':
+                buf->writeByte('\\');
+                break;
+
+            case '$':
+                buf->writeByte('$');
+                break;
+        }
+        buf->writeByte(*fname);
+    }
+}
+
+/**************************************
+ * Write a Makefile style dependency file for the files generated from
+ * modules[], the root modules, listing every module that was loaded and
+ * every file whose content was imported.
+ * It is followed by a comment block with the 64 bit FNV-1a hash of each
+ * dependency as it was read, so build tools can skip rebuilds when a
+ * dependency was touched but not changed:
+ *      # hash 0123456789abcdef path/to/dep.d
+ * All imports are known once semantic analysis is done, which is when
+ * this is called; it doesn't wait for code generation.
+ */
+static void writeMakeDeps(Modules *modules)
+{
+    if (!modules->length)
+        return;
+
+    /* The targets are the files this compile writes: the library, the
+     * single object file, or one object file per root module. Object
+     * files given on the command line are inputs, not targets.
+     */
+    Strings targets;
+    if (global.params.lib)
+    {
+        // Same as the default in Library::setFilename()
+        const char *n = global.params.libname.ptr;
+        if (!n || !*n)
+            n = FileName::forceExt(FileName::name((*modules)[0]->objfile->toChars()), global.lib_ext.ptr);
+        if (!FileName::absolute(n))
+            n = FileName::combine(global.params.objdir.ptr, n);
+        targets.push(FileName::defaultExt(n, global.lib_ext.ptr));
+    }
+    else if (global.params.oneobj)
+        targets.push((*modules)[0]->objfile->toChars());
+    else
+    {
+        for (size_t i = 0; i < modules->length; i++)
+            targets.push((*modules)[i]->objfile->toChars());
+    }
+
+    OutBuffer buf;
+    OutBuffer hashes;
+    StringTable seen;
+    seen._init();
+
+    for (size_t i = 0; i < targets.length; i++)
+    {
+        if (i)
+            buf.writeByte(' ');
+        writeMakeName(&buf, targets[i]);
+    }
+    buf.writeByte(':');
+
+    for (size_t i = 0; i < Module::amodules.length; i++)
+    {
+        Module *m = Module::amodules[i];
+        const char *name = m->srcfile->toChars();
+        if (m->ident == Id::entrypoint || strcmp(name, global.main_d) == 0)
+            continue;
+        if (seen.insert(name, strlen(name), nullptr))
+        {
+            buf.writestring(" \\\n  ");
+            writeMakeName(&buf, name);
+            hashes.printf("# hash %016llx %s\n", (unsigned long long)m->srchash, name);
+        }
+
+        for (size_t j = 0; j < m->contentImportedFiles.length; j++)
+        {
+            const char *fname = m->contentImportedFiles[j];
+            if (!seen.insert(fname, strlen(fname), nullptr))
+                continue;
+            buf.writestring(" \\\n  ");
+            writeMakeName(&buf, fname);
+            hashes.printf("# hash %016llx %s\n", (unsigned long long)m->contentImportedHashes[j], fname);
+        }
+    }
+    buf.writenl();
+    buf.writenl();
+    buf.write(&hashes);
+
+    const char *name = global.params.makeDepsFile.length
+        ? global.params.makeDepsFile.ptr
+        : FileName::forceExt(targets[0], "dep");
+    ensurePathToNameExists(Loc(), name);
+    File deps(name);
+    deps.setbuffer((void *)buf.slice().ptr, buf.length());
+    deps.ref = 1;
+    writeFile(Loc(), &deps);
+}
+
 int tryMain(size_t argc, const char *argv[])
 {
     Strings files;
@@ -339,6 +620,49 @@ int tryMain(size_t argc, const char *argv[])
             {
                 global.params.is64bit = true;
             }
+            else if (memcmp(p + 1, "mcpu", 4) == 0)
+            {
+                // Parse:
+                //      -mcpu=identifier
+                if (p[5] != '=')
+                    goto Lerror;
+                if (strcmp(p + 6, "?") == 0)
+                {
+                    printf("\
+CPU architectures supported by -mcpu=id:\n\
+  =?             list information on all architecture choices\n\
+  =baseline      use default architecture as determined by target\n\
+  =avx           use AVX 1 instructions\n\
+  =avx2          use AVX 2 instructions\n\
+  =native        use CPU architecture that this compiler is running on\n\
+");
+                    return EXIT_FAILURE;
+                }
+                if (strcmp(p + 6, "baseline") == 0)
+                    global.params.cpu = baseline;
+                else if (strcmp(p + 6, "avx") == 0)
+                    global.params.cpu = avx;
+                else if (strcmp(p + 6, "avx2") == 0)
+                    global.params.cpu = avx2;
+                else if (strcmp(p + 6, "native") == 0)
+                    global.params.cpu = native;
+                else
+                    goto Lerror;
+            }
+            else if (memcmp(p + 1, "profile-use=", 12) == 0)
+            {
+                // Parse:
+                //      -profile-use=filename
+                global.params.profileUse = p + 13;
+                if (!global.params.profileUse.ptr[0])
+                    goto Lnoarg;
+            }
+            else if (strcmp(p + 1, "profile=edges") == 0)
+            {
+                // Parse:
+                //      -profile=edges
+                global.params.profileEdges = true;
+            }
             else if (memcmp(p + 1, "profile", 7) == 0)
             {
                 // Parse:
@@ -356,6 +680,8 @@ int tryMain(size_t argc, const char *argv[])
                 global.params.showColumns = true;
             else if (strcmp(p + 1, "vgc") == 0)
                 global.params.vgc = true;
+            else if (strcmp(p + 1, "vescape") == 0)
+                global.params.vescape = true;
             else if (memcmp(p + 1, "verrors", 7) == 0)
             {
                 if (p[8] == '=' && isdigit((utf8_t)p[9]))
@@ -533,6 +859,12 @@ Language changes listed by -transition=id:\n\
                         global.params.hdrname = p + 3;
                         break;
 
+                    case 'o':
+                        if (strcmp(p + 2, "only") != 0)
+                            goto Lerror;
+                        global.params.hdrOnly = true;
+                        break;
+
                     case 0:
                         break;
 
@@ -564,6 +896,25 @@ Language changes listed by -transition=id:\n\
                 global.params.enforcePropertySyntax = true;
             else if (strcmp(p + 1, "inline") == 0)
                 global.params.useInline = true;
+            else if (p[1] == 'j' && (p[2] == 0 || p[2] == '='))
+            {
+                // Parse:
+                //      -j
+                //      -j=nnn
+                if (p[2] == '=')
+                {
+                    if (!isdigit((utf8_t)p[3]))
+                        goto Lerror;
+                    long num;
+                    errno = 0;
+                    num = strtol(p + 3, const_cast<char **>(&p), 10);
+                    if (*p || errno || num < 1 || num > 1024)
+                        goto Lerror;
+                    global.params.jobs = (unsigned) num;
+                }
+                else
+                    global.params.jobs = ThreadPool::processorCount();
+            }
             else if (strcmp(p + 1, "dip25") == 0)
                 global.params.useDIP25 = true;
             else if (strcmp(p + 1, "dip1000") == 0)
@@ -573,6 +924,8 @@ Language changes listed by -transition=id:\n\
             }
             else if (strcmp(p + 1, "lib") == 0)
                 global.params.lib = true;
+            else if (strcmp(p + 1, "lazy") == 0)
+                global.params.lazySemantic = true;
             else if (strcmp(p + 1, "nofloat") == 0)
                 global.params.nofloat = true;
             else if (strcmp(p + 1, "quiet") == 0)
@@ -611,6 +964,19 @@ Language changes listed by -transition=id:\n\
                 else
                     goto Lerror;
             }
+            else if (memcmp(p + 1, "unroll=", 7) == 0)
+            {
+                // Parse:
+                //      -unroll=nnn
+                if (!isdigit((utf8_t)p[8]))
+                    goto Lerror;
+                long num;
+                errno = 0;
+                num = strtol(p + 8, const_cast<char **>(&p), 10);
+                if (*p || errno || num > 64)
+                    goto Lerror;
+                global.params.unroll = (int) num;
+            }
             else if (strcmp(p + 1, "unittest") == 0)
                 global.params.useUnitTests = true;
             else if (p[1] == 'I')
@@ -703,6 +1069,15 @@ Language changes listed by -transition=id:\n\
                 setdebuglib = true;
                 global.params.debuglibname = p + 1 + 9;
             }
+            else if (strcmp(p + 1, "MD") == 0)
+                global.params.makeDeps = true;
+            else if (p[1] == 'M' && p[2] == 'F')
+            {
+                if (!p[3])
+                    goto Lnoarg;
+                global.params.makeDeps = true;
+                global.params.makeDepsFile = p + 3;
+            }
             else if (memcmp(p + 1, "deps", 4) == 0)
             {
                 if(global.params.moduleDeps)
@@ -779,6 +1154,11 @@ Language changes listed by -transition=id:\n\
     // Target uses 64bit pointers.
     global.params.isLP64 = global.params.is64bit;
 
+    if (global.params.cpu == native)
+        global.params.cpu = nativeCPU();
+    else if (global.params.cpu == baseline)
+        global.params.cpu = global.params.is64bit ? sse2 : x87;
+
     if (global.errors)
     {
         fatal();
@@ -857,6 +1237,18 @@ Language changes listed by -transition=id:\n\
         global.params.useExceptions = false;
     }
 
+    if (global.params.hdrOnly)
+    {
+        if (global.params.doDocComments || global.params.doJsonGeneration ||
+            global.params.moduleDeps || global.params.makeDeps ||
+            global.params.run || global.params.lib)
+        {
+            error(Loc(), "-Honly cannot be combined with switches that need semantic analysis");
+            fatal();
+        }
+        global.params.obj = false;
+    }
+
     if (!global.params.obj || global.params.lib)
         global.params.link = false;
 
@@ -927,6 +1319,10 @@ Language changes listed by -transition=id:\n\
         VersionCondition::addPredefinedGlobalIdent("D_InlineAsm_X86_64");
         VersionCondition::addPredefinedGlobalIdent("X86_64");
         VersionCondition::addPredefinedGlobalIdent("D_SIMD");
+        if (global.params.cpu >= avx)
+            VersionCondition::addPredefinedGlobalIdent("D_AVX");
+        if (global.params.cpu >= avx2)
+            VersionCondition::addPredefinedGlobalIdent("D_AVX2");
     }
     else
     {
@@ -1140,10 +1536,16 @@ Language changes listed by -transition=id:\n\
         }
     }
 
-    for (size_t i = 0; i < modules.length; i++)
+    /* When only generating headers, read each file just before it is
+     * parsed so at most one source file is held in memory at a time.
+     */
+    if (!global.params.hdrOnly)
     {
-        Module *m = modules[i];
-        m->read(Loc());
+        for (size_t i = 0; i < modules.length; i++)
+        {
+            Module *m = modules[i];
+            m->read(Loc());
+        }
     }
 
     // Parse files
@@ -1159,6 +1561,8 @@ Language changes listed by -transition=id:\n\
         m->importedFrom = m;    // m->isRoot() == true
         if (!global.params.oneobj || modi == 0 || m->isDocFile)
             m->deleteObjFile();
+        if (global.params.hdrOnly)
+            m->read(Loc());
         m->parse();
         if (m->isDocFile)
         {
@@ -1204,11 +1608,17 @@ Language changes listed by -transition=id:\n\
             Module *m = modules[i];
             if (global.params.verbose)
                 fprintf(global.stdmsg, "import    %s\n", m->toChars());
-            genhdrfile(m);
         }
+        OutputJobs jj;
+        jj.modules = &modules;
+        jj.first = 0;
+        jj.bufs = nullptr;
+        ThreadPool::run(modules.length, global.params.jobs, &hdrJob, &jj);
     }
     if (global.errors)
         fatal();
+    if (global.params.hdrOnly)
+        return EXIT_SUCCESS;
 
     // load all unconditional imports for better symbol resolving
     for (size_t i = 0; i < modules.length; i++)
@@ -1300,6 +1710,13 @@ Language changes listed by -transition=id:\n\
             printf("%.*s", (int)ob->length(), ob->slice().ptr);
     }
 
+    if (global.params.makeDeps)
+        writeMakeDeps(&modules);
+
+    if (global.params.lazySemantic && global.params.verbose)
+        fprintf(global.stdmsg, "lazy      %u of %u imported functions never analysed\n",
+            Module::lazyFuncs - Module::lazyUsed, Module::lazyFuncs);
+
     printCtfePerformanceStats();
 
     Library *library = nullptr;
@@ -1318,59 +1735,10 @@ Language changes listed by -transition=id:\n\
 
     // Generate output files
     if (global.params.doJsonGeneration)
-    {
-        OutBuffer buf;
-        json_generate(&buf, &modules);
-
-        // Write buf to file
-        const char *name = global.params.jsonfilename.ptr;
-
-        if (name && name[0] == '-' && name[1] == 0)
-        {   // Write to stdout; assume it succeeds
-            size_t n = fwrite(buf.slice().ptr, 1, buf.length(), stdout);
-            assert(n == buf.length());        // keep gcc happy about return values
-        }
-        else
-        {
-            /* The filename generation code here should be harmonized with Module::setOutfile()
-             */
-
-            const char *jsonfilename;
-
-            if (name && *name)
-            {
-                jsonfilename = FileName::defaultExt(name, global.json_ext.ptr);
-            }
-            else
-            {
-                // Generate json file name from first obj name
-                const char *n = global.params.objfiles[0];
-                n = FileName::name(n);
-
-                //if (!FileName::absolute(name))
-                    //name = FileName::combine(dir, name);
-
-                jsonfilename = FileName::forceExt(n, global.json_ext.ptr);
-            }
-
-            ensurePathToNameExists(Loc(), jsonfilename);
-
-            File *jsonfile = new File(jsonfilename);
-
-            jsonfile->setbuffer(buf.slice().ptr, buf.length());
-            jsonfile->ref = 1;
-            writeFile(Loc(), jsonfile);
-        }
-    }
+        generateJson(&modules);
 
     if (!global.errors && global.params.doDocComments)
-    {
-        for (size_t i = 0; i < modules.length; i++)
-        {
-            Module *m = modules[i];
-            gendocfile(m);
-        }
-    }
+        generateDocs(&modules);
 
     if (!global.params.obj)
     {
@@ -1545,6 +1913,48 @@ void getenv_setargv(const char *envvalue, Strings *args)
  * to detect the desired architecture.
  */
 
+/***********************************
+ * Determine the instruction set of the machine the compiler runs on,
+ * for -mcpu=native. AVX also needs the OS to save the YMM registers.
+ */
+
+static CPU nativeCPU()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    unsigned a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return x87;
+    unsigned ecx1 = c, edx1 = d;
+
+    bool osymm = false;
+    if (ecx1 & (1 << 27))               // OSXSAVE
+    {
+        unsigned xcr0, xcr0hi;
+        __asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0hi) : "c" (0));
+        osymm = (xcr0 & 6) == 6;        // XMM and YMM state
+    }
+
+    if (osymm && ecx1 & (1 << 28))      // AVX
+    {
+        if (__get_cpuid_max(0, nullptr) >= 7)
+        {
+            __cpuid_count(7, 0, a, b, c, d);
+            if (b & (1 << 5))           // AVX2
+                return avx2;
+        }
+        return avx;
+    }
+    if (ecx1 & (1 << 20)) return sse4_2;
+    if (ecx1 & (1 << 19)) return sse4_1;
+    if (ecx1 & (1 << 9))  return ssse3;
+    if (ecx1 & (1 << 0))  return sse3;
+    if (edx1 & (1 << 26)) return sse2;
+    if (edx1 & (1 << 25)) return sse;
+    if (edx1 & (1 << 23)) return mmx;
+#endif
+    return x87;
+}
+
 static const char* parse_arch_arg(Strings *args, const char* arch)
 {
     for (size_t i = 0; i < args->length; ++i)
@@ -60,6 +60,8 @@ public:
     static Dsymbols deferred2;  // deferred Dsymbol's needing semantic2() run on them
     static Dsymbols deferred3;  // deferred Dsymbol's needing semantic3() run on them
     static unsigned dprogress;  // progress resolving the deferred list
+    static unsigned lazyFuncs;  // imported functions whose semantic() was put off by -lazy
+    static unsigned lazyUsed;   // how many of those were analysed later because they were used
     static void _init();
 
     static AggregateDeclaration *moduleinfo;
@@ -77,6 +79,8 @@ public:
     bool isPackageFile; // if it is a package.d
     Package *pkg;       // if isPackageFile is true, the Package that contains this package.d
     Strings contentImportedFiles;  // array of files whose content was imported
+    Array<uint64_t> contentImportedHashes; // calcHash64 of each of contentImportedFiles
+    uint64_t srchash;   // calcHash64 of the source file as read
     int needmoduleinfo;
 
     int selfimports;            // 0: don't know, 1: does not, 2: does
@@ -46,7 +46,10 @@ void out_config_init(
                         // 1: D
                         // 2: fake it with C symbolic debug info
         bool alwaysframe,       // always create standard function frame
-        bool stackstomp         // add stack stomping code
+        bool stackstomp,        // add stack stomping code
+        int unroll,             // loop unrolling limit, -1 for the default
+        int avx,                // use AVX instructions: 0 none, 1 AVX, 2 AVX2
+        bool profgen            // count branches taken for -profile-use
         );
 
 void out_config_debug(
@@ -79,9 +82,16 @@ void backend_init()
         params->optimize,
         params->symdebug,
         params->alwaysframe,
-        params->stackstomp
+        params->stackstomp,
+        params->unroll,
+        params->cpu >= avx2 ? 2 : params->cpu >= avx ? 1 : 0,
+        params->profileEdges
     );
 
+    if (params->optimize && params->profileUse.length &&
+        !profile_read(params->profileUse.ptr))
+        error(Loc(), "cannot read profile file '%s'", params->profileUse.ptr);
+
 #ifdef DEBUG
     out_config_debug(
         params->debugb,
@@ -3817,6 +3817,29 @@ TypeBasic *TypeVector::elementType()
     return tb;
 }
 
+/***************************************
+ * The type of the result of comparing two vectors of this type: a vector
+ * of signed integers the size of the elements, each all ones where the
+ * comparison is true and zero where it is false.
+ */
+TypeVector *TypeVector::toBooleanVector()
+{
+    Type *tel;
+    switch (elementType()->size(Loc()))
+    {
+        case 1: tel = Type::tint8;  break;
+        case 2: tel = Type::tint16; break;
+        case 4: tel = Type::tint32; break;
+        case 8: tel = Type::tint64; break;
+        default:
+            assert(0);
+            return nullptr;
+    }
+    d_uns64 dim = size(Loc()) / tel->size();
+    TypeVector *tv = new TypeVector(tel->sarrayOf(dim));
+    return (TypeVector *)tv->merge();
+}
+
 bool TypeVector::isBoolean()
 {
     return false;
@@ -460,6 +460,7 @@ public:
     Expression *defaultInit(Loc loc);
     Expression *defaultInitLiteral(Loc loc);
     TypeBasic *elementType();
+    TypeVector *toBooleanVector();
     bool isZeroInit(Loc loc);
 
     void accept(Visitor *v) { v->visit(this); }
@@ -675,7 +675,10 @@ Expression *Expression_optimize(Expression *e, int result, bool keepLvalue)
                 if (e->e2->isConst() == 1)
                 {
                     sinteger_t i2 = e->e2->toInteger();
-                    d_uns64 sz = e->e1->type->size(e->e1->loc);
+                    Type *t1 = e->e1->type->toBasetype();
+                    if (t1->ty == Tvector)
+                        t1 = ((TypeVector *)t1)->elementType();
+                    d_uns64 sz = t1->size(e->e1->loc);
                     assert(sz != SIZE_INVALID);
                     sz *= 8;
                     if (i2 < 0 || (d_uns64)i2 >= sz)
@@ -760,7 +763,10 @@ Expression *Expression_optimize(Expression *e, int result, bool keepLvalue)
             if (e->e2->isConst() == 1)
             {
                 sinteger_t i2 = e->e2->toInteger();
-                d_uns64 sz = e->e1->type->size();
+                Type *t1 = e->e1->type->toBasetype();
+                if (t1->ty == Tvector)
+                    t1 = ((TypeVector *)t1)->elementType();
+                d_uns64 sz = t1->size();
                 assert(sz != SIZE_INVALID);
                 sz *= 8;
                 if (i2 < 0 || (d_uns64)i2 >= sz)
@@ -967,6 +973,9 @@ Expression *Expression_optimize(Expression *e, int result, bool keepLvalue)
             if (binOptimize(e, WANTvalue))
                 return;
 
+            if (e->type->toBasetype()->ty == Tvector)
+                return;                 // a mask, not a bool
+
             Expression *e1 = fromConstInitializer(result, e->e1);
             Expression *e2 = fromConstInitializer(result, e->e2);
             if (e1->op == TOKerror)
@@ -1143,6 +1152,8 @@ Expression *Expression_optimize(Expression *e, int result, bool keepLvalue)
             //printf("CmpExp::optimize() %s\n", e->toChars());
             if (binOptimize(e, WANTvalue))
                 return;
+            if (e->type->toBasetype()->ty == Tvector)
+                return;                 // a mask, not a bool
 
             Expression *e1 = fromConstInitializer(result, e->e1);
             Expression *e2 = fromConstInitializer(result, e->e2);
@@ -260,7 +260,7 @@ ROOT_OBJS = \
 	rmem.o port.o stringtable.o response.o \
 	aav.o speller.o outbuffer.o rootobject.o \
 	filename.o file.o checkedint.o \
-	newdelete.o ctfloat.o
+	newdelete.o ctfloat.o threadpool.o
 
 GLUE_OBJS = \
 	glue.o msc.o s2ir.o todt.o e2ir.o tocsym.o \
@@ -275,7 +275,7 @@ BACK_OBJS = go.o gdag.o gother.o gflow.o gloop.o var.o el.o \
 	cgcod.o cod5.o outbuf.o \
 	bcomplex.o aa.o ti_achar.o \
 	ti_pvoid.o pdata.o backconfig.o \
-	divcoeff.o dwarf.o dwarfeh.o \
+	divcoeff.o dwarf.o dwarfeh.o profile.o inliner.o \
 	ph2.o util2.o eh.o tk.o strtold.o \
 	$(TARGET_OBJS) elfobj.o
 
@@ -319,6 +319,7 @@ ROOT_SRC = $(ROOT)/root.hpp \
 	$(ROOT)/filename.hpp $(ROOT)/filename.cpp \
 	$(ROOT)/file.hpp $(ROOT)/file.cpp \
 	$(ROOT)/ctfloat.hpp $(ROOT)/ctfloat.cpp \
+	$(ROOT)/threadpool.hpp $(ROOT)/threadpool.cpp \
 	$(ROOT)/hash.hpp
 
 GLUE_SRC = glue.cpp msc.cpp s2ir.cpp todt.cpp e2ir.cpp tocsym.cpp \
@@ -337,8 +338,8 @@ BACK_SRC = \
 	$C/cgsched.cpp $C/cod1.cpp $C/cod2.cpp $C/cod3.cpp $C/cod4.cpp $C/cod5.cpp \
 	$C/code.cpp $C/symbol.cpp $C/debug.cpp $C/dt.cpp $C/ee.cpp $C/el.cpp \
 	$C/evalu8.cpp $C/go.cpp $C/gflow.cpp $C/gdag.cpp \
-	$C/gother.cpp $C/glocal.cpp $C/gloop.cpp $C/newman.cpp \
-	$C/os.cpp $C/out.cpp $C/outbuf.cpp $C/ptrntab.cpp $C/rtlsym.cpp \
+	$C/gother.cpp $C/glocal.cpp $C/gloop.cpp $C/inliner.cpp $C/newman.cpp \
+	$C/os.cpp $C/out.cpp $C/outbuf.cpp $C/profile.cpp $C/ptrntab.cpp $C/rtlsym.cpp \
 	$C/type.cpp $C/melf.hpp  $C/bcomplex.hpp \
 	$C/outbuf.hpp $C/token.hpp $C/tassert.hpp \
 	$C/elfobj.cpp $C/dwarf2.hpp $C/exh.hpp $C/go.hpp \
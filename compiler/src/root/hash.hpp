@@ -74,3 +74,16 @@ static inline size_t mixHash(size_t h, size_t k)
 {
     return h ^ (k + 0x9e3779b9 + (h << 6) + (h >> 2));
 }
+
+// 64 bit FNV-1a, for content hashes that are written out and compared
+// across compiler runs
+static inline uint64_t calcHash64(const uint8_t *data, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
@@ -121,11 +121,13 @@ void Mem::error()
 
 /* =================================================== */
 
-/* Allocate, but never release
+/* Allocate, but never release.
+ * Each thread bumps its own chunk so worker threads can allocate AST
+ * strings and buffers without locking.
  */
 
-static size_t heapleft = 0;
-static void *heapp;
+static thread_local size_t heapleft = 0;
+static thread_local void *heapp;
 
 extern "C" void *allocmemory(size_t m_size)
 {
@@ -0,0 +1,75 @@
+/* Copyright (C) 2021 by The D Language Foundation, All Rights Reserved
+ * http://www.digitalmars.com
+ * Distributed under the Boost Software License, Version 1.0.
+ * http://www.boost.org/LICENSE_1_0.txt
+ */
+
+#include "dsystem.hpp"
+#include "threadpool.hpp"
+
+#include <pthread.h>
+
+struct PoolState
+{
+    size_t n;                   // number of jobs
+    size_t next;                // next job to hand out, updated atomically
+    ThreadPool::fp_job_t fp;
+    void *ctx;
+};
+
+static void *worker(void *arg)
+{
+    PoolState *ps = (PoolState *)arg;
+    while (1)
+    {
+        size_t i = __atomic_fetch_add(&ps->next, 1, __ATOMIC_RELAXED);
+        if (i >= ps->n)
+            break;
+        ps->fp(ps->ctx, i);
+    }
+    return nullptr;
+}
+
+bool ThreadPool::concurrent = false;
+
+unsigned ThreadPool::processorCount()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+}
+
+void ThreadPool::run(size_t n, unsigned nthreads, fp_job_t fp, void *ctx)
+{
+    if (nthreads > n)
+        nthreads = (unsigned)n;
+    if (nthreads <= 1)
+    {
+        for (size_t i = 0; i < n; i++)
+            fp(ctx, i);
+        return;
+    }
+
+    PoolState ps;
+    ps.n = n;
+    ps.next = 0;
+    ps.fp = fp;
+    ps.ctx = ctx;
+
+    // Set before any thread is started, cleared once all have been joined;
+    // pthread_create and pthread_join order it with the workers' reads
+    concurrent = true;
+
+    // The calling thread is the first worker
+    pthread_t *threads = (pthread_t *)malloc((nthreads - 1) * sizeof(pthread_t));
+    unsigned started = 0;
+    for (; started < nthreads - 1; started++)
+    {
+        if (pthread_create(&threads[started], nullptr, &worker, &ps) != 0)
+            break;              // carry on with the threads we have
+    }
+    worker(&ps);
+    for (unsigned t = 0; t < started; t++)
+        pthread_join(threads[t], nullptr);
+    concurrent = false;
+    free(threads);
+}
@@ -0,0 +1,35 @@
+/* Copyright (C) 2021 by The D Language Foundation, All Rights Reserved
+ * http://www.digitalmars.com
+ * Distributed under the Boost Software License, Version 1.0.
+ * http://www.boost.org/LICENSE_1_0.txt
+ */
+
+#pragma once
+
+#include <cstddef>    // for size_t
+
+/* Runs batches of independent jobs on a set of worker threads.
+ * The front end is not thread safe in general; only use this for
+ * work that reads finished ASTs and writes to job private buffers.
+ */
+struct ThreadPool
+{
+    typedef void (*fp_job_t)(void *ctx, size_t i);
+
+    /* Number of processors available to this process.
+     */
+    static unsigned processorCount();
+
+    /* Call fp(ctx, i) for every i in [0 .. n), using up to nthreads
+     * threads (the calling thread included). Returns when every job
+     * has completed. With nthreads <= 1 the jobs run in order on the
+     * calling thread.
+     */
+    static void run(size_t n, unsigned nthreads, fp_job_t fp, void *ctx);
+
+    /* True while run() has jobs executing on more than one thread.
+     * Lazily filled caches in shared AST nodes must not be written
+     * while this is set.
+     */
+    static bool concurrent;
+};
@@ -141,6 +141,617 @@ void incUsage(IRState *irs, Loc loc)
     }
 }
 
+/****************************************
+ * A switch on a string with not too many cases is done inline:
+ * a switch on the length, then for the strings of each length
+ * a trie of compares of the contents, a register sized piece
+ * at a time. Larger ones call _d_switch_string() instead,
+ * which does a binary search of the sorted case strings.
+ */
+
+#define STRINGSWITCH_MAX 512
+
+struct StringSwitch
+{
+    IRState *irs;
+    Blockx *blx;
+    block *defaultBlock;
+    Symbol *sptr;               // pointer to the contents of the string
+
+    StringSwitch(IRState *irs, block *defaultBlock, Symbol *sptr)
+    {
+        this->irs = irs;
+        this->blx = irs->blx;
+        this->defaultBlock = defaultBlock;
+        this->sptr = sptr;
+    }
+
+    static bool allStrings(CaseStatements *cases)
+    {
+        for (size_t i = 0; i < cases->length; i++)
+        {
+            if ((*cases)[i]->exp->op != TOKstring)
+                return false;
+        }
+        return true;
+    }
+
+    static size_t numBytes(CaseStatement *cs)
+    {
+        StringExp *se = (StringExp *)cs->exp;
+        return se->len * se->sz;
+    }
+
+    /* Size of the piece at offset off of a string that is nbytes long
+     */
+    static unsigned pieceSize(size_t off, size_t nbytes)
+    {
+        unsigned w = I64 ? 8 : 4;
+        while (w > nbytes - off)
+            w >>= 1;
+        return w;
+    }
+
+    static tym_t pieceTy(unsigned w)
+    {
+        switch (w)
+        {
+            case 1:     return TYuchar;
+            case 2:     return TYushort;
+            case 4:     return TYulong;
+            case 8:     return TYullong;
+            default:    assert(0);
+        }
+        return 0;
+    }
+
+    /* Value of the w bytes at offset off of the case string, as they
+     * would be read from memory.
+     */
+    static targ_ullong piece(CaseStatement *cs, size_t off, unsigned w)
+    {
+        StringExp *se = (StringExp *)cs->exp;
+        const unsigned char *p = (const unsigned char *)se->string + off;
+        targ_ullong v = 0;
+        for (unsigned i = 0; i < w; i++)
+            v |= (targ_ullong)p[i] << (i * 8);
+        return v;
+    }
+
+    static targ_ullong key(CaseStatement *cs, size_t off, unsigned w)
+    {
+        return w ? piece(cs, off, w) : ((StringExp *)cs->exp)->len;
+    }
+
+    elem *load(size_t off, unsigned w)
+    {
+        elem *e = el_var(sptr);
+        if (off)
+            e = el_bin(OPadd, TYnptr, e, el_long(TYsize_t, off));
+        return el_una(OPind, pieceTy(w), e);
+    }
+
+    /* End the current block with a branch on e to n keys,
+     * the successors for which the caller appends in order.
+     * One key is a test for equality, and the caller appends
+     * the default block as the last successor.
+     */
+    block *branch(elem *e, targ_ullong *keys, size_t n)
+    {
+        block *b = blx->curblock;
+        if (n == 1)
+        {
+            block_appendexp(b, el_bin(OPeqeq, TYbool, e, el_long(e->Ety, keys[0])));
+            block_next(blx, BCiftrue, nullptr);
+            return b;
+        }
+
+        // A switch is on at least an int
+        if (tysize(e->Ety) == 1)
+            e = el_una(OPu8_16, TYuint, e);
+        else if (tysize(e->Ety) == 2)
+            e = el_una(OPu16_32, TYuint, e);
+        block_appendexp(b, e);
+        block_next(blx, BCswitch, nullptr);
+
+        // Corresponding free is in block_free
+        targ_llong *pu = (targ_llong *) ::malloc(sizeof(*pu) * (n + 1));
+        b->BS.Bswitch = pu;
+        *pu++ = n;
+        memcpy(pu, keys, sizeof(*pu) * n);
+        b->appendSucc(defaultBlock);
+        return b;
+    }
+
+    /* The successor for a group of cases: the case itself if nothing
+     * more needs comparing, or the start of the code for the group.
+     */
+    void dispatchTo(block *b, CaseStatements *group, size_t off, size_t nbytes)
+    {
+        if (group->length == 1 && off == nbytes)
+            b->appendSucc(getLabel(irs, blx, (*group)[0])->lblock);
+        else
+        {
+            b->appendSucc(blx->curblock);
+            dispatch(group, off, nbytes);
+        }
+    }
+
+    /* Dispatch among a group of cases, all nbytes long, with the same
+     * contents up to off.
+     */
+    void dispatch(CaseStatements *group, size_t off, size_t nbytes)
+    {
+        // Compare the pieces the cases have in common in one go
+        elem *e = nullptr;
+        while (off < nbytes)
+        {
+            unsigned w = pieceSize(off, nbytes);
+            targ_ullong v = piece((*group)[0], off, w);
+            size_t i;
+            for (i = 1; i < group->length; i++)
+            {
+                if (piece((*group)[i], off, w) != v)
+                    break;
+            }
+            if (i < group->length)
+                break;
+            elem *ec = el_bin(OPeqeq, TYbool, load(off, w), el_long(pieceTy(w), v));
+            e = e ? el_bin(OPandand, TYbool, e, ec) : ec;
+            off += w;
+        }
+
+        if (off == nbytes)
+        {
+            assert(group->length == 1);
+            block *bcase = getLabel(irs, blx, (*group)[0])->lblock;
+            block *b = blx->curblock;
+            if (e)
+            {
+                block_appendexp(b, e);
+                block_next(blx, BCiftrue, nullptr);
+                b->appendSucc(bcase);
+                b->appendSucc(defaultBlock);
+            }
+            else
+            {
+                block_next(blx, BCgoto, nullptr);
+                b->appendSucc(bcase);
+            }
+            return;
+        }
+
+        if (e)
+        {
+            block *b = blx->curblock;
+            block_appendexp(b, e);
+            block_next(blx, BCiftrue, nullptr);
+            b->appendSucc(blx->curblock);
+            b->appendSucc(defaultBlock);
+        }
+
+        // Switch on the first piece that differs
+        unsigned w = pieceSize(off, nbytes);
+        CaseStatements subgroups;
+        Array<targ_ullong> keys;
+        partition(group, &subgroups, &keys, off, w);
+
+        block *b = branch(load(off, w), keys.tdata(), keys.length);
+        CaseStatement **p = subgroups.tdata();
+        for (size_t i = 0; i < keys.length; i++)
+        {
+            CaseStatements *sub = new CaseStatements();
+            for (; *p; p++)
+                sub->push(*p);
+            p++;
+            dispatchTo(b, sub, off + w, nbytes);
+        }
+        if (keys.length == 1)
+            b->appendSucc(defaultBlock);
+    }
+
+    /* Split group by the piece at off into subgroups, each ended with
+     * a null, and the value of the piece for each. A piece of size 0
+     * splits by length.
+     */
+    static void partition(CaseStatements *group, CaseStatements *subgroups,
+            Array<targ_ullong> *keys, size_t off, unsigned w)
+    {
+        for (size_t i = 0; i < group->length; i++)
+        {
+            targ_ullong v = key((*group)[i], off, w);
+            bool found = false;
+            for (size_t k = 0; k < keys->length; k++)
+            {
+                found = (*keys)[k] == v;
+                if (found)
+                    break;
+            }
+            if (found)
+                continue;
+            keys->push(v);
+            for (size_t j = i; j < group->length; j++)
+            {
+                if (key((*group)[j], off, w) == v)
+                    subgroups->push((*group)[j]);
+            }
+            subgroups->push(nullptr);
+        }
+    }
+
+    /* Dispatch on the string with length elen among the cases
+     */
+    void toIR(elem *elen, CaseStatements *cases)
+    {
+        CaseStatements subgroups;
+        Array<targ_ullong> keys;
+        partition(cases, &subgroups, &keys, 0, 0);
+
+        block *b = branch(elen, keys.tdata(), keys.length);
+        CaseStatement **p = subgroups.tdata();
+        for (size_t i = 0; i < keys.length; i++)
+        {
+            CaseStatements *sub = new CaseStatements();
+            for (; *p; p++)
+                sub->push(*p);
+            p++;
+            dispatchTo(b, sub, 0, numBytes((*sub)[0]));
+        }
+        if (keys.length == 1)
+            b->appendSucc(defaultBlock);
+    }
+};
+
+/****************************************
+ * A loop that does nothing but compute and append elements to a local
+ * dynamic array keeps the capacity of the array in a temporary: it is
+ * queried before the loop, appends bump the length in place while it
+ * is below it, and only call the runtime when the block is full.
+ * The used length kept in the GC block is brought up to date after the
+ * loop. This is only sound if no other code can look at the block
+ * while the loop runs, so the loop must not call functions, slice or
+ * take the address of the array, append to other arrays or leave
+ * other than by falling out of it or `break`.
+ */
+
+bool walkPostorder(Expression *e, StoppableVisitor *v);
+bool walkPostorder(Statement *s, StoppableVisitor *v);
+elem *arrayCapacity(Loc loc, Type *t, elem *ea, IRState *irs);
+elem *arrayShrinkFit(Loc loc, Type *t, elem *e, IRState *irs);
+
+/* Does copying, comparing or destroying a t run user code?
+ */
+static bool callsUser(Type *t)
+{
+    t = t->baseElemOf();
+    if (t->ty == Tclass)
+        return true;
+    if (t->ty == Tstruct)
+    {
+        StructDeclaration *sd = ((TypeStruct *)t)->sym;
+        return sd->postblit || sd->dtor || sd->hasIdentityAssign || sd->xeq || sd->xcmp;
+    }
+    return false;
+}
+
+class AppendLoopWalker : public StoppableVisitor
+{
+public:
+    FuncDeclaration *fd;
+    VarDeclaration *v;          // the array appended to
+    size_t uses;                // references to v
+    size_t harmless;            // references to v that are appends, indexing or .length
+    size_t cases;               // cases of the switches in the loop
+    size_t caseLabels;          // case and default statements in the loop
+
+    AppendLoopWalker(FuncDeclaration *fd, VarDeclaration *v)
+        : fd(fd), v(v), uses(0), harmless(0), cases(0), caseLabels(0)
+    {
+    }
+
+    void walk(Expression *e)
+    {
+        if (e && !stop)
+            walkPostorder(e, this);
+    }
+
+    bool isV(Expression *e)
+    {
+        return e->op == TOKvar && ((VarExp *)e)->var == v;
+    }
+
+    /* Can v be the array appended to?
+     */
+    bool candidate(VarDeclaration *vd, Type *telem)
+    {
+        Type *tb = vd->type->toBasetype();
+        return tb->ty == Tarray && !tb->isShared() &&
+            !(vd->storage_class & (STCref | STCout | STClazy | STCmanifest | STCfield)) &&
+            !vd->isDataseg() && vd->toParent2() == fd && !vd->nestedrefs.length &&
+            tb->nextOf()->toBasetype()->equals(telem) && !callsUser(telem);
+    }
+
+    // Statements
+
+    void visit(Statement *)
+    {
+        stop = true;
+    }
+
+    void visit(ExpStatement *s)
+    {
+        walk(s->exp);
+    }
+
+    void visit(DtorExpStatement *)
+    {
+        stop = true;
+    }
+
+    void visit(CompoundStatement *) { }
+    void visit(UnrolledLoopStatement *) { }
+    void visit(ScopeStatement *) { }
+    void visit(PeelStatement *) { }
+    void visit(DebugStatement *) { }
+    void visit(ImportStatement *) { }
+    void visit(SwitchErrorStatement *) { }
+
+    void visit(CompoundAsmStatement *)
+    {
+        stop = true;
+    }
+
+    void visit(IfStatement *s)
+    {
+        walk(s->condition);
+    }
+
+    void visit(DoStatement *s)
+    {
+        walk(s->condition);
+    }
+
+    void visit(ForStatement *s)
+    {
+        walk(s->condition);
+        walk(s->increment);
+    }
+
+    void visit(SwitchStatement *s)
+    {
+        cases += s->cases->length + (s->sdefault != nullptr);
+        walk(s->condition);
+    }
+
+    void visit(CaseStatement *s)
+    {
+        caseLabels++;
+        walk(s->exp);
+    }
+
+    void visit(DefaultStatement *)
+    {
+        caseLabels++;
+    }
+
+    void visit(BreakStatement *s)
+    {
+        stop |= s->ident != nullptr;
+    }
+
+    void visit(ContinueStatement *s)
+    {
+        stop |= s->ident != nullptr;
+    }
+
+    // Expressions
+
+    void visit(Expression *)
+    {
+        stop = true;            // may run user code
+    }
+
+    void visit(IntegerExp *) { }
+    void visit(RealExp *) { }
+    void visit(ComplexExp *) { }
+    void visit(NullExp *) { }
+    void visit(StringExp *) { }
+    void visit(ThisExp *) { }
+    void visit(TypeidExp *) { }
+    void visit(ArrayLiteralExp *) { }
+    void visit(StructLiteralExp *) { }
+    void visit(TupleExp *) { }
+    void visit(HaltExp *) { }
+
+    void visit(VarExp *e)
+    {
+        if (e->var == v)
+            uses++;
+    }
+
+    void visit(SymOffExp *e)
+    {
+        if (e->var == v)
+            uses++;
+    }
+
+    void visit(DeclarationExp *e)
+    {
+        VarDeclaration *vd = e->declaration->isVarDeclaration();
+        if (!vd || vd == v || callsUser(vd->type))
+            stop = true;
+        else if (!vd->isDataseg() && !(vd->storage_class & STCmanifest) && vd->_init)
+        {
+            if (ExpInitializer *ie = vd->_init->isExpInitializer())
+                walk(ie->exp);
+            else if (!vd->_init->isVoidInitializer())
+                stop = true;
+        }
+    }
+
+    void visit(UnaExp *) { }
+
+    void visit(CallExp *)
+    {
+        stop = true;
+    }
+
+    void visit(AssertExp *)
+    {
+        stop = true;
+    }
+
+    void visit(DeleteExp *)
+    {
+        stop = true;
+    }
+
+    void visit(DelegateExp *)
+    {
+        stop = true;
+    }
+
+    void visit(PreExp *e)
+    {
+        stop |= e->e1->op == TOKarraylength;
+    }
+
+    void visit(ArrayLengthExp *e)
+    {
+        if (isV(e->e1))
+            harmless++;
+    }
+
+    void visit(BinExp *) { }
+
+    void visit(PostExp *e)
+    {
+        stop |= e->e1->op == TOKarraylength;
+    }
+
+    void visit(IndexExp *e)
+    {
+        if (isV(e->e1))
+            harmless++;
+        stop |= e->e1->type->toBasetype()->ty == Taarray;
+    }
+
+    void visit(EqualExp *e)
+    {
+        stop |= callsUser(e->e1->type);
+    }
+
+    void visit(CmpExp *e)
+    {
+        stop |= callsUser(e->e1->type);
+    }
+
+    void visit(InExp *)
+    {
+        stop = true;
+    }
+
+    void visit(RemoveExp *)
+    {
+        stop = true;
+    }
+
+    void visit(PowExp *)
+    {
+        stop = true;
+    }
+
+    void visit(AssignExp *e)
+    {
+        Type *t1 = e->e1->type->toBasetype();
+        if (e->e1->op == TOKarraylength || callsUser(t1))
+            stop = true;
+        else if (t1->ty == Tarray && e->e1->op != TOKslice &&
+                 !(e->e1->op == TOKvar && !isV(e->e1)))
+            stop = true;        // might overwrite v through a pointer
+    }
+
+    void visit(BinAssignExp *e)
+    {
+        stop |= e->e1->op == TOKarraylength;
+    }
+
+    void visit(CatAssignExp *e)
+    {
+        if (e->e1->op != TOKvar)
+        {
+            stop = true;
+            return;
+        }
+        VarDeclaration *vd = ((VarExp *)e->e1)->var->isVarDeclaration();
+        if (!v && vd && candidate(vd, e->e2->type->toBasetype()))
+            v = vd;
+        if (vd == v && e->e2->type->toBasetype()->equals(v->type->toBasetype()->nextOf()->toBasetype()))
+            harmless++;
+        else
+            stop = true;
+    }
+};
+
+/* Get the array appended to by a loop with body sbody, condition econd
+ * and increment eincr, nullptr if there is none or the capacity can't be
+ * cached for it.
+ */
+static VarDeclaration *appendLoopVar(IRState *irs, Statement *sbody, Expression *econd, Expression *eincr)
+{
+    if (!global.params.optimize || global.params.betterC || irs->appendVar || !sbody)
+        return nullptr;
+
+    /* The first pass finds the array, the second counts the references to it
+     */
+    FuncDeclaration *fd = irs->getFunc();
+    VarDeclaration *v = nullptr;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        AppendLoopWalker aw(fd, v);
+        walkPostorder(sbody, &aw);
+        aw.walk(econd);
+        aw.walk(eincr);
+        if (aw.stop || !aw.v || aw.cases != aw.caseLabels)
+            return nullptr;
+        if (pass == 1 && aw.uses != aw.harmless)
+            return nullptr;
+        v = aw.v;
+    }
+    return v;
+}
+
+/* Query the capacity of the array appended to by the loop s
+ * before it starts.
+ */
+static void appendLoopBegin(IRState *mystate, Statement *s,
+    Statement *sbody, Expression *econd, Expression *eincr)
+{
+    VarDeclaration *v = appendLoopVar(mystate, sbody, econd, eincr);
+    if (!v)
+        return;
+    Symbol *scap = symbol_genauto(Type_toCtype(Type::tsize_t));
+    elem *ea = el_una(OPaddr, TYnptr, el_var(toSymbol(v)));
+    elem *e = el_bin(OPeq, TYsize_t, el_var(scap), arrayCapacity(s->loc, v->type, ea, mystate));
+    block_appendexp(mystate->blx->curblock, e);
+    mystate->appendVar = v;
+    mystate->appendCap = scap;
+}
+
+/* Record the length of the array appended to by the loop s in its block,
+ * once the loop is done. Nothing needs to be done if the capacity is 0,
+ * as then the length has not been bumped since the runtime last saw it.
+ */
+static void appendLoopEnd(IRState *mystate, Statement *s)
+{
+    if (!mystate->appendCap || mystate->prev->appendCap)
+        return;
+    VarDeclaration *v = mystate->appendVar;
+    elem *e = arrayShrinkFit(s->loc, v->type, el_var(toSymbol(v)), mystate);
+    e = el_bin(OPandand, TYvoid, el_var(mystate->appendCap), e);
+    block_appendexp(mystate->blx->curblock, e);
+}
+
 void Statement_toIR(Statement *s, IRState *irs);
 
 class S2irVisitor : public Visitor
@@ -245,6 +856,7 @@ public:
         mystate.breakBlock = block_calloc(blx);
         mystate.contBlock = block_calloc(blx);
 
+        appendLoopBegin(&mystate, s, s->_body, s->condition, nullptr);
         block *bpre = blx->curblock;
         block_next(blx, BCgoto, nullptr);
         bpre->appendSucc(blx->curblock);
@@ -260,6 +872,7 @@ public:
         incUsage(irs, s->condition->loc);
         block_appendexp(mystate.contBlock, toElemDtor(s->condition, &mystate));
         block_next(blx, BCiftrue, mystate.breakBlock);
+        appendLoopEnd(&mystate, s);
 
     }
 
@@ -277,6 +890,7 @@ public:
 
         if (s->_init)
             Statement_toIR(s->_init, &mystate);
+        appendLoopBegin(&mystate, s, s->_body, s->condition, s->increment);
         block *bpre = blx->curblock;
         block_next(blx,BCgoto,nullptr);
         block *bcond = blx->curblock;
@@ -314,6 +928,7 @@ public:
         /* The 'break' block follows the for statement.
          */
         block_next(blx,BCgoto, mystate.breakBlock);
+        appendLoopEnd(&mystate, s);
     }
 
 
@@ -531,6 +1146,33 @@ public:
             return;
         }
 
+        if (s->condition->type->isString() && numcases && numcases <= STRINGSWITCH_MAX &&
+            StringSwitch::allStrings(s->cases))
+        {
+            if (econd->Eoper != OPvar)
+            {
+                elem *e = exp2_copytotemp(econd);
+                block_appendexp(mystate.switchBlock, e);
+                econd = e->E2;
+            }
+            Symbol *sptr = symbol_genauto(TYnptr);
+            elem *e = el_bin(OPeq, TYnptr, el_var(sptr), el_una(OPmsw, TYnptr, el_copytree(econd)));
+            block_appendexp(mystate.switchBlock, e);
+            elem *elen = el_una(I64 ? OP128_64 : OP64_32, TYsize_t, econd);
+
+            /* The switch block can't be a BCswitch, as the cases would be
+             * added to it as successors
+             */
+            block_goto(blx, BCgoto, nullptr);
+
+            StringSwitch ss(&mystate, mystate.defaultBlock, sptr);
+            ss.toIR(elen, s->cases);
+
+            Statement_toIR(s->_body, &mystate);
+            block_goto(blx, BCgoto, mystate.breakBlock);
+            return;
+        }
+
         if (s->condition->type->isString())
         {
             // Number the cases so we can unscramble things after the sort()
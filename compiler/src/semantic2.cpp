@@ -273,6 +273,10 @@ public:
         if (fd->semanticRun >= PASSsemantic2done)
             return;
 
+        // Imported function nothing has used yet, see -lazy
+        if (fd->lazySemantic && fd->semanticRun == PASSinit)
+            return;
+
         if (fd->semanticRun < PASSsemanticdone && !fd->errors)
         {
             /* https://issues.dlang.org/show_bug.cgi?id=21614
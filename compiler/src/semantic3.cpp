@@ -27,6 +27,7 @@ bool allowsContractWithoutBody(FuncDeclaration *funcdecl);
 int blockExit(Statement *s, FuncDeclaration *func, bool mustNotThrow);
 bool checkReturnEscape(Scope *sc, Expression *e, bool gag);
 bool checkReturnEscapeRef(Scope *sc, Expression *e, bool gag);
+void inferStackAllocations(FuncDeclaration *fd);
 TypeIdentifier *getThrowable();
 char *MODtoChars(MOD mod);
 Expression *resolve(Loc loc, Scope *sc, Dsymbol *s, bool hasOverloads);
@@ -1156,6 +1157,9 @@ public:
             sc2->pop();
         }
 
+        if (global.errors == oldErrors)
+            inferStackAllocations(funcdecl);
+
         if (funcdecl->checkClosure())
         {
             // We should be setting errors here instead of relying on the global error count.
@@ -287,7 +287,7 @@ int Target::isVectorTypeSupported(int sz, Type *type)
             return 2; // wrong base type
     }
 
-    if (sz != 16 && sz != 32)
+    if (sz != 16 && !(sz == 32 && global.params.cpu >= avx))
         return 3; // wrong size
 
     return 0;
@@ -300,12 +300,22 @@ int Target::isVectorTypeSupported(int sz, Type *type)
  * Returns:
  *      true if the operation is supported or type is not a vector
  */
-bool Target::isVectorOpSupported(Type *type, TOK op, Type *)
+bool Target::isVectorOpSupported(Type *type, TOK op, Type *t2)
 {
     if (type->ty != Tvector)
         return true; // not a vector op
     TypeVector *tvec = (TypeVector*)type;
 
+    if (tvec->size(Loc()) == 32)
+    {
+        // 256 bit integer operations need AVX2
+        if (tvec->isintegral() && global.params.cpu < avx2)
+            return false;
+        // (-e) and (~e) are built from 128 bit constants
+        if (op == TOKneg || op == TOKtilde)
+            return false;
+    }
+
     bool supported;
     switch (op)
     {
@@ -313,7 +323,17 @@ bool Target::isVectorOpSupported(Type *type, TOK op, Type *)
             supported = tvec->isscalar();
             break;
 
-        case TOKlt: case TOKgt: case TOKle: case TOKge: case TOKequal: case TOKnotequal: case TOKidentity: case TOKnotidentity:
+        case TOKlt: case TOKgt: case TOKle: case TOKge: case TOKequal: case TOKnotequal:
+            // CMPPS/CMPPD, PCMPEQ and PCMPGT; the quadword forms are SSE4
+            if (tvec->isfloating() || tvec->elementType()->size(Loc()) != 8)
+                supported = true;
+            else if (op == TOKequal || op == TOKnotequal)
+                supported = global.params.cpu >= sse4_1;
+            else
+                supported = global.params.cpu >= sse4_2;
+            break;
+
+        case TOKidentity: case TOKnotidentity:
             supported = false;
             break;
 
@@ -322,8 +342,24 @@ bool Target::isVectorOpSupported(Type *type, TOK op, Type *)
             break;
 
         case TOKshl: case TOKshlass: case TOKshr: case TOKshrass: case TOKushr: case TOKushrass:
-            supported = false;
+        {
+            /* PSLL, PSRL and PSRA shift every element by the same count,
+             * AVX2's VPSLLV, VPSRLV and VPSRAVD each by its own.
+             * There are no byte shifts, and no PSRAQ.
+             */
+            d_uns64 sz = tvec->elementType()->size(Loc());
+            bool arith = (op == TOKshr || op == TOKshrass) && !tvec->isunsigned();
+            if (!tvec->isintegral() || sz == 1 || (arith && sz == 8))
+                supported = false;
+            else if (t2 && t2->ty == Tvector)
+                supported = global.params.cpu >= avx2 && sz >= 4 &&
+                            t2->isintegral() &&
+                            t2->size(Loc()) == tvec->size(Loc()) &&
+                            ((TypeVector *)t2)->elementType()->size(Loc()) == sz;
+            else
+                supported = true;
             break;
+        }
 
         case TOKadd: case TOKaddass: case TOKmin: case TOKminass:
             supported = tvec->isscalar();
@@ -338,11 +374,12 @@ bool Target::isVectorOpSupported(Type *type, TOK op, Type *)
             break;
 
         case TOKdiv: case TOKdivass:
-            supported = tvec->isfloating();
+            // integers only by a constant, and only 16 bit ones (PMULHW/PMULHUW)
+            supported = tvec->isfloating() || tvec->elementType()->size(Loc()) == 2;
             break;
 
         case TOKmod: case TOKmodass:
-            supported = false;
+            supported = tvec->isintegral() && tvec->elementType()->size(Loc()) == 2;
             break;
 
         case TOKand: case TOKandass: case TOKor: case TOKorass: case TOKxor: case TOKxorass:
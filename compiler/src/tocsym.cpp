@@ -26,6 +26,7 @@
 #include "id.hpp"
 #include "ctfe.hpp"
 #include "root/rmem.hpp"
+#include "root/aav.hpp"
 #include "target.hpp"
 #include "mangle.hpp"
 
@@ -87,6 +88,7 @@ Symbol *toSymbolX(Dsymbol *ds, const char *prefix, int sclass, type *t, const ch
 }
 
 static Classsym *scc;
+static AA *funcDeclarations;            // FuncDeclaration's indexed by their Symbol
 
 /*************************************
  */
@@ -327,6 +329,7 @@ Symbol *toSymbol(Dsymbol *s)
             t->Tcount++;
             s->Stype = t;
             //s->Sfielddef = this;
+            *dmd_aaGet(&funcDeclarations, (void *)s) = (void *)fd;
 
             result = s;
         }
@@ -418,6 +421,17 @@ static Symbol *toImport(Symbol *sym)
     return s;
 }
 
+/*************************************
+ * Get the function that toSymbol() made Symbol s for.
+ * Returns:
+ *      nullptr if s isn't a function's Symbol
+ */
+
+FuncDeclaration *toFuncDeclaration(Symbol *s)
+{
+    return (FuncDeclaration *)dmd_aaGetRvalue(funcDeclarations, (void *)s);
+}
+
 /*********************************
  * Generate import symbol from symbol.
  */
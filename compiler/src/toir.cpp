@@ -422,6 +422,10 @@ int intrinsic_op(FuncDeclaration *fd)
 
             else if (id3 == Id::bswap)   op = OPbswap;
             else if (id3 == Id::_popcnt) op = OPpopcnt;
+
+            // Every CPU with AVX has POPCNT
+            else if (id3 == Id::popcnt && global.params.cpu >= avx &&
+                     (global.params.is64bit || argtype1 != Type::tuns64)) op = OPpopcnt;
         }
         else if (id2 == Id::_volatile)
         {
@@ -0,0 +1,9 @@
+#!/usr/bin/env bash
+
+source tools/common_funcs.sh
+
+for name in ${TEST_NAME} ddocmemo2a ddocmemo2b; do
+    grep --text -v "Generated by Ddoc from" ${RESULTS_TEST_DIR}/${name}.html > ${RESULTS_TEST_DIR}/${name}.html.2
+    diff -up --strip-trailing-cr ${EXTRA_FILES}/${name}.html ${RESULTS_TEST_DIR}/${name}.html.2
+    rm_retry ${RESULTS_TEST_DIR}/${name}.html{,.2}
+done
@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+
+source tools/common_funcs.sh
+
+expect_file=${EXTRA_FILES}/${TEST_NAME}.sections
+obj_file=${OUTPUT_BASE}_0.o
+
+# The section each function of the test module was placed in, e.g.
+#   .text.hot _D10profileuse6lookupFAxiiZi
+objdump -t "${obj_file}" | awk '$3 == "F" { print $4, $6 }' | grep -E "${TEST_NAME}|main$" | sort -k2 > "${obj_file}.sections"
+
+diff -up --strip-trailing-cr "${expect_file}" "${obj_file}.sections"
+
+rm_retry "${OUTPUT_BASE}_0.o"{,.sections}